@@ -0,0 +1,155 @@
+var nodegit = require("../"),
+    path = require("path");
+
+// This code compares how long it takes to walk the whole history of a
+// repository when the parents of the commits are read from the object
+// database, and when they are read from its commit-graph file.
+// Write the commit-graph first with `git commit-graph write --reachable`.
+//
+// commitGraphIndex reads the commit-graph itself; commitWalk and fastWalk go
+// through libgit2's revwalk, which reads it when core.commitGraph is not false.
+// The runs without the commit-graph set core.commitGraph to false in the
+// configuration of the repository for their duration.
+//
+// Usage: node commit-graph-benchmark.js [path to repository] [runs]
+
+var repoPath = path.resolve(process.argv[2] || path.resolve(__dirname, ".."));
+var runs = parseInt(process.argv[3], 10) || 5;
+
+function time(fn) {
+  var start = process.hrtime();
+  return fn().then(function(result) {
+    var elapsed = process.hrtime(start);
+    return { ms: elapsed[0] * 1e3 + elapsed[1] / 1e6, result: result };
+  });
+}
+
+// the commit-graph is attached to a repository when it is opened
+function createWalker() {
+  return nodegit.Repository.open(repoPath)
+    .then(function(repo) {
+      var walker = repo.createRevWalk();
+      walker.pushGlob("*");
+      walker.pushHead();
+      return walker;
+    });
+}
+
+var benchmarks = [
+  {
+    name: "commitGraphIndex",
+    run: function(useCommitGraph) {
+      return nodegit.Repository.open(repoPath)
+        .then(function(repo) {
+          return repo.commitGraphIndex({ useCommitGraph: useCommitGraph });
+        })
+        .then(function(index) {
+          return index.count();
+        });
+    }
+  },
+  {
+    name: "commitWalk",
+    run: function(useCommitGraph, maxCount) {
+      return createWalker()
+        .then(function(walker) {
+          return walker.commitWalk(maxCount, { columnar: true });
+        })
+        .then(function(commits) {
+          return commits.count;
+        });
+    }
+  },
+  {
+    name: "fastWalk",
+    run: function(useCommitGraph, maxCount) {
+      return createWalker()
+        .then(function(walker) {
+          return walker.fastWalk(maxCount);
+        })
+        .then(function(oids) {
+          return oids.length;
+        });
+    }
+  }
+];
+
+function bench(benchmark, useCommitGraph, maxCount) {
+  var timings = [];
+  var count;
+
+  function run(remaining) {
+    if (remaining === 0) {
+      return Promise.resolve();
+    }
+
+    return time(function() {
+      return benchmark.run(useCommitGraph, maxCount);
+    })
+    .then(function(timing) {
+      timings.push(timing.ms);
+      count = timing.result;
+      return run(remaining - 1);
+    });
+  }
+
+  return run(runs).then(function() {
+    timings.sort(function(a, b) { return a - b; });
+    console.log(
+      (benchmark.name + ":                ").slice(0, 18) +
+      (useCommitGraph ? "with commit-graph:    " : "without commit-graph: ") +
+      count + " commits, median " +
+      timings[Math.floor(timings.length / 2)].toFixed(1) + " ms"
+    );
+    return count;
+  });
+}
+
+function benchAll(useCommitGraph, maxCount) {
+  return benchmarks.reduce(function(previous, benchmark) {
+    return previous.then(function(count) {
+      return bench(benchmark, useCommitGraph, maxCount || count);
+    });
+  }, Promise.resolve(maxCount));
+}
+
+nodegit.Repository.open(repoPath)
+  .then(function(repo) {
+    return repo.config();
+  })
+  .then(function(config) {
+    var hadValue;
+    var previousValue;
+
+    function restore() {
+      return hadValue ?
+        config.setBool("core.commitGraph", previousValue) :
+        Promise.resolve(config.deleteEntry("core.commitGraph"));
+    }
+
+    return config.getBool("core.commitGraph")
+      .then(function(value) {
+        hadValue = true;
+        previousValue = value;
+      }, function() {
+        hadValue = false;
+      })
+      .then(function() {
+        return config.setBool("core.commitGraph", false);
+      })
+      .then(function() {
+        return benchAll(false);
+      })
+      .then(function(count) {
+        return config.setBool("core.commitGraph", true)
+          .then(function() {
+            return benchAll(true, count);
+          });
+      })
+      .then(restore, function(error) {
+        return restore().then(function() {
+          throw error;
+        });
+      });
+  })
+  .done();
@@ -0,0 +1,186 @@
+#include "../include/ahead_behind_batch.h"
+#include "../include/v8_helpers.h"
+
+/**
+ * \struct AheadBehindBatchData
+ * Pairs of commits to compare, parsed on the main thread, and their results.
+ */
+struct AheadBehindBatchData
+{
+  std::vector<git_oid> locals {};
+  std::vector<git_oid> upstreams {};
+  std::vector<uint32_t> ahead {};
+  std::vector<uint32_t> behind {};
+  size_t numVisitedCommits {0};
+};
+
+// \return false if the value is neither an Oid nor a valid sha
+static bool oidFromJavascript(git_oid *out, v8::Local<v8::Value> value) {
+  if (value->IsString()) {
+    Nan::Utf8String oidString(Nan::To<v8::String>(value).ToLocalChecked());
+    return oidString.length() == GIT_OID_HEXSZ && git_oid_fromstrn(out, *oidString, GIT_OID_HEXSZ) == GIT_OK;
+  }
+  if (!value->IsObject()) {
+    return false;
+  }
+
+  git_oid_cpy(out, Nan::ObjectWrap::Unwrap<GitOid>(Nan::To<v8::Object>(value).ToLocalChecked())->GetValue());
+  return true;
+}
+
+NAN_METHOD(GitGraph::AheadBehindBatch)
+{
+  if (info.Length() == 0 || !info[0]->IsObject()) {
+    return Nan::ThrowError("Repository repo is required.");
+  }
+
+  if (info.Length() < 3 || !info[1]->IsArray() || !info[2]->IsArray()) {
+    return Nan::ThrowError("Arrays of local and upstream commits are required.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  v8::Local<v8::Array> jsLocals = v8::Local<v8::Array>::Cast(info[1]);
+  v8::Local<v8::Array> jsUpstreams = v8::Local<v8::Array>::Cast(info[2]);
+  if (jsLocals->Length() != jsUpstreams->Length()) {
+    return Nan::ThrowError("There must be as many upstream commits as local commits.");
+  }
+
+  AheadBehindBatchData *data = new AheadBehindBatchData();
+  data->locals.resize(jsLocals->Length());
+  data->upstreams.resize(jsUpstreams->Length());
+  for (uint32_t i = 0; i < jsLocals->Length(); ++i) {
+    if (
+      !oidFromJavascript(&data->locals[i], Nan::Get(jsLocals, i).ToLocalChecked())
+      || !oidFromJavascript(&data->upstreams[i], Nan::Get(jsUpstreams, i).ToLocalChecked())
+    ) {
+      delete data;
+      return Nan::ThrowError("Commits must be Oids or shas.");
+    }
+  }
+
+  AheadBehindBatchBaton* baton = new AheadBehindBatchBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->out = static_cast<void *>(data);
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(Nan::To<v8::Object>(info[0]).ToLocalChecked())->GetValue();
+  baton->use_commit_graph = true;
+  if (info.Length() == 5 && info[3]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[3]).ToLocalChecked();
+    v8::Local<v8::String> propName = Nan::New("useCommitGraph").ToLocalChecked();
+    if (Nan::Has(options, propName).FromJust()) {
+      baton->use_commit_graph = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+    }
+  }
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  AheadBehindBatchWorker *worker = new AheadBehindBatchWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info[0]);
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitGraph::AheadBehindBatchWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, baton->repo);
+  return lockMaster;
+}
+
+void GitGraph::AheadBehindBatchWorker::Execute()
+{
+  git_error_clear();
+
+  AheadBehindBatchData *data = static_cast<AheadBehindBatchData *>(baton->out);
+  ::AheadBehindBatch batch(baton->repo, baton->use_commit_graph);
+  for (size_t i = 0; i < data->locals.size(); ++i) {
+    batch.AddPair(data->locals[i], data->upstreams[i]);
+  }
+
+  if ((baton->error_code = batch.Compute()) != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+
+    delete data;
+    baton->out = NULL;
+    return;
+  }
+
+  data->ahead = batch.GetAhead();
+  data->behind = batch.GetBehind();
+  data->numVisitedCommits = batch.GetNumVisitedCommits();
+}
+
+void GitGraph::AheadBehindBatchWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<AheadBehindBatchData *>(baton->out);
+
+  delete baton;
+}
+
+void GitGraph::AheadBehindBatchWorker::HandleOKCallback()
+{
+  if (baton->out != NULL)
+  {
+    AheadBehindBatchData *data = static_cast<AheadBehindBatchData *>(baton->out);
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+    Nan::Set(result, Nan::New("ahead").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Uint32Array>(data->ahead));
+    Nan::Set(result, Nan::New("behind").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Uint32Array>(data->behind));
+    Nan::Set(result, Nan::New("visitedCommits").ToLocalChecked(), Nan::New<v8::Number>(static_cast<double>(data->numVisitedCommits)));
+    delete data;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method aheadBehindBatch has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Graph.aheadBehindBatch").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Method aheadBehindBatch has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Graph.aheadBehindBatch").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
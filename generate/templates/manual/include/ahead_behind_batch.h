@@ -0,0 +1,83 @@
+#ifndef AHEAD_BEHIND_BATCH_H
+#define AHEAD_BEHIND_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "commit_data_source.h"
+
+/**
+ * \class AheadBehindBatch
+ * Same counts as git_graph_ahead_behind for many (local, upstream) pairs, computed in a
+ * single walk of their shared history instead of one walk per pair.
+ *
+ * Each commit is marked with the set of tips (locals and upstreams) it is reachable from,
+ * walking parents after their children: by generation number when the commit is in the
+ * commit-graph, and by commit time otherwise, as git does. The walk stops once every commit
+ * left to visit is reachable from both commits of each pair or from none of them, as those
+ * count for no pair, and is older than the commits counted without all the tips. So pairs of
+ * unrelated histories don't make the others walk to their roots. Without a commit-graph,
+ * counts can be off when commit times go backwards over several commits, as with
+ * git_graph_ahead_behind.
+ */
+class AheadBehindBatch
+{
+public:
+  AheadBehindBatch(git_repository *repo, bool useCommitGraph = true);
+  ~AheadBehindBatch() = default;
+  AheadBehindBatch(const AheadBehindBatch &other) = delete;
+  AheadBehindBatch(AheadBehindBatch &&other) = delete;
+  AheadBehindBatch& operator=(const AheadBehindBatch &other) = delete;
+  AheadBehindBatch& operator=(AheadBehindBatch &&other) = delete;
+
+  // \return the index of the pair in GetAhead() and GetBehind()
+  size_t AddPair(const git_oid &local, const git_oid &upstream);
+
+  // \return GIT_OK on success; libgit2 error code otherwise.
+  int Compute();
+
+  // commits reachable from local but not from upstream, for each pair
+  const std::vector<uint32_t> &GetAhead() const { return m_ahead; }
+  // commits reachable from upstream but not from local, for each pair
+  const std::vector<uint32_t> &GetBehind() const { return m_behind; }
+  size_t GetNumVisitedCommits() const { return m_commits.size(); }
+
+private:
+  struct Commit {
+    git_oid oid {};
+    std::vector<git_oid> parents {};
+    uint32_t generation {0}; // UINT32_MAX if not in the commit-graph
+    int64_t commitTime {0};
+    bool queued {false};
+    bool stale {false}; // while queued: isStale when it was last updated
+    bool counted {false};
+    bool countedPartially {false}; // counted without all the tips
+  };
+
+  // \return the index of the commit in m_commits, looking it up the first time
+  int getCommit(const git_oid &oid, uint32_t *index);
+  bool isFull(uint32_t index) const;
+  bool isStale(uint32_t index) const;
+  std::string bitmapKey(uint32_t index, const std::vector<uint64_t> &bitmaps) const;
+
+  CommitDataSource m_commitDataSource;
+  std::unordered_map<std::string, uint32_t> m_tipIndexes {};
+  std::vector<std::pair<uint32_t, uint32_t>> m_pairs {};
+
+  size_t m_numWords {0};
+  std::unordered_map<std::string, uint32_t> m_commitIndexes {};
+  std::vector<Commit> m_commits {};
+  std::vector<uint64_t> m_bitmaps {}; // tips each commit is reachable from, m_numWords per commit
+  std::vector<uint64_t> m_countedBitmaps {}; // tips each commit was counted with
+
+  std::vector<uint32_t> m_ahead {};
+  std::vector<uint32_t> m_behind {};
+};
+
+#endif
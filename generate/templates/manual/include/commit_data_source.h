@@ -0,0 +1,69 @@
+#ifndef COMMIT_DATA_SOURCE_H
+#define COMMIT_DATA_SOURCE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "commit_graph_file.h"
+#include "commits_graph.h"
+
+/**
+ * \class CommitDataSource
+ * Parents, commit time and generation number of commits, read from the commit-graph
+ * of the repository when it has one and the commit is in it, and from the object
+ * database otherwise (commits written after the commit-graph, or no commit-graph at all).
+ * Not thread safe: use one per thread.
+ */
+class CommitDataSource
+{
+public:
+  struct CommitData {
+    std::vector<git_oid> parents {};
+    int64_t commitTime {0}; // seconds since epoch
+    uint32_t generation {CommitsGraph::kUnknownGeneration}; // unknown for commits not in the commit-graph
+  };
+
+  CommitDataSource(git_repository *repo, bool useCommitGraph = true);
+  ~CommitDataSource() = default;
+  CommitDataSource(const CommitDataSource &other) = delete;
+  CommitDataSource(CommitDataSource &&other) = delete;
+  CommitDataSource& operator=(const CommitDataSource &other) = delete;
+  CommitDataSource& operator=(CommitDataSource &&other) = delete;
+
+  // \return GIT_OK on success; libgit2 error code otherwise.
+  int Lookup(const git_oid *oid, CommitData *data);
+
+  /**
+   * Oids of the commits pointed to by the references (those not pointing to a commit are skipped),
+   * and by HEAD when it's detached; same as git_revwalk_push_glob("*") plus git_revwalk_push_head().
+   * \return GIT_OK on success; libgit2 error code otherwise.
+   */
+  int GetReferenceTips(std::vector<git_oid> *tips);
+
+  /**
+   * Adds to the graph all the commits reachable from the tips, with their parents.
+   * Parents missing from the repository (shallow clones) are not added.
+   * \param keepGoing called once per commit; returning false stops and returns GIT_EUSER.
+   * \return GIT_OK on success; libgit2 error code otherwise.
+   */
+  int AddReachableCommitsToGraph(const std::vector<git_oid> &tips, CommitsGraph *graph,
+    const std::function<bool()> &keepGoing = nullptr);
+
+  bool HasCommitGraph() const { return m_commitGraph != nullptr; }
+  size_t GetNumLookupsFromCommitGraph() const { return m_numLookupsFromCommitGraph; }
+  size_t GetNumLookupsFromOdb() const { return m_numLookupsFromOdb; }
+
+private:
+  git_repository *m_repo {nullptr};
+  std::unique_ptr<CommitGraphFile> m_commitGraph {};
+  size_t m_numLookupsFromCommitGraph {0};
+  size_t m_numLookupsFromOdb {0};
+};
+
+#endif
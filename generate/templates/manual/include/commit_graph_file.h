@@ -0,0 +1,107 @@
+#ifndef COMMIT_GRAPH_FILE_H
+#define COMMIT_GRAPH_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+/**
+ * \class CommitGraphFile
+ * Read-only access to the changed-path Bloom filters of the commit-graph written by
+ * `git commit-graph write --changed-paths` (objects/info/commit-graph, or the split
+ * commit-graph chain in objects/info/commit-graphs).
+ *
+ * The Bloom filter of a commit tells which paths may have changed from its first parent,
+ * so history walks can skip resolving a path in the trees of most commits.
+ *
+ * The commit data gives the parents, commit time and generation number (topological level)
+ * of the commits in the graph without reading them from the object database.
+ */
+class CommitGraphFile
+{
+public:
+  /**
+   * \class BloomKey
+   * Hashes of a path and all its leading directories, as git adds them to the filters.
+   */
+  class BloomKey
+  {
+  public:
+    BloomKey(const std::string &path);
+
+  private:
+    friend class CommitGraphFile;
+
+    // hashes of path and each of its leading directories, for each murmur3 hash version (1 and 2)
+    std::vector<uint32_t> m_seedHashes[2] {};
+    std::vector<uint32_t> m_stepHashes[2] {};
+  };
+
+  enum LoadFlags {
+    kLoadBloomFilters = 1,
+    kLoadCommitData = 2
+  };
+
+  ~CommitGraphFile();
+  CommitGraphFile(const CommitGraphFile &other) = delete;
+  CommitGraphFile(CommitGraphFile &&other) = delete;
+  CommitGraphFile& operator=(const CommitGraphFile &other) = delete;
+  CommitGraphFile& operator=(CommitGraphFile &&other) = delete;
+
+  /**
+   * Loads the commit-graph of the repository; flags are LoadFlags.
+   * \return nullptr if there is none, core.commitGraph is false, it can't be read,
+   * or kLoadBloomFilters alone was asked for and it has no changed-path Bloom filters.
+   */
+  static std::unique_ptr<CommitGraphFile> Open(git_repository *repo, int flags = kLoadBloomFilters);
+
+  /**
+   * libgit2's revwalk reads the parents and commit times of the commits in objects/info/commit-graph
+   * from it instead of parsing the commit objects. When core.commitGraph is false, detaches the
+   * commit-graph from the object database of the repository, for good: all the walks on this
+   * git_repository parse the commit objects from then on, until it is opened again.
+   * Call it with the repository locked, before walking; workers walking with a revwalk lock its
+   * repository for this reason.
+   */
+  static void ApplyConfigToRepository(git_repository *repo);
+
+  /**
+   * \return false only if the path certainly didn't change between the commit and its
+   * first parent; true if it may have changed, or if the commit has no Bloom filter.
+   */
+  bool MaybeChangedPath(const git_oid *commitOid, const BloomKey &key) const;
+
+  /**
+   * Reads the parents, commit time (in seconds) and generation number (1 for root commits)
+   * of a commit. Needs kLoadCommitData.
+   * \return false if the commit is not in the graph.
+   */
+  bool LookupCommit(const git_oid *commitOid, std::vector<git_oid> *parents, int64_t *commitTime,
+    uint32_t *generation) const;
+
+  size_t GetNumCommits() const;
+
+  // murmur3 hash used by git's Bloom filters; version 1 has git's signed char behaviour
+  static uint32_t Murmur3(uint32_t seed, const char *data, size_t len, int hashVersion);
+
+private:
+  struct Layer;
+
+  CommitGraphFile() = default;
+
+  static bool isEnabled(git_repository *repo);
+
+  static std::unique_ptr<Layer> loadLayer(const std::string &filePath, int flags, uint32_t basePosition);
+
+  // \return false if the position is not in any layer
+  bool oidAtPosition(uint32_t position, git_oid *oid) const;
+
+  std::vector<std::unique_ptr<Layer>> m_layers {};
+};
+
+#endif
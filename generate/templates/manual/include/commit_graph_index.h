@@ -0,0 +1,90 @@
+#ifndef COMMITGRAPHINDEX_H
+#define COMMITGRAPHINDEX_H
+#include <nan.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "async_worker.h"
+#include "context.h"
+#include "commits_graph.h"
+
+using namespace node;
+using namespace v8;
+
+/**
+ * \class CommitGraphIndex
+ * Keeps alive, for JS, the generation numbers of the commits reachable from the references
+ * of a repository, so that they can be queried in O(1).
+ * Batches of ancestry and merge-base queries run on it in parallel, without reading the
+ * repository again.
+ * Built by Repository#commitGraphIndex().
+ */
+class CommitGraphIndex : public Nan::ObjectWrap {
+  public:
+    static void InitializeComponent (v8::Local<v8::Object> target, nodegit::Context *nodegitContext);
+
+    // takes ownership of the graph, which must have its generations calculated already
+    static v8::Local<v8::Value> New(CommitsGraph *graph);
+
+    const CommitsGraph *GetValue() const;
+
+    void Reference();
+    void Unreference();
+
+  private:
+    CommitGraphIndex(CommitsGraph *graph);
+    CommitGraphIndex(const CommitGraphIndex &) = delete;
+    CommitGraphIndex(CommitGraphIndex &&) = delete;
+    CommitGraphIndex &operator=(const CommitGraphIndex &) = delete;
+    CommitGraphIndex &operator=(CommitGraphIndex &&) = delete;
+    ~CommitGraphIndex() = default;
+
+    std::unique_ptr<CommitsGraph> graph;
+
+    static NAN_METHOD(JSNewFunction);
+    static NAN_METHOD(Count);
+    static NAN_METHOD(MaxGeneration);
+    static NAN_METHOD(Generation);
+
+    enum class Query { kIsAncestor, kMergeBase };
+
+    struct QueryBaton {
+      Query query;
+      const CommitsGraph *graph;
+      std::vector<std::string> firstOids; // raw oids
+      std::vector<std::string> secondOids; // a single one is paired with all the firstOids
+      std::vector<uint8_t> isAncestor; // kIsAncestor results
+      std::string mergeBases; // kMergeBase results, as raw oids
+    };
+    class QueryWorker : public nodegit::AsyncWorker {
+      public:
+        QueryWorker(
+            QueryBaton *_baton,
+            Nan::Callback *callback
+        ) : nodegit::AsyncWorker(callback, "nodegit:AsyncWorker:CommitGraphIndex:Query")
+          , baton(_baton) {};
+        QueryWorker(const QueryWorker &) = delete;
+        QueryWorker(QueryWorker &&) = delete;
+        QueryWorker &operator=(const QueryWorker &) = delete;
+        QueryWorker &operator=(QueryWorker &&) = delete;
+        ~QueryWorker(){};
+        void Execute();
+        void HandleErrorCallback();
+        void HandleOKCallback();
+        nodegit::LockMaster AcquireLocks();
+
+      private:
+        QueryBaton *baton;
+    };
+
+    static void queueQuery(const Nan::FunctionCallbackInfo<v8::Value> &info, Query query);
+    static NAN_METHOD(IsAncestorBatch);
+    static NAN_METHOD(MergeBaseBatch);
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef COMMIT_SEARCH_H
+#define COMMIT_SEARCH_H
+
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+
+/**
+ * \class CommitSearch
+ * Filters commits as `git log --grep/--author/--committer/--since/--until/--merges` do,
+ * on the raw commit object (as read from the object database), without parsing it into
+ * a git_commit: only the matching commits need to be looked up afterwards.
+ *
+ * Patterns are substrings, or ECMAScript regular expressions. Regular expressions are only
+ * searched in the first 8 KB of each field, or 1 KB when they have back-references, to bound
+ * the time and stack std::regex takes. --author and --committer match "Name <email>", and
+ * dates are compared with the committer date, as git does.
+ * Not thread safe: use one per thread.
+ */
+class CommitSearch
+{
+public:
+  enum class Merges { kAny, kOnly, kNone };
+  enum class Field { kMessage, kAuthor, kCommitter };
+
+  CommitSearch() = default;
+  ~CommitSearch() = default;
+  CommitSearch(const CommitSearch &other) = delete;
+  CommitSearch(CommitSearch &&other) = delete;
+  CommitSearch& operator=(const CommitSearch &other) = delete;
+  CommitSearch& operator=(CommitSearch &&other) = delete;
+
+  // regular expressions are ECMAScript, case insensitive with ignoreCase, with no other flags
+  // \return false, with the reason in *error, if the regular expression is not valid
+  bool SetPattern(Field field, const std::string &pattern, bool isRegex, bool ignoreCase, std::string *error);
+  void SetSince(int64_t seconds) { m_since = seconds; m_hasSince = true; }
+  void SetUntil(int64_t seconds) { m_until = seconds; m_hasUntil = true; }
+  void SetMerges(Merges merges) { m_merges = merges; }
+
+  // \return true if the raw commit object matches all the criteria set
+  bool Matches(const char *data, size_t length);
+
+  // \return the first occurrence of needle in haystack, or nullptr
+  static const char *Find(const char *haystack, size_t haystackLength, const std::string &needle);
+
+private:
+  struct Pattern {
+    bool active {false};
+    bool ignoreCase {false};
+    std::string text {}; // lower case if ignoreCase
+    std::unique_ptr<std::regex> regex {};
+    size_t maxSearchLength {0}; // bytes of the field the regex is searched in
+  };
+
+  bool patternMatches(const Pattern &pattern, const char *begin, const char *end);
+
+  Pattern m_patterns[3] {};
+  bool m_hasSince {false};
+  bool m_hasUntil {false};
+  int64_t m_since {0};
+  int64_t m_until {0};
+  Merges m_merges {Merges::kAny};
+  std::string m_lowerCaseBuffer {};
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef COMMITS_GRAPH_H
+#define COMMITS_GRAPH_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \struct CommitsGraphNode
+ */
+struct CommitsGraphNode
+{
+  CommitsGraphNode(uint32_t aParentsLeft) : parentsLeft(aParentsLeft) {}
+  CommitsGraphNode() = default;
+  ~CommitsGraphNode() = default;
+  CommitsGraphNode(const CommitsGraphNode &other) = delete;
+  CommitsGraphNode(CommitsGraphNode &&other) = delete;
+  CommitsGraphNode& operator=(const CommitsGraphNode &other) = delete;
+  CommitsGraphNode& operator=(CommitsGraphNode &&other) = delete;
+
+  std::vector<CommitsGraphNode *> children {};
+  std::vector<CommitsGraphNode *> parents {};
+  uint32_t parentsLeft {0}; // used when calculating the maximum history depth
+  uint32_t generation {0}; // set when calculating the maximum history depth
+  const std::string *oid {nullptr}; // points to the key of this node in the graph map
+  bool added {false}; // false for parents never added as a node themselves (e.g. shallow clones)
+};
+
+/**
+ * \class CommitsGraph
+ * Graph of commits, keyed by their raw oids (GIT_OID_RAWSZ bytes).
+ * Once all the commits have been added, CalculateMaxDepth() computes the
+ * generation number of every commit: 1 for root commits, and 1 + the maximum
+ * generation of its parents otherwise.
+ */
+class CommitsGraph
+{
+public:
+  static constexpr uint32_t kUnknownGeneration = 0;
+
+  CommitsGraph() = default;
+  ~CommitsGraph() = default;
+  CommitsGraph(const CommitsGraph &other) = delete;
+  CommitsGraph(CommitsGraph &&other) = delete;
+  CommitsGraph& operator=(const CommitsGraph &other) = delete;
+  CommitsGraph& operator=(CommitsGraph &&other) = delete;
+
+  using CommitsGraphMap = std::unordered_map<std::string, std::unique_ptr<CommitsGraphNode>>;
+
+  void AddNode(const std::string &oidStr, const std::vector<std::string> &parents);
+  uint32_t CalculateMaxDepth(std::vector<const std::string *> *orderedOids = nullptr);
+
+  uint32_t GetGeneration(const std::string &oidStr) const;
+  // \return nullptr if the commit is not in the graph
+  const CommitsGraphNode *GetNode(const std::string &oidStr) const;
+
+  /**
+   * Queries on nodes of a graph whose generations have been calculated.
+   * They don't modify the graph, so they can run concurrently.
+   */
+  // \return true if ancestor is descendant or one of its ancestors
+  static bool IsAncestor(const CommitsGraphNode *ancestor, const CommitsGraphNode *descendant);
+  // \return a best common ancestor of both commits (the one with the highest generation
+  // if there are several), or nullptr if they have none
+  static const CommitsGraphNode *MergeBase(const CommitsGraphNode *one, const CommitsGraphNode *two);
+  uint32_t GetMaxDepth() const { return m_maxDepth; }
+  size_t GetNumCommits() const { return m_numCommits; }
+
+private:
+  CommitsGraphNode *addParentNode(const std::string &oidParentStr, CommitsGraphNode *child);
+
+  CommitsGraphMap m_mapOidNode {};
+  std::vector<CommitsGraphNode *> m_roots {};
+  size_t m_numCommits {0};
+  uint32_t m_maxDepth {0};
+};
+
+#endif
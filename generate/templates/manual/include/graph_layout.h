@@ -0,0 +1,83 @@
+#ifndef GRAPH_LAYOUT_H
+#define GRAPH_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+/**
+ * \class GraphLayout
+ * Assigns a lane (column) to each commit of a topologically sorted walk, as history
+ * graphs draw them, and computes the line segments between consecutive rows.
+ *
+ * Each lane waits for one commit: the parent of the commit last drawn on it. A commit is
+ * drawn on the leftmost lane waiting for it, or on a free lane if none is (a branch tip).
+ * Its first parent continues on its lane, and each other parent on the lane already waiting
+ * for it or on a new one.
+ *
+ * The state of the lanes can be saved after a page of commits and restored to lay out the
+ * next page, so a long history can be laid out incrementally.
+ */
+class GraphLayout
+{
+public:
+  enum Markers : uint8_t {
+    kMerge = 1, // more than one parent
+    kFork = 2, // more than one lane joins the commit: it has several children
+    kTip = 4, // no lane was waiting for the commit
+    kRoot = 8 // no parents
+  };
+
+  GraphLayout() = default;
+  ~GraphLayout() = default;
+  GraphLayout(const GraphLayout &other) = delete;
+  GraphLayout(GraphLayout &&other) = delete;
+  GraphLayout& operator=(const GraphLayout &other) = delete;
+  GraphLayout& operator=(GraphLayout &&other) = delete;
+
+  // \return false if the state is not valid
+  bool LoadState(const char *data, size_t length);
+  std::string SaveState() const;
+
+  void AddCommit(const git_oid &oid, const std::vector<git_oid> &parents);
+
+  // Layout of the commits added since the state was loaded:
+  // oid, lane and markers of each row, starting from row GetFirstRow().
+  const std::string &GetOids() const { return m_oids; }
+  const std::vector<uint32_t> &GetLanes() const { return m_rowLanes; }
+  const std::vector<uint8_t> &GetMarkers() const { return m_markers; }
+  // Segments as (fromRow, fromLane, toLane) triples: from (fromRow, fromLane) to (fromRow + 1, toLane).
+  // The first ones can start at GetFirstRow() - 1, coming from the previous page.
+  const std::vector<uint32_t> &GetEdges() const { return m_edges; }
+  uint32_t GetFirstRow() const { return m_firstRow; }
+  // maximum number of lanes used by a row
+  uint32_t GetNumLanes() const { return m_numLanes; }
+
+private:
+  struct Lane {
+    git_oid expected {};
+    bool active {false};
+    bool passThrough {false}; // a line comes from the previous row in this lane
+    bool fromCommit {false}; // a line comes from the commit of the previous row
+  };
+
+  // first lane not in use, other than excludedLane, adding one if needed
+  uint32_t freeLane(uint32_t excludedLane);
+
+  std::vector<Lane> m_lanes {};
+  uint32_t m_nextRow {0};
+  uint32_t m_previousCommitLane {0};
+
+  std::string m_oids {};
+  std::vector<uint32_t> m_rowLanes {};
+  std::vector<uint8_t> m_markers {};
+  std::vector<uint32_t> m_edges {};
+  uint32_t m_firstRow {0};
+  uint32_t m_numLanes {0};
+};
+
+#endif
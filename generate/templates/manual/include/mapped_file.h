@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+extern "C" {
+#include <git2.h>
+}
+
+/**
+ * \class MappedFile
+ * Read-only memory mapping of a whole file.
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { unmap(); }
+  MappedFile(const MappedFile &other) = delete;
+  MappedFile(MappedFile &&other) = delete;
+  MappedFile& operator=(const MappedFile &other) = delete;
+  MappedFile& operator=(MappedFile &&other) = delete;
+
+  // \return GIT_OK, GIT_ENOTFOUND if there is no such file, or -1
+  int Map(const std::string &path);
+  const char *Data() const { return m_data; }
+  size_t Length() const { return m_length; }
+
+private:
+  void unmap();
+
+  const char *m_data {nullptr};
+  size_t m_length {0};
+#ifdef _WIN32
+  HANDLE m_mapping {NULL};
+#endif
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define NODEGIT_WRAPPER_H
 
 #include <algorithm>
+#include <map>
+#include <string>
 #include <unordered_map>
 
 #include "tracker_wrap.h"
@@ -45,6 +47,7 @@ public:
 protected:
   cType *raw;
   std::vector<std::shared_ptr<nodegit::CleanupHandle>> childCleanupVector;
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> namedCleanupHandles;
 
   // owner of the object, in the memory management sense. only populated
   // when using ownedByThis, and the type doesn't have a dupFunction
@@ -78,6 +81,10 @@ public:
 
   void SaveCleanupHandle(std::shared_ptr<nodegit::CleanupHandle> cleanupHandle);
 
+  // kept for the lifetime of this object, by key like nodegit::Context's
+  void SaveCleanupHandle(std::string key, std::shared_ptr<nodegit::CleanupHandle> cleanupHandle);
+  std::shared_ptr<nodegit::CleanupHandle> GetCleanupHandle(std::string key);
+
   void Reference();
   void Unreference();
 
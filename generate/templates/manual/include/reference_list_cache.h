@@ -0,0 +1,64 @@
+#ifndef REFERENCE_LIST_CACHE_H
+#define REFERENCE_LIST_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "cleanup_handle.h"
+
+/**
+ * \class ReferenceListCache
+ * The heads Remote#referenceList returned lately, by remote url and ref prefixes, for clients
+ * polling a remote: while an entry is younger than the ttl they ask for, the heads are copied
+ * from it without reading the remote. Kept by the nodegit::Context, used from the workers.
+ */
+class ReferenceListCache : public nodegit::CleanupHandle
+{
+public:
+  ReferenceListCache() = default;
+  ~ReferenceListCache() = default;
+  ReferenceListCache(const ReferenceListCache &other) = delete;
+  ReferenceListCache(ReferenceListCache &&other) = delete;
+  ReferenceListCache& operator=(const ReferenceListCache &other) = delete;
+  ReferenceListCache& operator=(ReferenceListCache &&other) = delete;
+
+  // \return true with copies of the heads in out, if they were listed less than ttl ms ago
+  bool Get(std::vector<git_remote_head *> *out, const std::string &url, const std::vector<std::string> &prefixes,
+    uint64_t ttl);
+  // keeps copies of the heads
+  void Set(const std::string &url, const std::vector<std::string> &prefixes, const std::vector<git_remote_head *> &heads);
+
+  // \return true if there are no prefixes, or the name starts with one of them
+  static bool MatchesPrefixes(const char *name, const std::vector<std::string> &prefixes);
+
+private:
+  struct Entry {
+    Entry() = default;
+    ~Entry();
+    Entry(const Entry &other) = delete;
+    Entry(Entry &&other) = delete;
+    Entry& operator=(const Entry &other) = delete;
+    Entry& operator=(Entry &&other) = delete;
+
+    uint64_t listedAt {0};  // uv_hrtime(), in ns
+    std::vector<git_remote_head *> heads {};
+  };
+
+  static std::string key(const std::string &url, const std::vector<std::string> &prefixes);
+
+  // the oldest entry is dropped past this
+  static const size_t kMaxEntries = 64;
+
+  std::mutex m_mutex {};
+  std::map<std::string, std::unique_ptr<Entry>> m_entries {};
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef REFERENCE_LISTING_H
+#define REFERENCE_LISTING_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+/**
+ * \class ReferenceListing
+ * Lists the references whose name starts with a prefix, with their targets, in one pass over
+ * the files of the refs backend instead of looking each reference up.
+ *
+ * packed-refs is memory-mapped: when git wrote it sorted, the references under the prefix are
+ * found with a binary search, and the rest of the file is never read. Only the directories of
+ * loose references that can contain the prefix are scanned; loose references take precedence
+ * over packed ones, as in git.
+ */
+class ReferenceListing
+{
+public:
+  struct Reference {
+    std::string name {};
+    git_oid target {}; // the oid a symbolic reference resolves to
+    std::string symbolicTarget {}; // empty for a direct reference
+  };
+
+  /**
+   * Lists the references, sorted by name. Symbolic references are resolved; those that can't
+   * be are left out. prefix must start with "refs/".
+   */
+  static int List(git_repository *repo, const std::string &prefix, std::vector<Reference> *out);
+
+  // adds the references of a packed-refs file whose name starts with prefix
+  static void AddPackedReferences(const char *data, size_t length, const std::string &prefix,
+    std::map<std::string, Reference> *references);
+
+private:
+  // which loose references of a git dir are listed: in a linked worktree, the per-worktree
+  // ones (refs/bisect/...) come from its own git dir and the others from the common dir
+  enum class Scope { kAll, kShared, kPerWorktree };
+
+  static int addLooseReferences(const std::string &gitDir, const std::string &directory,
+    const std::string &prefix, Scope scope, std::map<std::string, Reference> *references);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef REFLOG_READER_H
+#define REFLOG_READER_H
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+/**
+ * \class ReflogReader
+ * Reads the reflog of a reference from the files of the refs backend. The reflog is
+ * memory-mapped and parsed from its end, so reading the newest entries of a long reflog
+ * only touches its tail.
+ */
+class ReflogReader
+{
+public:
+  struct Entry {
+    git_oid oldId {};
+    git_oid newId {};
+    std::string committerName {};
+    std::string committerEmail {};
+    git_time_t time {0}; // seconds since epoch
+    int offset {0}; // timezone offset, in minutes
+    std::string message {};
+  };
+
+  /**
+   * Appends the newest entries of the reflog of name, newest first, at most limit of them
+   * when limit isn't 0. A reference without a reflog has no entries.
+   */
+  static int Read(git_repository *repo, const std::string &name, size_t limit, std::vector<Entry> *out);
+
+  // parses the "<old> <new> <committer> <time> <offset>\t<message>" lines of a reflog from the last one
+  static int Parse(const char *data, size_t length, size_t limit, std::vector<Entry> *out);
+
+private:
+  static bool parseLine(const char *line, const char *end, Entry *entry);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef REMOTE_CACHE_H
+#define REMOTE_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "cleanup_handle.h"
+
+/**
+ * \class RemoteCache
+ * The remotes of a repository, as git_remote_lookup parses them from the configuration,
+ * kept until one of the configuration files changes. getRemotes duplicates them instead
+ * of reading the configuration again.
+ *
+ * A cache is saved on the GitRepository wrapper it's used with, which frees it before the
+ * repository that owns the remotes. The files are checked by modification time and size;
+ * files included with include.path are not checked.
+ */
+class RemoteCache : public nodegit::CleanupHandle
+{
+public:
+  RemoteCache() = default;
+  ~RemoteCache();
+  RemoteCache(const RemoteCache &other) = delete;
+  RemoteCache(RemoteCache &&other) = delete;
+  RemoteCache& operator=(const RemoteCache &other) = delete;
+  RemoteCache& operator=(RemoteCache &&other) = delete;
+
+  // out gets duplicates of the remotes, in the order of git_remote_list, to be freed by the caller.
+  // \return GIT_OK on success; libgit2 error code otherwise, with out left empty.
+  int GetRemotes(std::vector<git_remote *> *out, git_repository *repo);
+
+private:
+  struct FileStamp {
+    std::string path;
+    bool exists;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+    uint64_t size;
+
+    bool operator==(const FileStamp &other) const;
+  };
+
+  static FileStamp stampFile(const std::string &path);
+  static void stampConfigFiles(std::vector<FileStamp> *stamps, git_repository *repo);
+  int load(git_repository *repo);
+  void clear();
+
+  std::mutex m_mutex {};
+  bool m_loaded {false};
+  std::vector<FileStamp> m_stamps {};
+  std::vector<git_remote *> m_remotes {};
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef REPOSITORYWATCHER_H
+#define REPOSITORYWATCHER_H
+#include <nan.h>
+#include <map>
+#include <string>
+#include <uv.h>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "context.h"
+
+using namespace node;
+using namespace v8;
+
+/**
+ * \class RepositoryWatcher
+ * Watches, with libuv fs events, the files of a repository that HEAD, the references, the
+ * index and FETCH_HEAD are stored in, and calls back JS with the kinds of changes once the
+ * events have stopped for a while (git writes several files per command).
+ *
+ * libuv only watches directories recursively on some platforms, so each directory under
+ * refs/ is watched on its own, and the ones created later are added as they appear.
+ * Everything runs on the JS thread.
+ *
+ * new RepositoryWatcher(repository, callback, [options]); options: debounce (ms),
+ * persistent (false not to keep the event loop alive).
+ */
+class RepositoryWatcher : public Nan::ObjectWrap {
+  public:
+    static void InitializeComponent (v8::Local<v8::Object> target, nodegit::Context *nodegitContext);
+
+    enum Changes {
+      kHead = 1,
+      kRefs = 2,
+      kIndex = 4,
+      kFetchHead = 8
+    };
+
+  private:
+    struct WatchedDirectory;
+
+    RepositoryWatcher(const std::string &gitDir, const std::string &commonDir, Nan::Callback *callback,
+      uint64_t debounce, bool persistent);
+    RepositoryWatcher(const RepositoryWatcher &) = delete;
+    RepositoryWatcher(RepositoryWatcher &&) = delete;
+    RepositoryWatcher &operator=(const RepositoryWatcher &) = delete;
+    RepositoryWatcher &operator=(RepositoryWatcher &&) = delete;
+    ~RepositoryWatcher();
+
+    // \return the libuv error if the git dir can't be watched
+    int start(uv_loop_t *loop);
+    void stop();
+
+    // watches the directory (relative to baseDir) and, for refs, its subdirectories
+    int watchDirectory(const std::string &baseDir, const std::string &relativePath, bool isRefs);
+    void unwatchRefsDirectory(const std::string &relativePath);
+    void addChanges(int changes);
+
+    static void onFsEvent(uv_fs_event_t *handle, const char *filename, int events, int status);
+    static void onDebounceTimer(uv_timer_t *timer);
+    static void onEnvironmentCleanup(void *data);
+
+    static NAN_METHOD(JSNewFunction);
+    static NAN_METHOD(Stop);
+    static NAN_METHOD(IsWatching);
+
+    std::string gitDir;
+    std::string commonDir;
+    Nan::Callback *callback;
+    uint64_t debounce;
+    bool persistent;
+    bool watching {false};
+    uv_loop_t *loop {nullptr};
+    v8::Isolate *isolate {nullptr};
+    uv_timer_t *debounceTimer {nullptr};
+    int pendingChanges {0};
+    // by full path; refs directories end with '/' so a directory's subdirectories follow it
+    std::map<std::string, WatchedDirectory *> watchedDirectories;
+};
+
+#endif
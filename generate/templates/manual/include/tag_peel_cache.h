@@ -0,0 +1,67 @@
+#ifndef TAG_PEEL_CACHE_H
+#define TAG_PEEL_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include <git2.h>
+}
+
+#include "cleanup_handle.h"
+#include "context.h"
+
+/**
+ * \class TagPeelCache
+ * What refreshReferences reports about a tag ref's target: the commit it peels to and, for
+ * an annotated tag, its message and signature. Tag objects never change, so they're read
+ * once per repository and kept, keyed by the oid the tag ref points to.
+ *
+ * The caches are kept by the nodegit::Context, one per repository common dir, and are
+ * shared by the workers of all the Repository objects opened on it.
+ */
+class TagPeelCache : public nodegit::CleanupHandle
+{
+public:
+  enum SignatureType {
+    kGpgsig = 0,
+    kX509 = 1
+  };
+
+  struct Tag {
+    git_oid peeledOid;
+    // false for a lightweight tag, or when the tag object can't be read
+    bool hasMessage {false};
+    std::string message {};
+    // the first signature block of the tag object by SignatureType, empty if there's none
+    std::string signatures[2] {};
+  };
+
+  TagPeelCache() = default;
+  ~TagPeelCache() = default;
+  TagPeelCache(const TagPeelCache &other) = delete;
+  TagPeelCache(TagPeelCache &&other) = delete;
+  TagPeelCache& operator=(const TagPeelCache &other) = delete;
+  TagPeelCache& operator=(TagPeelCache &&other) = delete;
+
+  // must be called on the JS thread; a repository without a common dir gets a cache of its own
+  static std::shared_ptr<TagPeelCache> ForRepository(nodegit::Context *nodegitContext, git_repository *repo);
+
+  // \return GIT_OK on success; libgit2 error code if the tag ref can't be peeled to a commit.
+  int Get(std::shared_ptr<const Tag> *out, git_reference *ref, git_odb *odb);
+
+  static std::string FindSignature(const char *data, size_t length, SignatureType signatureType);
+
+private:
+  static int read(std::shared_ptr<const Tag> *out, git_reference *ref, git_odb *odb);
+
+  // about 200 bytes each without the messages; the cache starts over once full
+  static const size_t kMaxTags = 1 << 17;
+
+  std::mutex m_mutex {};
+  std::unordered_map<std::string, std::shared_ptr<const Tag>> m_tags {};
+};
+
+#endif
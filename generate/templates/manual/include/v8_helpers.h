@@ -2,9 +2,20 @@
 #define NODEGIT_V8_HELPERS_H
 
 #include <nan.h>
+#include <vector>
 
 namespace nodegit {
   v8::Local<v8::Value> safeGetField(v8::Local<v8::Object> &containerObj, std::string fieldName);
+
+  // copies the values into a new ArrayBuffer (always aligned), viewed as TypedArray
+  template <class TypedArray, class T>
+  v8::Local<TypedArray> typedArrayFromVector(const std::vector<T> &values) {
+    v8::Local<v8::Uint8Array> bytes = Nan::CopyBuffer(
+      reinterpret_cast<const char *>(values.data()),
+      static_cast<uint32_t>(values.size() * sizeof(T))
+    ).ToLocalChecked().As<v8::Uint8Array>();
+    return TypedArray::New(bytes->Buffer(), bytes->ByteOffset(), values.size());
+  }
 }
 
 #endif
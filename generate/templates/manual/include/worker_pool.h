@@ -1,10 +1,12 @@
 #ifndef WORK_POOL_H
 #define WORK_POOL_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <functional>
 #include <memory>
-#include <queue>
 #include <vector>
 #include <condition_variable>
 #include <mutex>
@@ -52,16 +54,157 @@ public:
 */
 enum class WPStatus {kOk, kInitializeFailed, kExecuteFailed, kShutdownEarly};
 
+/**
+ * \class MPMCBoundedQueue
+ * Lock-free bounded multi-producer multi-consumer queue (Dmitry Vyukov's algorithm).
+ * Each cell has a sequence number telling producers and consumers whether it's their turn
+ * to use it, so that they only contend on a CAS of their own position counter.
+ * T must be trivially copyable (the WorkerPool stores raw pointers).
+ */
+template<class T>
+class MPMCBoundedQueue {
+public:
+  // capacity is rounded up to a power of 2
+  explicit MPMCBoundedQueue(size_t capacity);
+  ~MPMCBoundedQueue() = default;
+  MPMCBoundedQueue(const MPMCBoundedQueue &other) = delete;
+  MPMCBoundedQueue(MPMCBoundedQueue &&other) = delete;
+  MPMCBoundedQueue& operator=(const MPMCBoundedQueue &other) = delete;
+  MPMCBoundedQueue& operator=(MPMCBoundedQueue &&other) = delete;
+
+  // returns false if the queue is full
+  bool TryPush(const T &data);
+  // returns false if the queue is empty
+  bool TryPop(T &data);
+  // approximate if used concurrently: an item being pushed counts already
+  bool Empty() const;
+
+private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static size_t roundUpToPowerOf2(size_t value);
+
+  std::vector<Cell> m_cells;
+  const size_t m_mask;
+  // keep positions in different cache lines, so producers and consumers don't share them
+  alignas(kCacheLineSize) std::atomic<size_t> m_enqueuePos {0};
+  alignas(kCacheLineSize) std::atomic<size_t> m_dequeuePos {0};
+};
+
+template<class T>
+MPMCBoundedQueue<T>::MPMCBoundedQueue(size_t capacity)
+  : m_cells(roundUpToPowerOf2(capacity)), m_mask(m_cells.size() - 1)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+  for (size_t i = 0; i < m_cells.size(); ++i) {
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template<class T>
+size_t MPMCBoundedQueue<T>::roundUpToPowerOf2(size_t value)
+{
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+template<class T>
+bool MPMCBoundedQueue<T>::TryPush(const T &data)
+{
+  Cell *cell {nullptr};
+  size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+  while (true) {
+    cell = &m_cells[pos & m_mask];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+    if (diff == 0) {
+      // cell free for this position: claim it
+      if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      // cell still holds the item from the previous lap
+      return false;
+    }
+    else {
+      // another producer claimed this position
+      pos = m_enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = data;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+template<class T>
+bool MPMCBoundedQueue<T>::TryPop(T &data)
+{
+  Cell *cell {nullptr};
+  size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+
+  while (true) {
+    cell = &m_cells[pos & m_mask];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+    if (diff == 0) {
+      // cell holds an item for this position: claim it
+      if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      // nothing pushed at this position yet
+      return false;
+    }
+    else {
+      // another consumer claimed this position
+      pos = m_dequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  data = cell->data;
+  // free the cell for the producer of the next lap
+  cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+  return true;
+}
+
+template<class T>
+bool MPMCBoundedQueue<T>::Empty() const
+{
+  return m_dequeuePos.load(std::memory_order_acquire) >= m_enqueuePos.load(std::memory_order_acquire);
+}
+
 /**
  * \class WorkerPool
  * To leverage this class, a Worker must inherit from IWorker.
  * WorkItem is an abstract class from which to inherit too.
+ * Work is queued in a lock-free bounded queue: InsertWork() only takes the mutex to wake up
+ * sleeping workers, and yields while the queue is full (backpressure), so that producers
+ * faster than the workers don't accumulate unbounded memory.
+ * NOTE: queueing many small work items is still a cost: prefer items holding a batch of work.
  */
 template<class Worker, class WorkItem>
 class WorkerPool {
 public:
-  WorkerPool();
-  ~WorkerPool() = default;
+  static constexpr size_t kDefaultQueueCapacity = 1024;
+
+  explicit WorkerPool(size_t queueCapacity = kDefaultQueueCapacity);
+  ~WorkerPool();
   WorkerPool(const WorkerPool &other) = delete;
   WorkerPool(WorkerPool &&other) = delete;
   WorkerPool& operator=(const WorkerPool &other) = delete;
@@ -69,26 +212,44 @@ public:
 
   void Init(std::vector< std::shared_ptr<Worker> > workers);
   void InsertWork(std::unique_ptr<WorkItem> &&work);
+  void InsertWork(std::vector< std::unique_ptr<WorkItem> > &&works);
   void Shutdown();
   WPStatus Status() { return m_atomicWPStatus; }
 
 private:
+  bool pushWork(std::unique_ptr<WorkItem> &&work);
+  void wakeUpWorkers(bool all);
   void DoWork(std::shared_ptr<Worker> worker);
-  
-  std::mutex m_mutex {};            // locks m_workQueue and m_stop
+
+  MPMCBoundedQueue<WorkItem *> m_workQueue;  // owns the items queued
+  std::mutex m_mutex {};            // pairs m_condition with the checks of sleeping workers
   std::condition_variable m_condition {};
-  std::queue< std::unique_ptr<WorkItem> > m_workQueue {};
-  bool m_stop {true};               // initially the workpool has no worker threads
+  std::atomic<size_t> m_sleepingWorkers {0};
+  std::atomic<bool> m_stop {true};  // initially the workpool has no worker threads
   std::vector<std::unique_ptr<std::thread>> m_threads {};
   std::atomic<WPStatus> m_atomicWPStatus {WPStatus::kOk};
 };
 
 
 template<class Worker, class WorkItem>
-WorkerPool<Worker,WorkItem>::WorkerPool() {
+WorkerPool<Worker,WorkItem>::WorkerPool(size_t queueCapacity)
+  : m_workQueue(queueCapacity)
+{
   static_assert(std::is_base_of<IWorker, Worker>::value, "Worker must inherit from IWorker");
 }
 
+// waits for the workers, and frees the items not processed if they stopped early
+template<class Worker, class WorkItem>
+WorkerPool<Worker,WorkItem>::~WorkerPool()
+{
+  Shutdown();
+
+  WorkItem *work {nullptr};
+  while (m_workQueue.TryPop(work)) {
+    delete work;
+  }
+}
+
 // launches the worker threads, if they hadn't been launched already
 template<class Worker, class WorkItem>
 void WorkerPool<Worker,WorkItem>::Init(std::vector< std::shared_ptr<Worker> > workers)
@@ -109,15 +270,27 @@ void WorkerPool<Worker,WorkItem>::Init(std::vector< std::shared_ptr<Worker> > wo
 template<class Worker, class WorkItem>
 void WorkerPool<Worker,WorkItem>::InsertWork(std::unique_ptr<WorkItem> &&work)
 {
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_stop) {
-      m_atomicWPStatus = WPStatus::kShutdownEarly;
-      return;
+  if (pushWork(std::move(work))) {
+    wakeUpWorkers(false);
+  }
+}
+
+// queues several work items, waking up workers only once
+template<class Worker, class WorkItem>
+void WorkerPool<Worker,WorkItem>::InsertWork(std::vector< std::unique_ptr<WorkItem> > &&works)
+{
+  bool inserted {false};
+  for (std::unique_ptr<WorkItem> &work : works) {
+    if (!pushWork(std::move(work))) {
+      break;
     }
-    m_workQueue.emplace(std::move(work));
+    inserted = true;
+  }
+  works.clear();
+
+  if (inserted) {
+    wakeUpWorkers(true);
   }
-  m_condition.notify_one();
 }
 
 template<class Worker, class WorkItem>
@@ -139,42 +312,103 @@ void WorkerPool<Worker,WorkItem>::Shutdown()
   });
 }
 
+// pushes work into the queue, yielding while it's full
+// \return false if the work couldn't be queued (and has been freed)
+template<class Worker, class WorkItem>
+bool WorkerPool<Worker,WorkItem>::pushWork(std::unique_ptr<WorkItem> &&work)
+{
+  if (m_stop) {
+    m_atomicWPStatus = WPStatus::kShutdownEarly;
+    return false;
+  }
+
+  WorkItem *rawWork = work.release();
+  while (!m_workQueue.TryPush(rawWork)) {
+    // workers stopped: nobody will make room in the queue
+    if (Status() != WPStatus::kOk) {
+      delete rawWork;
+      return false;
+    }
+    std::this_thread::yield();
+  }
+
+  return true;
+}
+
+// Notifies workers only if there are sleeping ones.
+// The fence pairs with the one in DoWork(): either the producer sees the worker going to sleep,
+// or the worker sees the work just queued and doesn't wait.
+template<class Worker, class WorkItem>
+void WorkerPool<Worker,WorkItem>::wakeUpWorkers(bool all)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_sleepingWorkers.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+
+  // taking the mutex guarantees the worker is already waiting, or hasn't checked the queue yet
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (all) {
+    m_condition.notify_all();
+  }
+  else {
+    m_condition.notify_one();
+  }
+}
+
 template<class Worker, class WorkItem>
 void WorkerPool<Worker,WorkItem>::DoWork(std::shared_ptr<Worker> worker)
 {
+  auto failAndWakeUpOthers = [this](WPStatus status) {
+    m_atomicWPStatus = status;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_condition.notify_all();
+  };
+
   if (!worker->Initialize()) {
-    m_atomicWPStatus = WPStatus::kInitializeFailed;
+    failAndWakeUpOthers(WPStatus::kInitializeFailed);
     return;
   }
 
   while (true) {
-    std::unique_ptr<WorkItem> work {};
-    {
-      std::unique_lock<std::mutex> lock(m_mutex);
-      m_condition.wait(lock, [this] {
-        return this->m_stop || !this->m_workQueue.empty();
-      });
-
-      // stop all workers if any of them failed on Initialize() or Execute()
-      // or the workerPool shutdown early
-      if (Status() != WPStatus::kOk) {
-        return;
-      }
+    // stop all workers if any of them failed on Initialize() or Execute()
+    // or the workerPool shutdown early
+    if (Status() != WPStatus::kOk) {
+      return;
+    }
 
-      if (m_stop && m_workQueue.empty()) {
+    WorkItem *rawWork {nullptr};
+    if (m_workQueue.TryPop(rawWork)) {
+      std::unique_ptr<WorkItem> work {rawWork};
+      if (!worker->Execute(std::move(work))) {
+        failAndWakeUpOthers(WPStatus::kExecuteFailed);
         return;
       }
-      
-      work = std::move(m_workQueue.front());
-      m_workQueue.pop();
+      continue;
     }
-    
-    if (!worker->Execute(std::move(work))) {
-      m_atomicWPStatus = WPStatus::kExecuteFailed;
+
+    // read before checking the queue, so that all the work queued before stopping is seen
+    const bool stop = m_stop;
+
+    // the queue can look not empty while an item is being pushed: retry until it's there
+    if (!m_workQueue.Empty()) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    if (stop) {
       return;
     }
+
+    // nothing to do: sleep until there is work, or the pool stops
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_condition.wait(lock, [this] {
+      return this->m_stop || !this->m_workQueue.Empty() || this->Status() != WPStatus::kOk;
+    });
+    m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
 #endif  // WORK_POOL_H
-
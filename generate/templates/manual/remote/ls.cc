@@ -1,21 +1,65 @@
+#include "../include/functions/free.h"
+#include "../include/reference_list_cache.h"
+
+/**
+ * referenceList([options], callback)
+ * options: prefixes (only the heads whose name starts with one of them) and cacheTtl (ms
+ * during which the same listing of the same url is answered from the cache).
+ * libgit2 only speaks the protocol v0, which advertises all the refs: the prefixes are
+ * applied here, before the heads are copied.
+ */
 NAN_METHOD(GitRemote::ReferenceList)
 {
   if (!info[info.Length() - 1]->IsFunction()) {
     return Nan::ThrowError("Callback is required and must be a Function.");
   }
 
+  std::vector<std::string> *prefixes = new std::vector<std::string>;
+  unsigned int cacheTtl = 0;
+  if (info.Length() > 1 && info[0]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+    v8::Local<v8::Value> jsPrefixes = Nan::Get(options, Nan::New("prefixes").ToLocalChecked()).ToLocalChecked();
+    if (jsPrefixes->IsArray()) {
+      v8::Local<v8::Array> prefixesArray = v8::Local<v8::Array>::Cast(jsPrefixes);
+      for (uint32_t i = 0; i < prefixesArray->Length(); ++i) {
+        v8::Local<v8::Value> prefix = Nan::Get(prefixesArray, i).ToLocalChecked();
+        if (!prefix->IsString()) {
+          delete prefixes;
+          return Nan::ThrowError("Prefixes must be Strings.");
+        }
+        prefixes->push_back(*Nan::Utf8String(prefix));
+      }
+    }
+    v8::Local<v8::Value> jsCacheTtl = Nan::Get(options, Nan::New("cacheTtl").ToLocalChecked()).ToLocalChecked();
+    if (jsCacheTtl->IsNumber()) {
+      cacheTtl = static_cast<unsigned int>(std::max<double>(Nan::To<double>(jsCacheTtl).FromJust(), 0));
+    }
+  }
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  std::shared_ptr<ReferenceListCache> referenceListCache =
+    std::static_pointer_cast<ReferenceListCache>(nodegitContext->GetCleanupHandle("referenceListCache"));
+  if (!referenceListCache) {
+    referenceListCache = std::make_shared<ReferenceListCache>();
+    nodegitContext->SaveCleanupHandle("referenceListCache", referenceListCache);
+  }
+
   ReferenceListBaton* baton = new ReferenceListBaton();
 
   baton->error_code = GIT_OK;
   baton->error = NULL;
+  baton->cache = static_cast<void *>(referenceListCache.get());
+  baton->cache_ttl = cacheTtl;
   baton->out = new std::vector<git_remote_head*>;
+  baton->prefixes = static_cast<void *>(prefixes);
   baton->remote = Nan::ObjectWrap::Unwrap<GitRemote>(info.This())->GetValue();
 
   Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
   std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  // the worker keeps the cache alive
+  cleanupHandles["referenceListCache"] = referenceListCache;
   ReferenceListWorker *worker = new ReferenceListWorker(baton, callback, cleanupHandles);
   worker->Reference<GitRemote>("remote", info.This());
-  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
   nodegitContext->QueueWorker(worker);
   return;
 }
@@ -29,6 +73,13 @@ void GitRemote::ReferenceListWorker::Execute()
 {
   git_error_clear();
 
+  ReferenceListCache *referenceListCache = static_cast<ReferenceListCache *>(baton->cache);
+  std::vector<std::string> *prefixes = static_cast<std::vector<std::string> *>(baton->prefixes);
+  const std::string url = git_remote_url(baton->remote) != NULL ? git_remote_url(baton->remote) : "";
+  if (baton->cache_ttl > 0 && referenceListCache->Get(baton->out, url, *prefixes, baton->cache_ttl)) {
+    return;
+  }
+
   const git_remote_head **remote_heads;
   size_t num_remote_heads;
   baton->error_code = git_remote_ls(
@@ -44,12 +95,21 @@ void GitRemote::ReferenceListWorker::Execute()
     return;
   }
 
-  baton->out->reserve(num_remote_heads);
+  if (prefixes->empty()) {
+    baton->out->reserve(num_remote_heads);
+  }
 
   for (size_t head_index = 0; head_index < num_remote_heads; ++head_index) {
+    if (!ReferenceListCache::MatchesPrefixes(remote_heads[head_index]->name, *prefixes)) {
+      continue;
+    }
     git_remote_head *remote_head = git_remote_head_dup(remote_heads[head_index]);
     baton->out->push_back(remote_head);
   }
+
+  if (baton->cache_ttl > 0) {
+    referenceListCache->Set(url, *prefixes, *baton->out);
+  }
 }
 
 void GitRemote::ReferenceListWorker::HandleErrorCallback() {
@@ -61,13 +121,21 @@ void GitRemote::ReferenceListWorker::HandleErrorCallback() {
     free((void *)baton->error);
   }
 
+  while (baton->out != NULL && baton->out->size()) {
+    git_remote_head_free(baton->out->back());
+    baton->out->pop_back();
+  }
   delete baton->out;
+  delete static_cast<std::vector<std::string> *>(baton->prefixes);
 
   delete baton;
 }
 
 void GitRemote::ReferenceListWorker::HandleOKCallback()
 {
+  delete static_cast<std::vector<std::string> *>(baton->prefixes);
+  baton->prefixes = NULL;
+
   if (baton->out != NULL)
   {
     unsigned int size = baton->out->size();
@@ -0,0 +1,139 @@
+#include "../include/commit_data_source.h"
+#include "../include/commit_graph_index.h"
+
+NAN_METHOD(GitRepository::CommitGraphIndex)
+{
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  CommitGraphIndexBaton* baton = new CommitGraphIndexBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+  baton->out = static_cast<void *>(new CommitsGraph());
+  baton->use_commit_graph = true;
+  if (info.Length() == 2 && info[0]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+    v8::Local<v8::String> propName = Nan::New("useCommitGraph").ToLocalChecked();
+    if (Nan::Has(options, propName).FromJust()) {
+      baton->use_commit_graph = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+    }
+  }
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  CommitGraphIndexWorker *worker = new CommitGraphIndexWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info.This());
+  nodegit::Context *nodegitContext =
+    reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRepository::CommitGraphIndexWorker::AcquireLocks()
+{
+  nodegit::LockMaster lockMaster(true, baton->repo);
+
+  return lockMaster;
+}
+
+void GitRepository::CommitGraphIndexWorker::Execute()
+{
+  git_error_clear();
+
+  CommitsGraph *graph = static_cast<CommitsGraph *>(baton->out);
+
+  // parents are read from the commit-graph file when there is one;
+  // the order doesn't matter: generations are calculated once all the commits are added
+  CommitDataSource commitDataSource(baton->repo, baton->use_commit_graph);
+  std::vector<git_oid> tips {};
+  if ((baton->error_code = commitDataSource.GetReferenceTips(&tips)) == GIT_OK) {
+    baton->error_code = commitDataSource.AddReachableCommitsToGraph(tips, graph);
+  }
+
+  if (baton->error_code != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+
+    delete graph;
+    baton->out = nullptr;
+    return;
+  }
+
+  graph->CalculateMaxDepth();
+}
+
+void GitRepository::CommitGraphIndexWorker::HandleErrorCallback()
+{
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  CommitsGraph *graph = static_cast<CommitsGraph *>(baton->out);
+  if (graph) {
+    delete graph;
+  }
+
+  delete baton;
+}
+
+void GitRepository::CommitGraphIndexWorker::HandleOKCallback()
+{
+  if (baton->out != NULL)
+  {
+    // the index takes ownership of the graph
+    Local<v8::Value> result = ::CommitGraphIndex::New(static_cast<CommitsGraph *>(baton->out));
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method commitGraphIndex has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("GitRepository.commitGraphIndex").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+
+    callback->Call(1, argv, async_resource);
+
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Method commitGraphIndex has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("GitRepository.commitGraphIndex").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -0,0 +1,338 @@
+#include <algorithm>
+
+#include "../include/ahead_behind_batch.h"
+#include "../include/reference_listing.h"
+
+namespace {
+  struct BranchSummary {
+    std::string name;
+    git_oid oid;
+    std::string summary;
+    std::string authorName;
+    git_time_t authorTime {0};
+    git_time_t committerTime {0};
+    std::string upstream; // empty when the branch has no upstream
+    bool hasUpstreamOid {false};
+    git_oid upstreamOid;
+    bool hasAheadBehind {false}; // false when the history needed to count them is missing
+    uint32_t ahead {0};
+    uint32_t behind {0};
+  };
+
+  // most recently committed first, as `git branch --sort=-committerdate`
+  bool isMoreRecent(const BranchSummary &lhs, const BranchSummary &rhs) {
+    if (lhs.committerTime != rhs.committerTime) {
+      return lhs.committerTime > rhs.committerTime;
+    }
+    return lhs.name < rhs.name;
+  }
+
+  // \return GIT_ENOTFOUND if the reference doesn't point to a commit
+  int summarizeCommit(git_repository *repo, BranchSummary *branch) {
+    git_object *target;
+    int error = git_object_lookup(&target, repo, &branch->oid, GIT_OBJECT_ANY);
+    if (error != GIT_OK) {
+      return error;
+    }
+
+    git_object *peeled;
+    error = git_object_peel(&peeled, target, GIT_OBJECT_COMMIT);
+    git_object_free(target);
+    if (error != GIT_OK) {
+      return error == GIT_EINVALIDSPEC || error == GIT_EPEEL ? GIT_ENOTFOUND : error;
+    }
+
+    git_commit *commit = reinterpret_cast<git_commit *>(peeled);
+    git_oid_cpy(&branch->oid, git_commit_id(commit));
+    const char *summary = git_commit_summary(commit);
+    branch->summary = summary != NULL ? summary : "";
+    branch->authorName = git_commit_author(commit)->name;
+    branch->authorTime = git_commit_author(commit)->when.time;
+    branch->committerTime = git_commit_committer(commit)->when.time;
+    git_commit_free(commit);
+    return GIT_OK;
+  }
+
+  // \return GIT_OK without an upstream when the branch doesn't track one
+  int findUpstream(git_repository *repo, BranchSummary *branch) {
+    git_buf upstream = GIT_BUF_INIT_CONST(NULL, 0);
+    int error = git_branch_upstream_name(&upstream, repo, branch->name.c_str());
+    if (error == GIT_ENOTFOUND) {
+      git_error_clear();
+      return GIT_OK;
+    }
+    if (error != GIT_OK) {
+      return error;
+    }
+    branch->upstream.assign(upstream.ptr, upstream.size);
+    git_buf_dispose(&upstream);
+
+    // the upstream may be gone from the remote
+    git_object *target;
+    error = git_revparse_single(&target, repo, (branch->upstream + "^{commit}").c_str());
+    if (error == GIT_ENOTFOUND) {
+      git_error_clear();
+      return GIT_OK;
+    }
+    if (error != GIT_OK) {
+      return error;
+    }
+    git_oid_cpy(&branch->upstreamOid, git_object_id(target));
+    branch->hasUpstreamOid = true;
+    git_object_free(target);
+    return GIT_OK;
+  }
+
+  v8::Local<v8::Value> shaToJavascript(const git_oid &oid) {
+    char sha[GIT_OID_HEXSZ + 1];
+    git_oid_tostr(sha, GIT_OID_HEXSZ + 1, &oid);
+    return Nan::New<String>(sha).ToLocalChecked();
+  }
+}
+
+/**
+ * getBranchSummaries([options], callback)
+ * options: prefix (of the references listed, "refs/heads/" by default), limit (the number of most
+ * recently committed branches returned, all of them by default) and aheadBehind (whether to count
+ * the commits ahead of and behind the upstream of local branches, true by default).
+ */
+NAN_METHOD(GitRepository::GetBranchSummaries)
+{
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  GetBranchSummariesBaton* baton = new GetBranchSummariesBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->ahead_behind = 1;
+  baton->limit = 0;
+  std::string prefix = "refs/heads/";
+  if (info.Length() > 1 && info[0]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+    v8::Local<v8::Value> jsPrefix = Nan::Get(options, Nan::New("prefix").ToLocalChecked()).ToLocalChecked();
+    if (jsPrefix->IsString()) {
+      prefix = *Nan::Utf8String(jsPrefix);
+    }
+    v8::Local<v8::Value> limit = Nan::Get(options, Nan::New("limit").ToLocalChecked()).ToLocalChecked();
+    if (limit->IsNumber()) {
+      baton->limit = static_cast<unsigned int>(std::max<double>(Nan::To<double>(limit).FromJust(), 0));
+    }
+    v8::Local<v8::Value> aheadBehind = Nan::Get(options, Nan::New("aheadBehind").ToLocalChecked()).ToLocalChecked();
+    if (aheadBehind->IsBoolean()) {
+      baton->ahead_behind = aheadBehind->IsTrue() ? 1 : 0;
+    }
+  }
+  baton->out = static_cast<void *>(new std::vector<BranchSummary>);
+  baton->prefix = strdup(prefix.c_str());
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  GetBranchSummariesWorker *worker = new GetBranchSummariesWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info.This());
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRepository::GetBranchSummariesWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, baton->repo);
+  return lockMaster;
+}
+
+/**
+ * GetBranchSummariesWorker::Execute
+ * Every tip commit is read to sort the branches, but the upstreams are only looked up and
+ * counted for the branches returned, all in one AheadBehindBatch walk. When some history is
+ * missing, only the branches that can't be counted have no ahead and behind.
+ */
+void GitRepository::GetBranchSummariesWorker::Execute()
+{
+  git_error_clear();
+
+  std::vector<BranchSummary> *branches = static_cast<std::vector<BranchSummary> *>(baton->out);
+  std::vector<ReferenceListing::Reference> references {};
+  baton->error_code = ReferenceListing::List(baton->repo, baton->prefix, &references);
+
+  if (baton->error_code == GIT_OK) {
+    branches->reserve(references.size());
+    for (const ReferenceListing::Reference &reference : references) {
+      // refs/remotes/<remote>/HEAD only repeats another branch
+      if (!reference.symbolicTarget.empty()) {
+        continue;
+      }
+
+      BranchSummary branch;
+      branch.name = reference.name;
+      git_oid_cpy(&branch.oid, &reference.target);
+      const int error = summarizeCommit(baton->repo, &branch);
+      if (error == GIT_ENOTFOUND) {
+        git_error_clear();
+        continue;
+      }
+      if (error != GIT_OK) {
+        baton->error_code = error;
+        break;
+      }
+      branches->push_back(std::move(branch));
+    }
+  }
+
+  if (baton->error_code == GIT_OK) {
+    if (baton->limit > 0 && baton->limit < branches->size()) {
+      std::partial_sort(branches->begin(), branches->begin() + baton->limit, branches->end(), isMoreRecent);
+      branches->resize(baton->limit);
+    } else {
+      std::sort(branches->begin(), branches->end(), isMoreRecent);
+    }
+  }
+
+  if (baton->error_code == GIT_OK && baton->ahead_behind) {
+    AheadBehindBatch aheadBehind(baton->repo);
+    std::vector<size_t> pairIndexes(branches->size(), SIZE_MAX);
+    for (size_t i = 0; i < branches->size() && baton->error_code == GIT_OK; ++i) {
+      BranchSummary &branch = (*branches)[i];
+      if (branch.name.compare(0, 11, "refs/heads/") != 0) {
+        continue;
+      }
+      baton->error_code = findUpstream(baton->repo, &branch);
+      if (baton->error_code == GIT_OK && branch.hasUpstreamOid) {
+        pairIndexes[i] = aheadBehind.AddPair(branch.oid, branch.upstreamOid);
+      }
+    }
+
+    if (baton->error_code == GIT_OK && aheadBehind.Compute() == GIT_OK) {
+      for (size_t i = 0; i < branches->size(); ++i) {
+        if (pairIndexes[i] != SIZE_MAX) {
+          (*branches)[i].hasAheadBehind = true;
+          (*branches)[i].ahead = aheadBehind.GetAhead()[pairIndexes[i]];
+          (*branches)[i].behind = aheadBehind.GetBehind()[pairIndexes[i]];
+        }
+      }
+    }
+    else if (baton->error_code == GIT_OK) {
+      // some history is missing, as in a shallow clone: find out which branches are affected one by one
+      git_error_clear();
+      for (size_t i = 0; i < branches->size(); ++i) {
+        if (pairIndexes[i] == SIZE_MAX) {
+          continue;
+        }
+        BranchSummary &branch = (*branches)[i];
+        size_t ahead, behind;
+        if (git_graph_ahead_behind(&ahead, &behind, baton->repo, &branch.oid, &branch.upstreamOid) == GIT_OK) {
+          branch.hasAheadBehind = true;
+          branch.ahead = static_cast<uint32_t>(ahead);
+          branch.behind = static_cast<uint32_t>(behind);
+        }
+      }
+      git_error_clear();
+    }
+  }
+
+  if (baton->error_code != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+    delete branches;
+    baton->out = NULL;
+  }
+}
+
+void GitRepository::GetBranchSummariesWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<std::vector<BranchSummary> *>(baton->out);
+  free((void *)baton->prefix);
+
+  delete baton;
+}
+
+void GitRepository::GetBranchSummariesWorker::HandleOKCallback()
+{
+  free((void *)baton->prefix);
+  baton->prefix = NULL;
+
+  if (baton->out != NULL)
+  {
+    std::vector<BranchSummary> *branches = static_cast<std::vector<BranchSummary> *>(baton->out);
+    const unsigned int count = branches->size();
+    v8::Local<v8::Array> result = Nan::New<v8::Array>(count);
+    for (unsigned int i = 0; i < count; ++i) {
+      const BranchSummary &branch = (*branches)[i];
+      v8::Local<v8::Object> jsBranch = Nan::New<Object>();
+      Nan::Set(jsBranch, Nan::New("name").ToLocalChecked(), Nan::New<String>(branch.name).ToLocalChecked());
+      Nan::Set(jsBranch, Nan::New("oid").ToLocalChecked(), shaToJavascript(branch.oid));
+      Nan::Set(jsBranch, Nan::New("summary").ToLocalChecked(), Nan::New<String>(branch.summary).ToLocalChecked());
+      Nan::Set(jsBranch, Nan::New("authorName").ToLocalChecked(), Nan::New<String>(branch.authorName).ToLocalChecked());
+      Nan::Set(jsBranch, Nan::New("authorDate").ToLocalChecked(),
+        Nan::New<Number>(static_cast<double>(branch.authorTime) * 1000));
+      Nan::Set(jsBranch, Nan::New("committerDate").ToLocalChecked(),
+        Nan::New<Number>(static_cast<double>(branch.committerTime) * 1000));
+      if (branch.upstream.empty()) {
+        Nan::Set(jsBranch, Nan::New("upstream").ToLocalChecked(), Nan::Null());
+      } else {
+        Nan::Set(jsBranch, Nan::New("upstream").ToLocalChecked(), Nan::New<String>(branch.upstream).ToLocalChecked());
+      }
+      if (branch.hasAheadBehind) {
+        Nan::Set(jsBranch, Nan::New("ahead").ToLocalChecked(), Nan::New<Number>(branch.ahead));
+        Nan::Set(jsBranch, Nan::New("behind").ToLocalChecked(), Nan::New<Number>(branch.behind));
+      } else {
+        Nan::Set(jsBranch, Nan::New("ahead").ToLocalChecked(), Nan::Null());
+        Nan::Set(jsBranch, Nan::New("behind").ToLocalChecked(), Nan::Null());
+      }
+      Nan::Set(result, Nan::New(i), jsBranch);
+    }
+    delete branches;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method getBranchSummaries has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.getBranchSummaries").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Repository getBranchSummaries has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.getBranchSummaries").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -1,3 +1,10 @@
+#include "../include/remote_cache.h"
+
+/**
+ * getRemotes(callback)
+ * The remotes are parsed from the configuration once per Repository object, and again
+ * only when a configuration file changes.
+ */
 NAN_METHOD(GitRepository::GetRemotes)
 {
   if (!info[info.Length() - 1]->IsFunction()) {
@@ -6,10 +13,20 @@ NAN_METHOD(GitRepository::GetRemotes)
 
   GetRemotesBaton* baton = new GetRemotesBaton();
 
+  GitRepository *repository = Nan::ObjectWrap::Unwrap<GitRepository>(info.This());
+  std::shared_ptr<RemoteCache> remoteCache =
+    std::static_pointer_cast<RemoteCache>(repository->GetCleanupHandle("remoteCache"));
+  if (!remoteCache) {
+    remoteCache = std::make_shared<RemoteCache>();
+    repository->SaveCleanupHandle("remoteCache", remoteCache);
+  }
+
   baton->error_code = GIT_OK;
   baton->error = NULL;
+  // the worker references the repository, which keeps the cache
+  baton->cache = static_cast<void *>(remoteCache.get());
   baton->out = new std::vector<git_remote *>;
-  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+  baton->repo = repository->GetValue();
 
   Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
   std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
@@ -21,7 +38,7 @@ NAN_METHOD(GitRepository::GetRemotes)
 }
 
 nodegit::LockMaster GitRepository::GetRemotesWorker::AcquireLocks() {
-  nodegit::LockMaster lockMaster(true);
+  nodegit::LockMaster lockMaster(true, baton->repo);
   return lockMaster;
 }
 
@@ -29,23 +46,8 @@ void GitRepository::GetRemotesWorker::Execute()
 {
   giterr_clear();
 
-  git_repository *repo;
-  {
-    nodegit::LockMaster lockMaster(true, baton->repo);
-    baton->error_code = git_repository_open(&repo, git_repository_workdir(baton->repo));
-  }
-
-  if (baton->error_code != GIT_OK) {
-    if (giterr_last() != NULL) {
-      baton->error = git_error_dup(giterr_last());
-    }
-    delete baton->out;
-    baton->out = NULL;
-    return;
-  }
-
-  git_strarray remote_names;
-  baton->error_code = git_remote_list(&remote_names, repo);
+  RemoteCache *remoteCache = static_cast<RemoteCache *>(baton->cache);
+  baton->error_code = remoteCache->GetRemotes(baton->out, baton->repo);
 
   if (baton->error_code != GIT_OK) {
     if (giterr_last() != NULL) {
@@ -53,34 +55,6 @@ void GitRepository::GetRemotesWorker::Execute()
     }
     delete baton->out;
     baton->out = NULL;
-    return;
-  }
-
-  for (size_t remote_index = 0; remote_index < remote_names.count; ++remote_index) {
-    git_remote *remote;
-    baton->error_code = git_remote_lookup(&remote, repo, remote_names.strings[remote_index]);
-
-    // stop execution and return if there is an error
-    if (baton->error_code != GIT_OK) {
-      if (giterr_last() != NULL) {
-        baton->error = git_error_dup(giterr_last());
-      }
-
-      // unwind and return
-      while (baton->out->size()) {
-        git_remote *remoteToFree = baton->out->back();
-        baton->out->pop_back();
-        git_remote_free(remoteToFree);
-      }
-
-      git_strarray_free(&remote_names);
-      git_repository_free(repo);
-      delete baton->out;
-      baton->out = NULL;
-      return;
-    }
-
-    baton->out->push_back(remote);
   }
 }
 
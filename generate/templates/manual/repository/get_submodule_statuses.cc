@@ -0,0 +1,344 @@
+#include "../include/worker_pool.h"
+
+namespace {
+  struct SubmoduleStatusEntry {
+    std::string name;
+    std::string path;
+    unsigned int status {0};
+    bool hasHeadId {false};
+    bool hasIndexId {false};
+    bool hasWorkdirId {false};
+    git_oid headId;
+    git_oid indexId;
+    git_oid workdirId;
+    int errorCode {GIT_OK};
+    git_error *error {nullptr};
+  };
+
+  struct SubmoduleStatuses {
+    ~SubmoduleStatuses() {
+      for (SubmoduleStatusEntry &entry : entries) {
+        freeError(entry.error);
+      }
+    }
+
+    static void freeError(git_error *error) {
+      if (error != nullptr) {
+        free((void *)error->message);
+        free((void *)error);
+      }
+    }
+
+    std::vector<SubmoduleStatusEntry> entries;
+  };
+
+  class WorkItemSubmodule : public WorkItem {
+  public:
+    WorkItemSubmodule(size_t index) : m_index(index) {}
+    ~WorkItemSubmodule() = default;
+    WorkItemSubmodule(const WorkItemSubmodule &other) = delete;
+    WorkItemSubmodule(WorkItemSubmodule &&other) = delete;
+    WorkItemSubmodule& operator=(const WorkItemSubmodule &other) = delete;
+    WorkItemSubmodule& operator=(WorkItemSubmodule &&other) = delete;
+
+    size_t GetIndex() const { return m_index; }
+
+  private:
+    size_t m_index {0};
+  };
+
+  /**
+   * \class WorkerSubmoduleStatus
+   * Worker for the WorkPool getting the status of submodules. libgit2 repositories can't be
+   * used by several threads, so each worker opens the parent repository for itself; the
+   * submodule repositories are opened by git_submodule_status as usual. Each submodule
+   * writes its own entry, so workers don't need to synchronize.
+   */
+  class WorkerSubmoduleStatus : public IWorker
+  {
+  public:
+    WorkerSubmoduleStatus(const std::string &repoPath, git_submodule_ignore_t ignore, SubmoduleStatuses *statuses)
+      : m_repoPath(repoPath), m_ignore(ignore), m_statuses(statuses) {}
+    ~WorkerSubmoduleStatus() {
+      git_repository_free(m_repo);
+      SubmoduleStatuses::freeError(m_openError);
+    }
+    WorkerSubmoduleStatus(const WorkerSubmoduleStatus &other) = delete;
+    WorkerSubmoduleStatus(WorkerSubmoduleStatus &&other) = delete;
+    WorkerSubmoduleStatus& operator=(const WorkerSubmoduleStatus &other) = delete;
+    WorkerSubmoduleStatus& operator=(WorkerSubmoduleStatus &&other) = delete;
+
+    bool Initialize() {
+      m_openErrorCode = git_repository_open_ext(&m_repo, m_repoPath.c_str(), GIT_REPOSITORY_OPEN_NO_SEARCH, NULL);
+      if (m_openErrorCode != GIT_OK) {
+        m_repo = nullptr;
+        if (git_error_last() != NULL) {
+          m_openError = git_error_dup(git_error_last());
+        }
+        return false;
+      }
+      return true;
+    }
+
+    bool Execute(std::unique_ptr<WorkItem> &&work) {
+      std::unique_ptr<WorkItemSubmodule> wi {static_cast<WorkItemSubmodule *>(work.release())};
+      SubmoduleStatusEntry &entry = m_statuses->entries[wi->GetIndex()];
+
+      git_error_clear();
+      entry.errorCode = getStatus(&entry);
+      if (entry.errorCode != GIT_OK && git_error_last() != NULL) {
+        entry.error = git_error_dup(git_error_last());
+      }
+      return true;
+    }
+
+    // \return the error of the worker that couldn't open the repository, if there was one
+    int GetOpenError(git_error **error) {
+      *error = m_openError;
+      m_openError = nullptr;
+      return m_openErrorCode;
+    }
+
+  private:
+    int getStatus(SubmoduleStatusEntry *entry) {
+      git_submodule *submodule;
+      int error = git_submodule_lookup(&submodule, m_repo, entry->name.c_str());
+      if (error != GIT_OK) {
+        return error;
+      }
+
+      error = git_submodule_status(&entry->status, m_repo, entry->name.c_str(), m_ignore);
+      if (error == GIT_OK) {
+        entry->path = git_submodule_path(submodule);
+        copyOid(&entry->headId, &entry->hasHeadId, git_submodule_head_id(submodule));
+        copyOid(&entry->indexId, &entry->hasIndexId, git_submodule_index_id(submodule));
+        if (entry->status & GIT_SUBMODULE_STATUS_IN_WD) {
+          copyOid(&entry->workdirId, &entry->hasWorkdirId, git_submodule_wd_id(submodule));
+          // an uninitialized submodule has no id
+          git_error_clear();
+        }
+      }
+
+      git_submodule_free(submodule);
+      return error;
+    }
+
+    static void copyOid(git_oid *out, bool *hasOid, const git_oid *oid) {
+      *hasOid = oid != NULL;
+      if (oid != NULL) {
+        git_oid_cpy(out, oid);
+      }
+    }
+
+    std::string m_repoPath;
+    git_submodule_ignore_t m_ignore;
+    SubmoduleStatuses *m_statuses {nullptr};
+    git_repository *m_repo {nullptr};
+    int m_openErrorCode {GIT_OK};
+    git_error *m_openError {nullptr};
+  };
+
+  int collectSubmoduleNameCB(git_submodule *submodule, const char *name, void *payload) {
+    SubmoduleStatusEntry entry;
+    entry.name = name;
+    static_cast<SubmoduleStatuses *>(payload)->entries.push_back(std::move(entry));
+    return GIT_OK;
+  }
+
+  v8::Local<v8::Value> oidToJavascript(const git_oid &oid, bool hasOid) {
+    if (!hasOid) {
+      return Nan::Null();
+    }
+
+    char sha[GIT_OID_HEXSZ + 1];
+    git_oid_tostr(sha, GIT_OID_HEXSZ + 1, &oid);
+    return Nan::New<String>(sha).ToLocalChecked();
+  }
+}
+
+/**
+ * getSubmoduleStatuses([options], callback)
+ * options: ignore (Submodule.IGNORE, the configuration of each submodule by default) and
+ * concurrency (the number of submodules inspected at a time, the number of CPUs by default).
+ */
+NAN_METHOD(GitRepository::GetSubmoduleStatuses)
+{
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  GetSubmoduleStatusesBaton* baton = new GetSubmoduleStatusesBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->concurrency = 0;
+  baton->ignore = GIT_SUBMODULE_IGNORE_UNSPECIFIED;
+  if (info.Length() > 1 && info[0]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+    v8::Local<v8::Value> concurrency = Nan::Get(options, Nan::New("concurrency").ToLocalChecked()).ToLocalChecked();
+    if (concurrency->IsNumber()) {
+      baton->concurrency = static_cast<unsigned int>(std::max<double>(Nan::To<double>(concurrency).FromJust(), 0));
+    }
+    v8::Local<v8::Value> ignore = Nan::Get(options, Nan::New("ignore").ToLocalChecked()).ToLocalChecked();
+    if (ignore->IsNumber()) {
+      baton->ignore = Nan::To<int32_t>(ignore).FromJust();
+    }
+  }
+  baton->out = static_cast<void *>(new SubmoduleStatuses());
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  GetSubmoduleStatusesWorker *worker = new GetSubmoduleStatusesWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info.This());
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRepository::GetSubmoduleStatusesWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, baton->repo);
+  return lockMaster;
+}
+
+void GitRepository::GetSubmoduleStatusesWorker::Execute()
+{
+  git_error_clear();
+
+  SubmoduleStatuses *statuses = static_cast<SubmoduleStatuses *>(baton->out);
+  baton->error_code = git_submodule_foreach(baton->repo, collectSubmoduleNameCB, static_cast<void *>(statuses));
+
+  const size_t numSubmodules = statuses->entries.size();
+  if (baton->error_code == GIT_OK && numSubmodules > 0) {
+    const char *repoPath = git_repository_workdir(baton->repo) != NULL
+      ? git_repository_workdir(baton->repo)
+      : git_repository_path(baton->repo);
+    const unsigned int concurrency = baton->concurrency > 0
+      ? baton->concurrency
+      : std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    const size_t numWorkers = std::min<size_t>(concurrency, numSubmodules);
+
+    std::vector< std::shared_ptr<WorkerSubmoduleStatus> > workers {};
+    for (size_t i = 0; i < numWorkers; ++i) {
+      workers.emplace_back(std::make_shared<WorkerSubmoduleStatus>(
+        repoPath, static_cast<git_submodule_ignore_t>(baton->ignore), statuses));
+    }
+
+    WorkerPool<WorkerSubmoduleStatus, WorkItemSubmodule> workerPool {};
+    workerPool.Init(workers);
+    for (size_t i = 0; i < numSubmodules; ++i) {
+      workerPool.InsertWork(std::make_unique<WorkItemSubmodule>(i));
+    }
+    workerPool.Shutdown();
+
+    if (workerPool.Status() != WPStatus::kOk) {
+      baton->error_code = GIT_ERROR;
+      for (std::shared_ptr<WorkerSubmoduleStatus> &worker : workers) {
+        git_error *openError;
+        int openErrorCode = worker->GetOpenError(&openError);
+        if (openErrorCode != GIT_OK) {
+          baton->error_code = openErrorCode;
+          baton->error = openError;
+          break;
+        }
+      }
+    } else {
+      // the first submodule that failed, as a serial walk would
+      for (SubmoduleStatusEntry &entry : statuses->entries) {
+        if (entry.errorCode != GIT_OK) {
+          baton->error_code = entry.errorCode;
+          baton->error = entry.error;
+          entry.error = nullptr;
+          break;
+        }
+      }
+    }
+  }
+
+  if (baton->error_code != GIT_OK) {
+    if (baton->error == NULL && git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+    delete statuses;
+    baton->out = NULL;
+  }
+}
+
+void GitRepository::GetSubmoduleStatusesWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<SubmoduleStatuses *>(baton->out);
+
+  delete baton;
+}
+
+void GitRepository::GetSubmoduleStatusesWorker::HandleOKCallback()
+{
+  if (baton->out != NULL)
+  {
+    SubmoduleStatuses *statuses = static_cast<SubmoduleStatuses *>(baton->out);
+    const unsigned int count = statuses->entries.size();
+    v8::Local<v8::Array> result = Nan::New<v8::Array>(count);
+    for (unsigned int i = 0; i < count; ++i) {
+      const SubmoduleStatusEntry &entry = statuses->entries[i];
+      v8::Local<v8::Object> jsEntry = Nan::New<Object>();
+      Nan::Set(jsEntry, Nan::New("name").ToLocalChecked(), Nan::New<String>(entry.name).ToLocalChecked());
+      Nan::Set(jsEntry, Nan::New("path").ToLocalChecked(), Nan::New<String>(entry.path).ToLocalChecked());
+      Nan::Set(jsEntry, Nan::New("status").ToLocalChecked(), Nan::New<Number>(entry.status));
+      Nan::Set(jsEntry, Nan::New("headId").ToLocalChecked(), oidToJavascript(entry.headId, entry.hasHeadId));
+      Nan::Set(jsEntry, Nan::New("indexId").ToLocalChecked(), oidToJavascript(entry.indexId, entry.hasIndexId));
+      Nan::Set(jsEntry, Nan::New("workdirId").ToLocalChecked(), oidToJavascript(entry.workdirId, entry.hasWorkdirId));
+      Nan::Set(result, Nan::New(i), jsEntry);
+    }
+    delete statuses;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method getSubmoduleStatuses has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.getSubmoduleStatuses").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Repository getSubmoduleStatuses has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.getSubmoduleStatuses").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
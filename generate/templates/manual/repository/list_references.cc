@@ -0,0 +1,143 @@
+#include "../include/reference_listing.h"
+
+NAN_METHOD(GitRepository::ListReferences)
+{
+  if (info.Length() == 0 || !info[0]->IsString()) {
+    return Nan::ThrowError("Prefix is required and must be a String.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  ListReferencesBaton* baton = new ListReferencesBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->out = static_cast<void *>(new std::vector<ReferenceListing::Reference>);
+  Nan::Utf8String from_js_prefix(Nan::To<v8::String>(info[0]).ToLocalChecked());
+  baton->prefix = strdup(*from_js_prefix);
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  ListReferencesWorker *worker = new ListReferencesWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info.This());
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRepository::ListReferencesWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, baton->repo);
+  return lockMaster;
+}
+
+void GitRepository::ListReferencesWorker::Execute()
+{
+  git_error_clear();
+
+  std::vector<ReferenceListing::Reference> *references =
+    static_cast<std::vector<ReferenceListing::Reference> *>(baton->out);
+  baton->error_code = ReferenceListing::List(baton->repo, baton->prefix, references);
+
+  if (baton->error_code != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+    delete references;
+    baton->out = NULL;
+  }
+}
+
+void GitRepository::ListReferencesWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<std::vector<ReferenceListing::Reference> *>(baton->out);
+  free((void *)baton->prefix);
+
+  delete baton;
+}
+
+void GitRepository::ListReferencesWorker::HandleOKCallback()
+{
+  free((void *)baton->prefix);
+  baton->prefix = NULL;
+
+  if (baton->out != NULL)
+  {
+    std::vector<ReferenceListing::Reference> *references =
+      static_cast<std::vector<ReferenceListing::Reference> *>(baton->out);
+    const unsigned int count = references->size();
+    v8::Local<v8::Array> names = Nan::New<v8::Array>(count);
+    v8::Local<v8::Array> symbolicTargets = Nan::New<v8::Array>(count);
+    v8::Local<v8::Object> targets = Nan::NewBuffer(count * GIT_OID_RAWSZ).ToLocalChecked();
+    char *targetsData = node::Buffer::Data(targets);
+    for (unsigned int i = 0; i < count; ++i) {
+      const ReferenceListing::Reference &reference = (*references)[i];
+      Nan::Set(names, Nan::New(i), Nan::New<String>(reference.name).ToLocalChecked());
+      if (reference.symbolicTarget.empty()) {
+        Nan::Set(symbolicTargets, Nan::New(i), Nan::Null());
+      } else {
+        Nan::Set(symbolicTargets, Nan::New(i), Nan::New<String>(reference.symbolicTarget).ToLocalChecked());
+      }
+      memcpy(targetsData + static_cast<size_t>(i) * GIT_OID_RAWSZ, reference.target.id, GIT_OID_RAWSZ);
+    }
+    delete references;
+
+    v8::Local<v8::Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New("count").ToLocalChecked(), Nan::New<Number>(count));
+    Nan::Set(result, Nan::New("names").ToLocalChecked(), names);
+    Nan::Set(result, Nan::New("targets").ToLocalChecked(), targets);
+    Nan::Set(result, Nan::New("symbolicTargets").ToLocalChecked(), symbolicTargets);
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method listReferences has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.listReferences").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Repository listReferences has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.listReferences").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -0,0 +1,246 @@
+#include <unordered_map>
+
+#include "../include/reflog_reader.h"
+#include "../include/v8_helpers.h"
+
+namespace {
+  /**
+   * \class ReflogColumns
+   * The reflogs of several references stored by columns, so that JS can read them without
+   * creating an object per entry:
+   * - refOffsets: the entries of reference i are refOffsets[i]..refOffsets[i + 1], newest first.
+   * - oldIds and newIds: raw oids (GIT_OID_RAWSZ bytes each), one after another.
+   * - times: milliseconds since epoch; timezoneOffsets: in minutes.
+   * - committerIndexes and messageIndexes: positions in the committers and messages tables,
+   *   in which each distinct committer and message appears once.
+   */
+  class ReflogColumns {
+  public:
+    ReflogColumns() {
+      refOffsets.push_back(0);
+    }
+
+    ReflogColumns(const ReflogColumns &) = delete;
+    ReflogColumns(ReflogColumns &&) = delete;
+    ReflogColumns &operator=(const ReflogColumns &) = delete;
+    ReflogColumns &operator=(ReflogColumns &&) = delete;
+    ~ReflogColumns() = default;
+
+    void append(const std::vector<ReflogReader::Entry> &entries) {
+      for (const ReflogReader::Entry &entry : entries) {
+        oldIds.append(reinterpret_cast<const char *>(entry.oldId.id), GIT_OID_RAWSZ);
+        newIds.append(reinterpret_cast<const char *>(entry.newId.id), GIT_OID_RAWSZ);
+        times.push_back(static_cast<double>(entry.time) * 1000);
+        timezoneOffsets.push_back(entry.offset);
+        committerIndexes.push_back(indexOf(entry.committerName + '\0' + entry.committerEmail, &committerTable, &committers));
+        messageIndexes.push_back(indexOf(entry.message, &messageTable, &messages));
+      }
+      refOffsets.push_back(static_cast<uint32_t>(times.size()));
+    }
+
+    v8::Local<v8::Object> toJavascript() const {
+      v8::Local<v8::Array> jsCommitters = Nan::New<v8::Array>(committers.size());
+      for (uint32_t i = 0; i < committers.size(); ++i) {
+        const size_t separator = committers[i].find('\0');
+        v8::Local<v8::Object> committer = Nan::New<v8::Object>();
+        Nan::Set(committer, Nan::New("name").ToLocalChecked(),
+          Nan::New(committers[i].substr(0, separator)).ToLocalChecked());
+        Nan::Set(committer, Nan::New("email").ToLocalChecked(),
+          Nan::New(committers[i].substr(separator + 1)).ToLocalChecked());
+        Nan::Set(jsCommitters, i, committer);
+      }
+
+      v8::Local<v8::Array> jsMessages = Nan::New<v8::Array>(messages.size());
+      for (uint32_t i = 0; i < messages.size(); ++i) {
+        Nan::Set(jsMessages, i, Nan::New(messages[i]).ToLocalChecked());
+      }
+
+      v8::Local<v8::Object> result = Nan::New<v8::Object>();
+      Nan::Set(result, Nan::New("count").ToLocalChecked(), Nan::New<v8::Number>(times.size()));
+      Nan::Set(result, Nan::New("refOffsets").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Uint32Array>(refOffsets));
+      Nan::Set(result, Nan::New("oldIds").ToLocalChecked(), Nan::CopyBuffer(oldIds.data(), oldIds.size()).ToLocalChecked());
+      Nan::Set(result, Nan::New("newIds").ToLocalChecked(), Nan::CopyBuffer(newIds.data(), newIds.size()).ToLocalChecked());
+      Nan::Set(result, Nan::New("times").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Float64Array>(times));
+      Nan::Set(result, Nan::New("timezoneOffsets").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Int32Array>(timezoneOffsets));
+      Nan::Set(result, Nan::New("committerIndexes").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Uint32Array>(committerIndexes));
+      Nan::Set(result, Nan::New("committers").ToLocalChecked(), jsCommitters);
+      Nan::Set(result, Nan::New("messageIndexes").ToLocalChecked(), nodegit::typedArrayFromVector<v8::Uint32Array>(messageIndexes));
+      Nan::Set(result, Nan::New("messages").ToLocalChecked(), jsMessages);
+      return result;
+    }
+
+  private:
+    static uint32_t indexOf(const std::string &value, std::unordered_map<std::string, uint32_t> *table,
+      std::vector<std::string> *values)
+    {
+      auto inserted = table->emplace(value, static_cast<uint32_t>(values->size()));
+      if (inserted.second) {
+        values->push_back(value);
+      }
+      return inserted.first->second;
+    }
+
+    std::vector<uint32_t> refOffsets;
+    std::string oldIds;
+    std::string newIds;
+    std::vector<double> times;
+    std::vector<int32_t> timezoneOffsets;
+    std::vector<uint32_t> committerIndexes;
+    std::unordered_map<std::string, uint32_t> committerTable;
+    std::vector<std::string> committers;
+    std::vector<uint32_t> messageIndexes;
+    std::unordered_map<std::string, uint32_t> messageTable;
+    std::vector<std::string> messages;
+  };
+}
+
+/**
+ * readReflogs(names, [options], callback)
+ * options: limit (the number of newest entries read from each reflog, all of them by default).
+ */
+NAN_METHOD(GitRepository::ReadReflogs)
+{
+  if (info.Length() == 0 || !info[0]->IsArray()) {
+    return Nan::ThrowError("Array names is required.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  std::vector<std::string> *names = new std::vector<std::string>;
+  v8::Local<v8::Array> namesArray = v8::Local<v8::Array>::Cast(info[0]);
+  for (uint32_t i = 0; i < namesArray->Length(); ++i) {
+    v8::Local<v8::Value> name = Nan::Get(namesArray, i).ToLocalChecked();
+    if (!name->IsString()) {
+      delete names;
+      return Nan::ThrowError("Names must be Strings.");
+    }
+    names->push_back(*Nan::Utf8String(name));
+  }
+
+  ReadReflogsBaton* baton = new ReadReflogsBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->limit = 0;
+  if (info.Length() > 2 && info[1]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+    v8::Local<v8::Value> limit = Nan::Get(options, Nan::New("limit").ToLocalChecked()).ToLocalChecked();
+    if (limit->IsNumber()) {
+      baton->limit = static_cast<unsigned int>(std::max<double>(Nan::To<double>(limit).FromJust(), 0));
+    }
+  }
+  baton->names = static_cast<void *>(names);
+  baton->out = static_cast<void *>(new ReflogColumns());
+  baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  ReadReflogsWorker *worker = new ReadReflogsWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRepository>("repo", info.This());
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRepository::ReadReflogsWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, baton->repo);
+  return lockMaster;
+}
+
+void GitRepository::ReadReflogsWorker::Execute()
+{
+  git_error_clear();
+
+  std::vector<std::string> *names = static_cast<std::vector<std::string> *>(baton->names);
+  ReflogColumns *columns = static_cast<ReflogColumns *>(baton->out);
+  std::vector<ReflogReader::Entry> entries {};
+  for (const std::string &name : *names) {
+    entries.clear();
+    baton->error_code = ReflogReader::Read(baton->repo, name, baton->limit, &entries);
+    if (baton->error_code != GIT_OK) {
+      break;
+    }
+    columns->append(entries);
+  }
+
+  delete names;
+  baton->names = NULL;
+
+  if (baton->error_code != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+    delete columns;
+    baton->out = NULL;
+  }
+}
+
+void GitRepository::ReadReflogsWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<std::vector<std::string> *>(baton->names);
+  delete static_cast<ReflogColumns *>(baton->out);
+
+  delete baton;
+}
+
+void GitRepository::ReadReflogsWorker::HandleOKCallback()
+{
+  if (baton->out != NULL)
+  {
+    ReflogColumns *columns = static_cast<ReflogColumns *>(baton->out);
+    v8::Local<v8::Object> result = columns->toJavascript();
+    delete columns;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error)
+  {
+    Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method readReflogs has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.readReflogs").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0)
+  {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Repository readReflogs has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Repository.readReflogs").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else
+  {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -1,3 +1,9 @@
+#include <map>
+#include <string>
+
+#include "../include/ahead_behind_batch.h"
+#include "../include/tag_peel_cache.h"
+
 int getOidOfReferenceCommit(git_oid *commitOid, git_reference *ref) {
   git_object *commitObject;
   int result = git_reference_peel(&commitObject, ref, GIT_OBJ_COMMIT);
@@ -67,11 +73,8 @@ class RefreshedRefModel {
 public:
   RefreshedRefModel(git_reference *ref):
     fullName(strdup(git_reference_name(ref))),
-    message(NULL),
     sha(new char[GIT_OID_HEXSZ + 1]),
     shorthand(strdup(git_reference_shorthand(ref))),
-    tagOdbBuffer(NULL),
-    tagOdbBufferLength(0),
     type(NULL)
   {
     if (git_reference_is_branch(ref)) {
@@ -88,7 +91,8 @@ public:
   RefreshedRefModel &operator=(const RefreshedRefModel &) = delete;
   RefreshedRefModel &operator=(RefreshedRefModel &&) = delete;
 
-  static int fromReference(RefreshedRefModel **out, git_reference *ref, git_odb *odb) {
+  // tags are read from the cache, which reads them once
+  static int fromReference(RefreshedRefModel **out, git_reference *ref, git_odb *odb, TagPeelCache *tagPeelCache) {
     RefreshedRefModel *refModel = new RefreshedRefModel(ref);
     const git_oid *referencedTargetOid = git_reference_target(ref);
 
@@ -98,80 +102,20 @@ public:
       *out = refModel;
       return GIT_OK;
     }
-    git_repository *repo = git_reference_owner(ref);
-
-    git_tag *referencedTag;
-    if (git_tag_lookup(&referencedTag, repo, referencedTargetOid) == GIT_OK) {
-      const char *tagMessage = git_tag_message(referencedTag);
-      refModel->message = tagMessage ? strdup(tagMessage) : NULL;
-
-      git_odb_object *tagOdbObject;
-      if (git_odb_read(&tagOdbObject, odb, git_tag_id(referencedTag)) == GIT_OK) {
-        refModel->tagOdbBufferLength = git_odb_object_size(tagOdbObject);
-        refModel->tagOdbBuffer = new char[refModel->tagOdbBufferLength];
-        std::memcpy(refModel->tagOdbBuffer, git_odb_object_data(tagOdbObject), refModel->tagOdbBufferLength);
-        git_odb_object_free(tagOdbObject);
-      }
 
-      git_tag_free(referencedTag);
-    }
-
-    git_oid peeledReferencedTargetOid;
-    int error = getOidOfReferenceCommit(&peeledReferencedTargetOid, ref);
+    int error = tagPeelCache->Get(&refModel->tag, ref, odb);
     if (error != GIT_OK) {
       delete refModel;
       return error;
     }
 
-    git_oid_tostr(refModel->sha, GIT_OID_HEXSZ + 1, &peeledReferencedTargetOid);
+    git_oid_tostr(refModel->sha, GIT_OID_HEXSZ + 1, &refModel->tag->peeledOid);
 
     *out = refModel;
     return GIT_OK;
   }
 
-  static void ensureSignatureRegexes() {
-    if (!signatureRegexesBySignatureType.IsEmpty()) {
-      return;
-    }
-
-    v8::Local<v8::Array> gpgsigArray = Nan::New<v8::Array>(2),
-      x509Array = Nan::New<v8::Array>(1);
-
-    Nan::Set(
-      gpgsigArray,
-      Nan::New<Number>(0),
-      Nan::New<v8::RegExp>(
-        Nan::New("-----BEGIN PGP SIGNATURE-----[\\s\\S]+?-----END PGP SIGNATURE-----").ToLocalChecked(),
-        static_cast<v8::RegExp::Flags>(v8::RegExp::Flags::kGlobal | v8::RegExp::Flags::kMultiline)
-      ).ToLocalChecked()
-    );
-
-    Nan::Set(
-      gpgsigArray,
-      Nan::New<Number>(1),
-      Nan::New<v8::RegExp>(
-        Nan::New("-----BEGIN PGP MESSAGE-----[\\s\\S]+?-----END PGP MESSAGE-----").ToLocalChecked(),
-        static_cast<v8::RegExp::Flags>(v8::RegExp::Flags::kGlobal | v8::RegExp::Flags::kMultiline)
-      ).ToLocalChecked()
-    );
-
-    Nan::Set(
-      x509Array,
-      Nan::New<Number>(0),
-      Nan::New<v8::RegExp>(
-        Nan::New("-----BEGIN SIGNED MESSAGE-----[\\s\\S]+?-----END SIGNED MESSAGE-----").ToLocalChecked(),
-        static_cast<v8::RegExp::Flags>(v8::RegExp::Flags::kGlobal | v8::RegExp::Flags::kMultiline)
-      ).ToLocalChecked()
-    );
-
-    v8::Local<v8::Object> result = Nan::New<Object>();
-    Nan::Set(result, Nan::New("gpgsig").ToLocalChecked(), gpgsigArray);
-    Nan::Set(result, Nan::New("x509").ToLocalChecked(), x509Array);
-
-    signatureRegexesBySignatureType.Reset(result);
-  }
-
-  v8::Local<v8::Object> toJavascript(v8::Local<v8::String> signatureType) {
+  v8::Local<v8::Object> toJavascript(TagPeelCache::SignatureType signatureType) {
     v8::Local<v8::Object> result = Nan::New<Object>();
 
     v8::Local<v8::Value> jsFullName;
@@ -183,10 +127,10 @@ public:
     Nan::Set(result, Nan::New("fullName").ToLocalChecked(), jsFullName);
 
     v8::Local<v8::Value> jsMessage;
-    if (message == NULL) {
+    if (!tag || !tag->hasMessage) {
       jsMessage = Nan::Null();
     } else {
-      jsMessage = Nan::New<String>(message).ToLocalChecked();
+      jsMessage = Nan::New<String>(tag->message).ToLocalChecked();
     }
     Nan::Set(result, Nan::New("message").ToLocalChecked(), jsMessage);
 
@@ -205,30 +149,8 @@ public:
     Nan::Set(result, Nan::New("shorthand").ToLocalChecked(), jsShorthand);
 
     v8::Local<v8::Value> jsTagSignature = Nan::Null();
-    if (tagOdbBuffer != NULL && tagOdbBufferLength != 0) {
-      // tagOdbBuffer is already a copy, so we'd like to use NewBuffer instead,
-      // but we were getting segfaults and couldn't easily figure out why. :(
-      // We tried passing the tagOdbBuffer directly to NewBuffer and then nullifying tagOdbBuffer so that
-      // the destructor didn't double free, but that still segfaulted internally in Node.
-      v8::Local<v8::Object> buffer = Nan::CopyBuffer(tagOdbBuffer, tagOdbBufferLength).ToLocalChecked();
-      v8::Local<v8::Value> toStringProp = Nan::Get(buffer, Nan::New("toString").ToLocalChecked()).ToLocalChecked();
-      v8::Local<v8::Object> jsTagOdbObjectString = Nan::To<v8::Object>(Nan::CallAsFunction(Nan::To<v8::Object>(toStringProp).ToLocalChecked(), buffer, 0, NULL).ToLocalChecked()).ToLocalChecked();
-
-      v8::Local<v8::Object> _signatureRegexesBySignatureType = Nan::New(signatureRegexesBySignatureType);
-      v8::Local<v8::Array> signatureRegexes = v8::Local<v8::Array>::Cast(Nan::Get(_signatureRegexesBySignatureType, signatureType).ToLocalChecked());
-
-      for (uint32_t i = 0; i < signatureRegexes->Length(); ++i) {
-        v8::Local<v8::Value> argv[] = {
-          Nan::Get(signatureRegexes, Nan::New(i)).ToLocalChecked()
-        };
-
-        v8::Local<v8::Value> matchProp = Nan::Get(jsTagOdbObjectString, Nan::New("match").ToLocalChecked()).ToLocalChecked();
-        v8::Local<v8::Value> match = Nan::CallAsFunction(Nan::To<v8::Object>(matchProp).ToLocalChecked(), jsTagOdbObjectString, 1, argv).ToLocalChecked();
-        if (match->IsArray()) {
-          jsTagSignature = Nan::Get(Nan::To<v8::Object>(match).ToLocalChecked(), 0).ToLocalChecked();
-          break;
-        }
-      }
+    if (tag && !tag->signatures[signatureType].empty()) {
+      jsTagSignature = Nan::New<String>(tag->signatures[signatureType]).ToLocalChecked();
     }
     Nan::Set(result, Nan::New("tagSignature").ToLocalChecked(), jsTagSignature);
 
@@ -245,20 +167,16 @@ public:
 
   ~RefreshedRefModel() {
     if (fullName != NULL) { delete[] fullName; }
-    if (message != NULL) { delete[] message; }
     delete[] sha;
     if (shorthand != NULL) { delete[] shorthand; }
-    if (tagOdbBuffer != NULL) { delete[] tagOdbBuffer; }
   }
 
-  char *fullName, *message, *sha, *shorthand, *tagOdbBuffer;
-  size_t tagOdbBufferLength;
+  char *fullName, *sha, *shorthand;
+  // the target of a tag ref, shared with the cache
+  std::shared_ptr<const TagPeelCache::Tag> tag;
   const char *type;
-  static Nan::Persistent<v8::Object> signatureRegexesBySignatureType;
 };
 
-Nan::Persistent<v8::Object> RefreshedRefModel::signatureRegexesBySignatureType;
-
 class UpstreamModel {
 public:
   UpstreamModel(const char *inputDownstreamFullName, const char *inputUpstreamFullName):
@@ -302,23 +220,58 @@ public:
       return false;
     }
 
-    result = git_graph_ahead_behind(
-      &upstreamModel->ahead,
-      &upstreamModel->behind,
-      git_reference_owner(ref),
-      &localCommitOid,
-      &upstreamCommitOid
-    );
-
-    if (result != GIT_OK) {
-      delete upstreamModel;
-      return false;
-    }
+    // ahead and behind are computed for all the branches at once, see computeAheadBehind
+    git_oid_cpy(&upstreamModel->localCommitOid, &localCommitOid);
+    git_oid_cpy(&upstreamModel->upstreamCommitOid, &upstreamCommitOid);
 
     *out = upstreamModel;
     return true;
   }
 
+  /**
+   * Sets ahead and behind of all the models, in a single walk of their shared history.
+   * Models whose counts can't be computed are deleted and removed, as if they had no upstream.
+   */
+  static void computeAheadBehind(std::vector<UpstreamModel *> *upstreamModels, git_repository *repo) {
+    if (upstreamModels->empty()) {
+      return;
+    }
+
+    AheadBehindBatch aheadBehind(repo);
+    for (UpstreamModel *upstreamModel : *upstreamModels) {
+      aheadBehind.AddPair(upstreamModel->localCommitOid, upstreamModel->upstreamCommitOid);
+    }
+
+    if (aheadBehind.Compute() == GIT_OK) {
+      for (size_t i = 0; i < upstreamModels->size(); ++i) {
+        (*upstreamModels)[i]->ahead = aheadBehind.GetAhead()[i];
+        (*upstreamModels)[i]->behind = aheadBehind.GetBehind()[i];
+      }
+      return;
+    }
+
+    // some history is missing: find out which branches are affected one by one
+    git_error_clear();
+    std::vector<UpstreamModel *> computedModels {};
+    for (UpstreamModel *upstreamModel : *upstreamModels) {
+      int result = git_graph_ahead_behind(
+        &upstreamModel->ahead,
+        &upstreamModel->behind,
+        repo,
+        &upstreamModel->localCommitOid,
+        &upstreamModel->upstreamCommitOid
+      );
+
+      if (result == GIT_OK) {
+        computedModels.push_back(upstreamModel);
+      } else {
+        delete upstreamModel;
+      }
+    }
+    git_error_clear();
+    upstreamModels->swap(computedModels);
+  }
+
   v8::Local<v8::Object> toJavascript() {
     v8::Local<v8::Object> result = Nan::New<Object>();
 
@@ -350,16 +303,173 @@ public:
 
   char *downstreamFullName;
   char *upstreamFullName;
+  git_oid localCommitOid;
+  git_oid upstreamCommitOid;
   size_t ahead;
   size_t behind;
 };
 
+static void appendTokenUint32(std::string *token, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    token->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+static void appendTokenString(std::string *token, const std::string &value) {
+  appendTokenUint32(token, static_cast<uint32_t>(value.size()));
+  token->append(value);
+}
+
+/**
+ * \class RefsChangeToken
+ * What a refresh returned: the target of each ref, and the upstream of each branch with the
+ * commits its ahead/behind counts were computed for. Given back to refreshReferences, it lets
+ * the next refresh skip the refs and upstreams that didn't move. The branch of HEAD is kept apart
+ * from the other refs, as the refresh returns it as HEAD only.
+ * Layout, little-endian: version, the full name of HEAD (length, bytes), number of refs, then for
+ * each one its name (length, bytes) and raw oid; number of upstreams, then for each one the downstream name, the upstream name,
+ * the raw local commit oid and the raw upstream commit oid.
+ */
+class RefsChangeToken {
+public:
+  struct Upstream {
+    std::string upstreamFullName;
+    git_oid localCommitOid;
+    git_oid upstreamCommitOid;
+  };
+
+  // \return false if the data is not a valid token
+  bool Load(const char *data, size_t length) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = bytes + length;
+    uint32_t version, numRefs, numUpstreams;
+    if (
+      !readUint32(&bytes, end, &version)
+      || version != kVersion
+      || !readString(&bytes, end, &headFullName)
+      || !readUint32(&bytes, end, &numRefs)
+    ) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < numRefs; ++i) {
+      std::string name;
+      git_oid oid;
+      if (!readString(&bytes, end, &name) || !readOid(&bytes, end, &oid)) {
+        return false;
+      }
+      refs[name] = oid;
+    }
+
+    if (!readUint32(&bytes, end, &numUpstreams)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < numUpstreams; ++i) {
+      std::string downstreamFullName;
+      Upstream upstream;
+      if (
+        !readString(&bytes, end, &downstreamFullName)
+        || !readString(&bytes, end, &upstream.upstreamFullName)
+        || !readOid(&bytes, end, &upstream.localCommitOid)
+        || !readOid(&bytes, end, &upstream.upstreamCommitOid)
+      ) {
+        return false;
+      }
+      upstreams[downstreamFullName] = upstream;
+    }
+
+    return bytes == end;
+  }
+
+  std::string Save() const {
+    std::string token;
+    appendTokenUint32(&token, kVersion);
+    appendTokenString(&token, headFullName);
+    appendTokenUint32(&token, static_cast<uint32_t>(refs.size()));
+    for (const auto &ref : refs) {
+      appendTokenString(&token, ref.first);
+      token.append(reinterpret_cast<const char *>(ref.second.id), GIT_OID_RAWSZ);
+    }
+
+    appendTokenUint32(&token, static_cast<uint32_t>(upstreams.size()));
+    for (const auto &upstream : upstreams) {
+      appendTokenString(&token, upstream.first);
+      appendTokenString(&token, upstream.second.upstreamFullName);
+      token.append(reinterpret_cast<const char *>(upstream.second.localCommitOid.id), GIT_OID_RAWSZ);
+      token.append(reinterpret_cast<const char *>(upstream.second.upstreamCommitOid.id), GIT_OID_RAWSZ);
+    }
+    return token;
+  }
+
+  bool HasRef(const char *fullName, const git_oid *target) const {
+    auto ref = refs.find(fullName);
+    return ref != refs.end() && git_oid_equal(&ref->second, target);
+  }
+
+  void AddRef(const char *fullName, const git_oid *target) {
+    git_oid_cpy(&refs[fullName], target);
+  }
+
+  bool HasUpstream(const UpstreamModel *upstreamModel) const {
+    auto upstream = upstreams.find(upstreamModel->downstreamFullName);
+    return upstream != upstreams.end()
+      && upstream->second.upstreamFullName == upstreamModel->upstreamFullName
+      && git_oid_equal(&upstream->second.localCommitOid, &upstreamModel->localCommitOid)
+      && git_oid_equal(&upstream->second.upstreamCommitOid, &upstreamModel->upstreamCommitOid);
+  }
+
+  void AddUpstream(const UpstreamModel *upstreamModel) {
+    Upstream &upstream = upstreams[upstreamModel->downstreamFullName];
+    upstream.upstreamFullName = upstreamModel->upstreamFullName;
+    git_oid_cpy(&upstream.localCommitOid, &upstreamModel->localCommitOid);
+    git_oid_cpy(&upstream.upstreamCommitOid, &upstreamModel->upstreamCommitOid);
+  }
+
+  std::string headFullName;
+  std::map<std::string, git_oid> refs;
+  std::map<std::string, Upstream> upstreams;
+
+private:
+  static const uint32_t kVersion = 2;
+
+  static bool readUint32(const unsigned char **bytes, const unsigned char *end, uint32_t *value) {
+    if (end - *bytes < 4) {
+      return false;
+    }
+    *value = static_cast<uint32_t>((*bytes)[0]) | (static_cast<uint32_t>((*bytes)[1]) << 8) |
+      (static_cast<uint32_t>((*bytes)[2]) << 16) | (static_cast<uint32_t>((*bytes)[3]) << 24);
+    *bytes += 4;
+    return true;
+  }
+
+  static bool readString(const unsigned char **bytes, const unsigned char *end, std::string *value) {
+    uint32_t length;
+    if (!readUint32(bytes, end, &length) || static_cast<size_t>(end - *bytes) < length) {
+      return false;
+    }
+    value->assign(reinterpret_cast<const char *>(*bytes), length);
+    *bytes += length;
+    return true;
+  }
+
+  static bool readOid(const unsigned char **bytes, const unsigned char *end, git_oid *oid) {
+    if (end - *bytes < GIT_OID_RAWSZ) {
+      return false;
+    }
+    memcpy(oid->id, *bytes, GIT_OID_RAWSZ);
+    *bytes += GIT_OID_RAWSZ;
+    return true;
+  }
+};
+
 class RefreshReferencesData {
 public:
   RefreshReferencesData():
     headRefFullName(NULL),
     cherrypick(NULL),
-    merge(NULL) {}
+    merge(NULL),
+    previousToken(NULL),
+    signatureType(TagPeelCache::kGpgsig) {}
 
   RefreshReferencesData(const RefreshReferencesData &) = delete;
   RefreshReferencesData(RefreshReferencesData &&) = delete;
@@ -378,6 +488,7 @@ public:
     if (headRefFullName != NULL) { delete[] headRefFullName; }
     if (cherrypick != NULL) { delete cherrypick; }
     if (merge != NULL) { delete merge; }
+    if (previousToken != NULL) { delete previousToken; }
   }
 
   std::vector<RefreshedRefModel *> refs;
@@ -385,12 +496,28 @@ public:
   char *headRefFullName;
   RefreshedRefModel *cherrypick;
   RefreshedRefModel *merge;
+  // given by the caller for an incremental refresh, NULL for a full one
+  RefsChangeToken *previousToken;
+  RefsChangeToken changeToken;
+  std::vector<std::string> removedRefs;
+  std::vector<std::string> removedUpstreams;
+  TagPeelCache::SignatureType signatureType;
+  std::shared_ptr<TagPeelCache> tagPeelCache;
 };
 
+/**
+ * refreshReferences([signatureType], [changeToken], callback)
+ * The result always has a changeToken Buffer. Given the changeToken of a previous refresh,
+ * refs only has HEAD and the refs added or moved since, and upstreamInfo only the branches
+ * whose upstream or commits changed; removedRefs and removedUpstreamInfo list the full names
+ * of the refs and of the branches (or their upstream) that are gone. When another branch was
+ * checked out, the previous branch of HEAD is returned again as an ordinary ref, and HEAD
+ * replaces the entry of its new branch.
+ */
 NAN_METHOD(GitRepository::RefreshReferences)
 {
-  v8::Local<v8::String> signatureType;
-  if (info.Length() == 2) {
+  TagPeelCache::SignatureType signatureType = TagPeelCache::kGpgsig;
+  if (info.Length() >= 2 && !info[0]->IsNull() && !info[0]->IsUndefined()) {
     if (!info[0]->IsString()) {
       return Nan::ThrowError("Signature type must be \"gpgsig\" or \"x509\".");
     }
@@ -402,28 +529,46 @@ NAN_METHOD(GitRepository::RefreshReferences)
     ) {
       return Nan::ThrowError("Signature type must be \"gpgsig\" or \"x509\".");
     }
-    signatureType = signatureTypeParam;
-  } else {
-    signatureType = Nan::New("gpgsig").ToLocalChecked();
+    if (Nan::Equals(signatureTypeParam, Nan::New("x509").ToLocalChecked()) == Nan::Just(true)) {
+      signatureType = TagPeelCache::kX509;
+    }
   }
 
   if (!info[info.Length() - 1]->IsFunction()) {
     return Nan::ThrowError("Callback is required and must be a Function.");
   }
 
+  RefsChangeToken *previousToken = NULL;
+  if (info.Length() == 3 && !info[1]->IsNull() && !info[1]->IsUndefined()) {
+    if (!node::Buffer::HasInstance(info[1])) {
+      return Nan::ThrowError("Change token must be a Buffer.");
+    }
+
+    v8::Local<v8::Object> token = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+    previousToken = new RefsChangeToken();
+    if (!previousToken->Load(node::Buffer::Data(token), node::Buffer::Length(token))) {
+      delete previousToken;
+      return Nan::ThrowError("Change token is not a valid refreshReferences token.");
+    }
+  }
+
   RefreshReferencesBaton* baton = new RefreshReferencesBaton();
+  RefreshReferencesData *refreshData = new RefreshReferencesData();
+  refreshData->previousToken = previousToken;
+  refreshData->signatureType = signatureType;
 
   baton->error_code = GIT_OK;
   baton->error = NULL;
-  baton->out = (void *)new RefreshReferencesData();
+  baton->out = (void *)refreshData;
   baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
 
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  refreshData->tagPeelCache = TagPeelCache::ForRepository(nodegitContext, baton->repo);
+
   Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
   std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
   RefreshReferencesWorker *worker = new RefreshReferencesWorker(baton, callback, cleanupHandles);
   worker->Reference<GitRepository>("repo", info.This());
-  worker->Reference("signatureType", signatureType);
-  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
   nodegitContext->QueueWorker(worker);
   return;
 }
@@ -466,7 +611,7 @@ void GitRepository::RefreshReferencesWorker::Execute()
   }
 
   RefreshedRefModel *headModel;
-  baton->error_code = RefreshedRefModel::fromReference(&headModel, headRef, odb);
+  baton->error_code = RefreshedRefModel::fromReference(&headModel, headRef, odb, refreshData->tagPeelCache.get());
   if (baton->error_code != GIT_OK) {
     if (giterr_last() != NULL) {
       baton->error = git_error_dup(giterr_last());
@@ -478,6 +623,8 @@ void GitRepository::RefreshReferencesWorker::Execute()
     return;
   }
   refreshData->refs.push_back(headModel);
+  // HEAD is always returned; its branch is only returned as HEAD, so it is recorded apart
+  refreshData->changeToken.headFullName = headModel->fullName;
 
   refreshData->headRefFullName = strdup(git_reference_name(headRef));
   git_reference_free(headRef);
@@ -486,7 +633,7 @@ void GitRepository::RefreshReferencesWorker::Execute()
   // START Refresh CHERRY_PICK_HEAD
   git_reference *cherrypickRef = NULL;
   if (lookupDirectReferenceByShorthand(&cherrypickRef, repo, "CHERRY_PICK_HEAD") == GIT_OK && cherrypickRef != NULL) {
-    baton->error_code = RefreshedRefModel::fromReference(&refreshData->cherrypick, cherrypickRef, odb);
+    baton->error_code = RefreshedRefModel::fromReference(&refreshData->cherrypick, cherrypickRef, odb, refreshData->tagPeelCache.get());
     git_reference_free(cherrypickRef);
   } else {
     cherrypickRef = NULL;
@@ -497,7 +644,7 @@ void GitRepository::RefreshReferencesWorker::Execute()
   git_reference *mergeRef = NULL;
   // fall through if cherry pick failed
   if (baton->error_code == GIT_OK && lookupDirectReferenceByShorthand(&mergeRef, repo, "MERGE_HEAD") == GIT_OK && mergeRef != NULL) {
-    baton->error_code = RefreshedRefModel::fromReference(&refreshData->merge, mergeRef, odb);
+    baton->error_code = RefreshedRefModel::fromReference(&refreshData->merge, mergeRef, odb, refreshData->tagPeelCache.get());
     git_reference_free(mergeRef);
   } else {
     mergeRef = NULL;
@@ -556,7 +703,13 @@ void GitRepository::RefreshReferencesWorker::Execute()
 
     UpstreamModel *upstreamModel;
     if (UpstreamModel::fromReference(&upstreamModel, reference)) {
-      refreshData->upstreamInfo.push_back(upstreamModel);
+      if (refreshData->previousToken != NULL && refreshData->previousToken->HasUpstream(upstreamModel)) {
+        // same commits on both sides: ahead and behind didn't change
+        refreshData->changeToken.AddUpstream(upstreamModel);
+        delete upstreamModel;
+      } else {
+        refreshData->upstreamInfo.push_back(upstreamModel);
+      }
     }
 
     bool isBranch = git_reference_is_branch(reference);
@@ -580,21 +733,61 @@ void GitRepository::RefreshReferencesWorker::Execute()
       }
     }
 
+    const char *fullName = git_reference_name(reference);
+    const git_oid *targetOid = git_reference_target(reference);
+    // not in the refs of the token when it was the branch of HEAD, so it is returned again
+    if (refreshData->previousToken != NULL && refreshData->previousToken->HasRef(fullName, targetOid)) {
+      refreshData->changeToken.AddRef(fullName, targetOid);
+      git_reference_free(reference);
+      continue;
+    }
+
     RefreshedRefModel *refreshedRefModel;
-    baton->error_code = RefreshedRefModel::fromReference(&refreshedRefModel, reference, odb);
-    git_reference_free(reference);
+    baton->error_code = RefreshedRefModel::fromReference(&refreshedRefModel, reference, odb, refreshData->tagPeelCache.get());
 
     if (baton->error_code == GIT_OK) {
       refreshData->refs.push_back(refreshedRefModel);
+      refreshData->changeToken.AddRef(fullName, targetOid);
     } else {
       baton->error_code = GIT_OK;
     }
+    git_reference_free(reference);
   }
 
   git_odb_free(odb);
   git_strarray_free(&remoteNames);
   git_strarray_free(&referenceNames);
 
+  if (baton->error_code == GIT_OK) {
+    UpstreamModel::computeAheadBehind(&refreshData->upstreamInfo, repo);
+    for (UpstreamModel *upstreamModel : refreshData->upstreamInfo) {
+      refreshData->changeToken.AddUpstream(upstreamModel);
+    }
+
+    if (refreshData->previousToken != NULL) {
+      const std::string &headFullName = refreshData->changeToken.headFullName;
+      for (const auto &ref : refreshData->previousToken->refs) {
+        if (refreshData->changeToken.refs.count(ref.first) == 0 && ref.first != headFullName) {
+          refreshData->removedRefs.push_back(ref.first);
+        }
+      }
+      // the previous branch of HEAD, deleted since (a detached HEAD isn't a ref)
+      const std::string &previousHeadFullName = refreshData->previousToken->headFullName;
+      if (
+        previousHeadFullName != headFullName
+        && previousHeadFullName.compare(0, 5, "refs/") == 0
+        && refreshData->changeToken.refs.count(previousHeadFullName) == 0
+      ) {
+        refreshData->removedRefs.push_back(previousHeadFullName);
+      }
+      for (const auto &upstream : refreshData->previousToken->upstreams) {
+        if (refreshData->changeToken.upstreams.count(upstream.first) == 0) {
+          refreshData->removedUpstreams.push_back(upstream.first);
+        }
+      }
+    }
+  }
+
   if (baton->error_code != GIT_OK) {
     if (giterr_last() != NULL) {
       baton->error = git_error_dup(giterr_last());
@@ -624,7 +817,6 @@ void GitRepository::RefreshReferencesWorker::HandleOKCallback()
 {
   if (baton->out != NULL)
   {
-    RefreshedRefModel::ensureSignatureRegexes();
     auto refreshData = (RefreshReferencesData *)baton->out;
     v8::Local<v8::Object> result = Nan::New<Object>();
 
@@ -634,7 +826,7 @@ void GitRepository::RefreshReferencesWorker::HandleOKCallback()
       Nan::New<String>(refreshData->headRefFullName).ToLocalChecked()
     );
 
-    v8::Local<v8::String> signatureType = Nan::To<v8::String>(GetFromPersistent("signatureType")).ToLocalChecked();
+    TagPeelCache::SignatureType signatureType = refreshData->signatureType;
 
     unsigned int numRefs = refreshData->refs.size();
     v8::Local<v8::Array> refs = Nan::New<v8::Array>(numRefs);
@@ -652,6 +844,27 @@ void GitRepository::RefreshReferencesWorker::HandleOKCallback()
     }
     Nan::Set(result, Nan::New("upstreamInfo").ToLocalChecked(), upstreamInfo);
 
+    unsigned int numRemovedRefs = refreshData->removedRefs.size();
+    v8::Local<v8::Array> removedRefs = Nan::New<v8::Array>(numRemovedRefs);
+    for (unsigned int i = 0; i < numRemovedRefs; ++i) {
+      Nan::Set(removedRefs, Nan::New(i), Nan::New<String>(refreshData->removedRefs[i]).ToLocalChecked());
+    }
+    Nan::Set(result, Nan::New("removedRefs").ToLocalChecked(), removedRefs);
+
+    unsigned int numRemovedUpstreams = refreshData->removedUpstreams.size();
+    v8::Local<v8::Array> removedUpstreams = Nan::New<v8::Array>(numRemovedUpstreams);
+    for (unsigned int i = 0; i < numRemovedUpstreams; ++i) {
+      Nan::Set(removedUpstreams, Nan::New(i), Nan::New<String>(refreshData->removedUpstreams[i]).ToLocalChecked());
+    }
+    Nan::Set(result, Nan::New("removedUpstreamInfo").ToLocalChecked(), removedUpstreams);
+
+    const std::string changeToken = refreshData->changeToken.Save();
+    Nan::Set(
+      result,
+      Nan::New("changeToken").ToLocalChecked(),
+      Nan::CopyBuffer(changeToken.data(), changeToken.size()).ToLocalChecked()
+    );
+
     if (refreshData->cherrypick != NULL) {
       Nan::Set(
         result,
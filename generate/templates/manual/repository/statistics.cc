@@ -1,142 +1,9 @@
-/**
- * \struct CommitsGraphNode
- */
-struct CommitsGraphNode
-{
-  CommitsGraphNode(uint32_t aParentsLeft) : parentsLeft(aParentsLeft) {}
-  CommitsGraphNode() = default;
-  ~CommitsGraphNode() = default;
-  CommitsGraphNode(const CommitsGraphNode &other) = delete;
-  CommitsGraphNode(CommitsGraphNode &&other) = delete;
-  CommitsGraphNode& operator=(const CommitsGraphNode &other) = delete;
-  CommitsGraphNode& operator=(CommitsGraphNode &&other) = delete;
-
-  std::vector<CommitsGraphNode *> children {};
-  uint32_t parentsLeft {0}; // used when calculating the maximum history depth
-};
-
-/**
- * \class CommitsGraph
- */
-class CommitsGraph
-{
-public:
-  CommitsGraph() = default;
-  ~CommitsGraph() = default;
-  CommitsGraph(const CommitsGraph &other) = delete;
-  CommitsGraph(CommitsGraph &&other) = delete;
-  CommitsGraph& operator=(const CommitsGraph &other) = delete;
-  CommitsGraph& operator=(CommitsGraph &&other) = delete;
-
-  using CommitsGraphMap = std::unordered_map<std::string, std::unique_ptr<CommitsGraphNode>>;
-
-  void AddNode(const std::string &oidStr, const std::vector<std::string> &parents);
-  uint32_t CalculateMaxDepth();
-
-private:
-  void addParentNode(const std::string &oidParentStr, CommitsGraphNode *child);
-
-  CommitsGraphMap m_mapOidNode {};
-  std::vector<CommitsGraphNode *> m_roots {};
-};
-
-/**
- * CommitsGraph::AddNode
- * 
- * \param oidStr oid of the commit object to add.
- * \param parents oids of the commit's parents.
- */
-void CommitsGraph::AddNode(const std::string &oidStr, const std::vector<std::string> &parents)
-{
-  const uint32_t numParents = static_cast<uint32_t>(parents.size());
-
-  auto emplacePair = m_mapOidNode.emplace(std::make_pair(
-    oidStr, std::make_unique<CommitsGraphNode>(numParents)));
-
-  CommitsGraphMap::iterator itNode = emplacePair.first;
-
-  // if this node already added by a child, update its parentsLeft
-  if (emplacePair.second == false) {
-    itNode->second.get()->parentsLeft = numParents;
-  }
-
-  // set roots
-  if (numParents == 0) {
-    m_roots.emplace_back(itNode->second.get());
-  }
-
-  // add parents
-  for (unsigned int i = 0; i < numParents; ++i) {
-    addParentNode(parents.at(i), itNode->second.get());
-  }
-}
-
-/**
- * CommitsGraph::CalculateMaxDepth
- * \return Calculated maximum depth of the tree.
- * 
- * Uses iterative algorithm to count levels.
- * Considers multiple initial commits.
- * Considers that children of one level can have multiple parents, hence we insert unique children
- * at each level.
- * Considers that same child can be in different levels. Here to prevent counting the same child
- * multiple times, we only add a child when the last parent (parentsLeft) inserts it. This is
- * actually what makes the algorithm fast.
- * Recursive algorithm avoided to prevent stack overflow in case of excessive levels in the tree.
- * 
- * Explanation of the algorithm:
- * once the graph is built with the commit history, `CalculateMaxDepth()` counts the maximum number
- * of levels from any of the roots to any of the leaves, which gives us the maximum depth
- * (`historyStructure.maxDepth` in the final result).
- * Inside `CalculateMaxDepth()`, to count levels, we add in an iterative way for each level and
- * starting at the roots level, all the children from that level, but only if each child is the last
- * time we'll consider it in the algorithm (for example if a child node 'C' has 2 parents 'P1' and
- * 'P2', and 'P1' has already been considered before in the algorithm as parent of 'C', and now we are
- * processing 'C' as a child from 'P2', which will be the last time, as 'C' has no more parents left).
- * This way we prevent counting 'C' multiple times.
- */
-uint32_t CommitsGraph::CalculateMaxDepth()
-{
-  uint32_t maxDepth {0};
-  std::unordered_set<CommitsGraphNode *> parents {};
-  std::unordered_set<CommitsGraphNode *> children {};
-
-  // start from the root commmits
-  for (CommitsGraphNode *root : m_roots) {
-    children.insert(root);
-  }
-
-  while (!children.empty()) {
-    ++maxDepth;
-    parents = std::move(children);
-
-    // add unique children of next level, and only if from the last parent
-    for (CommitsGraphNode *parent : parents) {
-      for (CommitsGraphNode *child : parent->children) {
-        if (--child->parentsLeft == 0) {
-          children.insert(child);
-        }
-      }
-    }
-  }
-
-  return maxDepth;
-}
-
-/**
- * CommitsGraph::addParentNode
- * 
- * \param oidParentStr oid of the parent commit to add.
- * \param child Child of the parent commit being added.
- */
-void CommitsGraph::addParentNode(const std::string &oidParentStr, CommitsGraphNode *child)
-{
-  CommitsGraphMap::iterator itParentNode = m_mapOidNode.emplace(std::make_pair(
-    oidParentStr, std::make_unique<CommitsGraphNode>())).first;
+#include <chrono>
+#include <deque>
+#include <system_error>
 
-  // add child to parent
-  itParentNode->second->children.emplace_back(child);
-}
+#include "../include/commit_data_source.h"
+#include "../include/commits_graph.h"
 
 /**
  * \struct TreeStatistics
@@ -160,6 +27,16 @@ struct TreeStatistics
   size_t numSubmodules {0};
 };
 
+/**
+ * \struct PathSize
+ * Cumulative historical size attributed to a path of the repository.
+ */
+struct PathSize
+{
+  std::string path {};
+  size_t size {0};
+};
+
 /**
  * \struct Statistics
  * Stores statistics of the analyzed repository.
@@ -193,6 +70,82 @@ struct Statistics
   } historyStructure {};
 
   TreeStatistics biggestCheckouts {};
+
+  struct {
+    std::vector<PathSize> directories {};
+    std::vector<PathSize> files {};
+  } sizeByPath {};
+};
+
+/**
+ * \struct RepoAnalysisOptions
+ * Optional statistics requested on top of the default ones.
+ */
+struct RepoAnalysisOptions
+{
+  // number of directories and files to return in sizeByPath; 0 disables it
+  size_t sizeByPathTopN {0};
+
+  // Quick mode: only checks whether the repository exceeds any of these limits,
+  // stopping as soon as one is exceeded. 0 means no limit.
+  struct {
+    size_t blobSize {0};
+    size_t treeEntries {0};
+    uint32_t historyDepth {0};
+  } limits {};
+  // Quick mode: stop, returning partial results, once any of these is spent. 0 means no budget.
+  struct {
+    uint64_t timeMs {0};
+    size_t objects {0};
+  } budget {};
+
+  // Quick mode: read the parents of commits from the commit-graph file, when there is one
+  bool useCommitGraph {true};
+
+  bool IsQuick() const {
+    return limits.blobSize > 0 || limits.treeEntries > 0 || limits.historyDepth > 0;
+  }
+};
+
+/**
+ * \class AtomicBitset
+ * Fixed size bitset whose bits can be set concurrently from several threads.
+ */
+class AtomicBitset
+{
+public:
+  AtomicBitset() = default;
+  ~AtomicBitset() = default;
+  AtomicBitset(const AtomicBitset &other) = delete;
+  AtomicBitset(AtomicBitset &&other) = delete;
+  AtomicBitset& operator=(const AtomicBitset &other) = delete;
+  AtomicBitset& operator=(AtomicBitset &&other) = delete;
+
+  // NOTE: not thread safe, must be called before the bitset is shared
+  void Reset(size_t numBits) {
+    m_words = std::vector< std::atomic<uint64_t> >((numBits + 63) / 64);
+  }
+
+  /**
+   * Sets bit i.
+   * \return true if this call set the bit; false if it was already set.
+   */
+  bool TestAndSet(size_t i) {
+    std::atomic<uint64_t> &word = m_words[i / 64];
+    const uint64_t mask = uint64_t(1) << (i % 64);
+    // most objects are reached several times: avoid the read-modify-write when already set
+    if (word.load(std::memory_order_relaxed) & mask) {
+      return false;
+    }
+    return !(word.fetch_or(mask, std::memory_order_relaxed) & mask);
+  }
+
+  bool Test(size_t i) const {
+    return m_words[i / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (i % 64));
+  }
+
+private:
+  std::vector< std::atomic<uint64_t> > m_words {};
 };
 
 /**
@@ -203,8 +156,6 @@ struct Statistics
  */
 struct OdbObjectsData
 {
-  static constexpr uint32_t kUnreachable = 0;
-
   struct CommitInfo {
     CommitInfo() = default;
     ~CommitInfo() = default;
@@ -216,9 +167,8 @@ struct OdbObjectsData
     std::string oidTree {};
     size_t size {0};
     std::vector<std::string> parents {};
-    // number of sources from which a commit can be reached:
-    // a child commit, a tag, or a direct git reference
-    uint32_t reachability {kUnreachable};
+    // dense index among commits, used to mark reachability
+    uint32_t index {0};
   };
 
   struct TreeInfoAndStats {
@@ -233,11 +183,15 @@ struct OdbObjectsData
     size_t numEntries {0};
     std::vector<std::string> entryBlobs {};
     std::vector< std::pair<std::string, size_t> > entryTreesNameLen {};
-    // number of sources from which a tree can be reached:
-    // a commit, another tree's entry, or a tag
-    uint32_t reachability {kUnreachable};
+    // entry names, parallel to entryBlobs and entryTreesNameLen.
+    // Only stored when sizeByPath statistics are requested.
+    std::vector<std::string> entryBlobsNames {};
+    std::vector<std::string> entryTreesNames {};
+    // dense index among trees, used to mark reachability
+    uint32_t index {0};
     TreeStatistics stats {};
     bool statsDone {false};
+    bool pathsDone {false};
   };
 
   struct BlobInfo {
@@ -249,9 +203,10 @@ struct OdbObjectsData
     BlobInfo& operator=(BlobInfo &&other) = default;
 
     size_t size {0};
-    // number of sources from which a blob can be reached:
-    // a tree's entry, or a tag
-    uint32_t reachability {kUnreachable};
+    // dense index among blobs, used to mark reachability
+    uint32_t index {0};
+    // set once the blob's size has been attributed to a path
+    bool pathAttributed {false};
   };
 
   struct TagInfo {
@@ -267,9 +222,8 @@ struct OdbObjectsData
     std::string oidTarget {};
     git_object_t typeTarget {GIT_OBJECT_INVALID};
     uint32_t depth {kUnsetDepth};
-    // number of sources from which a tag can be reached:
-    // a reference, or another tag
-    uint32_t reachability {kUnreachable};
+    // dense index among tags, used to mark reachability
+    uint32_t index {0};
   };
 
   OdbObjectsData() = default;
@@ -281,7 +235,7 @@ struct OdbObjectsData
 
   struct {
     std::unordered_map<std::string, CommitInfo> info {};
-    std::unordered_set<std::string> unreachables {};
+    AtomicBitset reachable {};
     // Tree of commits (graph) to be built after having read the object
     // database, and pruned unreachable objects.
     // Used to calculate the maximum history depth.
@@ -293,7 +247,7 @@ struct OdbObjectsData
 
   struct {
     std::unordered_map<std::string, TreeInfoAndStats> info;
-    std::unordered_set<std::string> unreachables {};
+    AtomicBitset reachable {};
     size_t totalSize {0};
     size_t totalEntries {0};
     size_t maxEntries {0};
@@ -301,14 +255,14 @@ struct OdbObjectsData
 
   struct {
     std::unordered_map<std::string, BlobInfo> info {};
-    std::unordered_set<std::string> unreachables {};
+    AtomicBitset reachable {};
     size_t totalSize {0};
     size_t maxSize {0};
   } blobs {};
 
   struct {
     std::unordered_map<std::string, TagInfo> info;
-    std::unordered_set<std::string> unreachables {};
+    AtomicBitset reachable {};
   } tags {};
 
   struct {
@@ -319,30 +273,34 @@ struct OdbObjectsData
   } infoMutex;
 
   using iterCommitInfo = std::unordered_map<std::string, CommitInfo>::iterator;
-  using iterUnreachable = std::unordered_set<std::string>::iterator;
   using iterTreeInfo = std::unordered_map<std::string, TreeInfoAndStats>::iterator;
   using iterBlobInfo = std::unordered_map<std::string, BlobInfo>::iterator;
   using iterTagInfo = std::unordered_map<std::string, TagInfo>::iterator;
 };
 
 /**
- * \class WorkItemOid
- * WorkItem storing odb oids for the WorkPool.
+ * \class WorkItemOids
+ * WorkItem storing a batch of odb oids for the WorkPool.
+ * Batching keeps queueing cost low, since the odb can have millions of objects.
  */
-class WorkItemOid : public WorkItem {
+class WorkItemOids : public WorkItem {
 public:
-  WorkItemOid(const git_oid &oid)
-    : m_oid(oid) {}
-  ~WorkItemOid() = default;
-  WorkItemOid(const WorkItemOid &other) = delete;
-  WorkItemOid(WorkItemOid &&other) = delete;
-  WorkItemOid& operator=(const WorkItemOid &other) = delete;
-  WorkItemOid& operator=(WorkItemOid &&other) = delete;
-  
-  const git_oid& GetOid() const { return m_oid; }
+  static constexpr size_t kMaxOids = 256;
+
+  WorkItemOids() { m_oids.reserve(kMaxOids); }
+  ~WorkItemOids() = default;
+  WorkItemOids(const WorkItemOids &other) = delete;
+  WorkItemOids(WorkItemOids &&other) = delete;
+  WorkItemOids& operator=(const WorkItemOids &other) = delete;
+  WorkItemOids& operator=(WorkItemOids &&other) = delete;
+
+  void Add(const git_oid &oid) { m_oids.emplace_back(oid); }
+  bool Full() const { return m_oids.size() >= kMaxOids; }
+  bool Empty() const { return m_oids.empty(); }
+  const std::vector<git_oid>& GetOids() const { return m_oids; }
 
 private:
-  git_oid m_oid {};
+  std::vector<git_oid> m_oids {};
 };
 
 /**
@@ -352,8 +310,8 @@ private:
 class WorkerStoreOdbData : public IWorker
 {
 public:
-  WorkerStoreOdbData(const std::string &repoPath, OdbObjectsData *odbObjectsData)
-    : m_repoPath(repoPath), m_odbObjectsData(odbObjectsData) {}
+  WorkerStoreOdbData(const std::string &repoPath, OdbObjectsData *odbObjectsData, bool storeEntryNames)
+    : m_repoPath(repoPath), m_odbObjectsData(odbObjectsData), m_storeEntryNames(storeEntryNames) {}
   ~WorkerStoreOdbData();
   WorkerStoreOdbData(const WorkerStoreOdbData &other) = delete;
   WorkerStoreOdbData(WorkerStoreOdbData &&other) = delete;
@@ -364,12 +322,14 @@ public:
   bool Execute(std::unique_ptr<WorkItem> &&work);
 
 private:
+  bool storeObjectInfo(const git_oid &oid);
   OdbObjectsData::TreeInfoAndStats thisTreeInfoAndStats(const git_tree *tree, size_t size, size_t numEntries);
 
   std::string m_repoPath {};
   git_repository *m_repo {nullptr};
   git_odb *m_odb {nullptr};
   OdbObjectsData *m_odbObjectsData {nullptr};
+  bool m_storeEntryNames {false};
 };
 
 /**
@@ -402,9 +362,22 @@ bool WorkerStoreOdbData::Initialize() {
  */
 bool WorkerStoreOdbData::Execute(std::unique_ptr<WorkItem> &&work)
 {
-  std::unique_ptr<WorkItemOid> wi {static_cast<WorkItemOid*>(work.release())};
-  const git_oid &oid = wi->GetOid();
+  std::unique_ptr<WorkItemOids> wi {static_cast<WorkItemOids*>(work.release())};
+
+  for (const git_oid &oid : wi->GetOids()) {
+    if (!storeObjectInfo(oid)) {
+      return false;
+    }
+  }
+
+  return true;
+}
 
+/**
+ * WorkerStoreOdbData::storeObjectInfo
+ */
+bool WorkerStoreOdbData::storeObjectInfo(const git_oid &oid)
+{
   // NOTE about PERFORMANCE (May 2021):
   // git_object_lookup() is as expensive as git_odb_read().
   // They give access to different information from the libgit2 API.
@@ -443,8 +416,7 @@ bool WorkerStoreOdbData::Execute(std::unique_ptr<WorkItem> &&work)
       OdbObjectsData::CommitInfo commitInfo {
         std::string(reinterpret_cast<const char *>(git_commit_tree_id(commit)->id), GIT_OID_RAWSZ),
         size,
-        std::move(parents),
-        OdbObjectsData::kUnreachable};
+        std::move(parents)};
 
       { // lock
         std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.commits);
@@ -493,7 +465,7 @@ bool WorkerStoreOdbData::Execute(std::unique_ptr<WorkItem> &&work)
     {
       git_blob *blob = (git_blob*)target;
       const size_t size = git_blob_rawsize(blob);
-      OdbObjectsData::BlobInfo blobInfo {size, OdbObjectsData::kUnreachable};
+      OdbObjectsData::BlobInfo blobInfo {size};
 
       { // lock
         std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.blobs);
@@ -513,8 +485,7 @@ bool WorkerStoreOdbData::Execute(std::unique_ptr<WorkItem> &&work)
       OdbObjectsData::TagInfo tagInfo {
         std::string(reinterpret_cast<const char *>(oid_target->id), GIT_OID_RAWSZ),
         git_tag_target_type(tag),
-        OdbObjectsData::TagInfo::kUnsetDepth,
-        OdbObjectsData::kUnreachable};
+        OdbObjectsData::TagInfo::kUnsetDepth};
 
       { // lock
         std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.tags);
@@ -588,6 +559,9 @@ OdbObjectsData::TreeInfoAndStats WorkerStoreOdbData::thisTreeInfoAndStats(const
         te_oid = git_tree_entry_id(te);
         treeInfoAndStats.entryBlobs.emplace_back(
           reinterpret_cast<const char *>(te_oid->id), GIT_OID_RAWSZ);
+        if (m_storeEntryNames) {
+          treeInfoAndStats.entryBlobsNames.emplace_back(git_tree_entry_name(te));
+        }
       }
         break;
         
@@ -601,6 +575,9 @@ OdbObjectsData::TreeInfoAndStats WorkerStoreOdbData::thisTreeInfoAndStats(const
         treeInfoAndStats.entryTreesNameLen.emplace_back(std::make_pair(
           std::string(reinterpret_cast<const char *>(te_oid->id), GIT_OID_RAWSZ),
           teNameLen));
+        if (m_storeEntryNames) {
+          treeInfoAndStats.entryTreesNames.emplace_back(teName, teNameLen);
+        }
       }
         break;
         
@@ -613,216 +590,314 @@ OdbObjectsData::TreeInfoAndStats WorkerStoreOdbData::thisTreeInfoAndStats(const
 }
 
 /**
- * \class WorkItemOidStrType
- * WorkItem storing pointers to object info structs for the WorkPool.
+ * \class ReachabilityMarker
+ * Marks, in the 'reachable' bitsets of OdbObjectsData, every object reachable from a set of roots.
+ * Each thread owns a stack of objects pending to visit, initially filled out with a share of
+ * the roots. When its own stack runs out, a thread steals half of the pending objects of another one,
+ * so that threads keep busy even if the roots reach very different amounts of history.
+ * An object is pushed only by the thread which sets its bit, hence it is visited only once.
+ * NOTE: object info containers are only read while marking, so looking them up from several
+ * threads is safe.
  */
-class WorkItemOidStrType : public WorkItem {
+class ReachabilityMarker
+{
 public:
-  WorkItemOidStrType(void *objectInfo, git_object_t type)
-    : m_objectInfo(objectInfo), m_oid_type(type) {}
-  ~WorkItemOidStrType() = default;
-  WorkItemOidStrType(const WorkItemOidStrType &other) = delete;
-  WorkItemOidStrType(WorkItemOidStrType &&other) = delete;
-  WorkItemOidStrType& operator=(const WorkItemOidStrType &other) = delete;
-  WorkItemOidStrType& operator=(WorkItemOidStrType &&other) = delete;
-  
-  void* GetObjectInfo() const { return m_objectInfo; }
-  const git_object_t& GetOidType() const { return m_oid_type; }
+  ReachabilityMarker(OdbObjectsData *odbObjectsData, unsigned int numThreads);
+  ~ReachabilityMarker() = default;
+  ReachabilityMarker(const ReachabilityMarker &other) = delete;
+  ReachabilityMarker(ReachabilityMarker &&other) = delete;
+  ReachabilityMarker& operator=(const ReachabilityMarker &other) = delete;
+  ReachabilityMarker& operator=(ReachabilityMarker &&other) = delete;
+
+  void AddRoot(const std::string &oid, git_object_t type);
+  bool Run();
 
 private:
-  void *m_objectInfo {nullptr};
-  git_object_t m_oid_type {};
+  // object pending to visit; only commits, trees and tags reach other objects
+  struct PendingObject {
+    git_object_t type {GIT_OBJECT_INVALID};
+    const void *info {nullptr};
+  };
+
+  struct WorkStack {
+    std::mutex mutex {};
+    std::deque<PendingObject> objects {};
+  };
+
+  void work(unsigned int threadIndex);
+  bool pop(unsigned int threadIndex, PendingObject &object);
+  bool steal(unsigned int threadIndex, PendingObject &object);
+  void visit(const PendingObject &object, std::vector<PendingObject> &reached);
+  void mark(const std::string &oid, git_object_t type, std::vector<PendingObject> &reached);
+
+  OdbObjectsData *m_odbObjectsData {nullptr};
+  std::vector< std::unique_ptr<WorkStack> > m_stacks {};
+  // objects pushed and not completely visited yet; marking ends when it reaches 0
+  std::atomic<size_t> m_pending {0};
+  unsigned int m_nextRootStack {0};
 };
 
 /**
- * \class WorkerReachCounter
- * Worker for the WorkPool to count reachability of each object.
+ * ReachabilityMarker::ReachabilityMarker
  */
-class WorkerReachCounter : public IWorker
+ReachabilityMarker::ReachabilityMarker(OdbObjectsData *odbObjectsData, unsigned int numThreads)
+  : m_odbObjectsData(odbObjectsData)
 {
-public:
-  WorkerReachCounter(OdbObjectsData *odbObjectsData)
-    : m_odbObjectsData(odbObjectsData) {}
-  ~WorkerReachCounter() = default;
-  WorkerReachCounter(const WorkerReachCounter &other) = delete;
-  WorkerReachCounter(WorkerReachCounter &&other) = delete;
-  WorkerReachCounter& operator=(const WorkerReachCounter &other) = delete;
-  WorkerReachCounter& operator=(WorkerReachCounter &&other) = delete;
-
-  bool Initialize() { return true; }
-  bool Execute(std::unique_ptr<WorkItem> &&work);
+  for (unsigned int i = 0; i < numThreads; ++i) {
+    m_stacks.emplace_back(std::make_unique<WorkStack>());
+  }
+}
 
-private:
-  void setReachabilityFromTags(void *objectInfo);
-  void setReachabilityFromCommits(void *objectInfo);
-  void setReachabilityFromTrees(void *objectInfo);
+/**
+ * ReachabilityMarker::AddRoot
+ * Marks a root object and distributes it among the threads' stacks.
+ * NOTE: not thread safe, must be called before Run().
+ */
+void ReachabilityMarker::AddRoot(const std::string &oid, git_object_t type)
+{
+  std::vector<PendingObject> reached {};
+  mark(oid, type, reached);
 
-  OdbObjectsData *m_odbObjectsData {nullptr};
-};
+  for (const PendingObject &object : reached) {
+    m_stacks.at(m_nextRootStack)->objects.emplace_back(object);
+    m_nextRootStack = (m_nextRootStack + 1) % m_stacks.size();
+    ++m_pending;
+  }
+}
 
 /**
- * WorkerReachCounter::Execute
+ * ReachabilityMarker::Run
+ * Marks all the objects reachable from the roots added, and waits until it's done.
+ * \return false if threads could not be created; true otherwise.
  */
-bool WorkerReachCounter::Execute(std::unique_ptr<WorkItem> &&work)
+bool ReachabilityMarker::Run()
 {
-  std::unique_ptr<WorkItemOidStrType> wi {static_cast<WorkItemOidStrType*>(work.release())};
-  void *objectInfo = wi->GetObjectInfo();
-  const git_object_t &oid_type = wi->GetOidType();
+  const unsigned int numThreads = static_cast<unsigned int>(m_stacks.size());
+  std::vector<std::thread> threads {};
+  bool success {true};
 
-  switch (oid_type) {
-    case GIT_OBJECT_TAG:
-      setReachabilityFromTags(objectInfo);
-      break;
-    case GIT_OBJECT_COMMIT:
-      setReachabilityFromCommits(objectInfo);
-      break;
-    case GIT_OBJECT_TREE:
-      setReachabilityFromTrees(objectInfo);
-      break;
-    case GIT_OBJECT_BLOB:
-      // do not process blobs in this stage
-      break;
-    default:
-      break;
+  try {
+    for (unsigned int i = 0; i < numThreads; ++i) {
+      threads.emplace_back(std::bind(&ReachabilityMarker::work, this, i));
+    }
+  }
+  catch (const std::system_error &) {
+    // threads already started will drain all the pending work
+    success = false;
   }
 
-  return true;
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  return success && m_pending == 0;
 }
 
 /**
- * WorkerReachCounter::setReachabilityFromTags
- * Adds reachability counter where tags point (any type of object).
+ * ReachabilityMarker::work
+ * Thread's loop: visits objects from its own stack, or stolen from others,
+ * until there is nothing pending in any of the stacks.
  */
-void WorkerReachCounter::setReachabilityFromTags(void *objectInfo)
+void ReachabilityMarker::work(unsigned int threadIndex)
 {
-  const OdbObjectsData::TagInfo *tagInfo = static_cast<const OdbObjectsData::TagInfo *>(objectInfo);
+  std::vector<PendingObject> reached {};
+  PendingObject object {};
 
-  switch (tagInfo->typeTarget) {
-    case GIT_OBJECT_COMMIT:
-    {
-      OdbObjectsData::iterCommitInfo itCommitInfo =
-      m_odbObjectsData->commits.info.find(tagInfo->oidTarget);
-    
-      if (itCommitInfo != m_odbObjectsData->commits.info.end()) {
+  while (true) {
+    if (pop(threadIndex, object) || steal(threadIndex, object)) {
+      visit(object, reached);
+
+      if (!reached.empty()) {
+        WorkStack &stack = *m_stacks.at(threadIndex);
+        m_pending += reached.size();
         { // lock
-          std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.commits);
-          ++itCommitInfo->second.reachability;
+          std::lock_guard<std::mutex> lock(stack.mutex);
+          stack.objects.insert(stack.objects.end(), reached.begin(), reached.end());
         }
+        reached.clear();
       }
+      // decrement only after pushing what it reaches, so that m_pending can't be 0 too early
+      --m_pending;
     }
+    else if (m_pending == 0) {
       break;
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+}
 
-    case GIT_OBJECT_TREE:
+/**
+ * ReachabilityMarker::pop
+ * Takes the last object pushed to this thread's stack (depth first, for locality).
+ */
+bool ReachabilityMarker::pop(unsigned int threadIndex, PendingObject &object)
+{
+  WorkStack &stack = *m_stacks.at(threadIndex);
+  std::lock_guard<std::mutex> lock(stack.mutex);
+
+  if (stack.objects.empty()) {
+    return false;
+  }
+  object = stack.objects.back();
+  stack.objects.pop_back();
+
+  return true;
+}
+
+/**
+ * ReachabilityMarker::steal
+ * Takes the oldest half of the objects pending in another thread's stack.
+ * Keeps one to visit, and moves the rest to this thread's stack.
+ */
+bool ReachabilityMarker::steal(unsigned int threadIndex, PendingObject &object)
+{
+  const size_t numStacks = m_stacks.size();
+  std::vector<PendingObject> stolen {};
+
+  for (size_t i = 1; i < numStacks && stolen.empty(); ++i) {
+    WorkStack &victim = *m_stacks.at((threadIndex + i) % numStacks);
+    std::lock_guard<std::mutex> lock(victim.mutex);
+
+    const size_t numToSteal = (victim.objects.size() + 1) / 2;
+    stolen.assign(victim.objects.begin(), victim.objects.begin() + numToSteal);
+    victim.objects.erase(victim.objects.begin(), victim.objects.begin() + numToSteal);
+  }
+
+  if (stolen.empty()) {
+    return false;
+  }
+
+  object = stolen.back();
+  stolen.pop_back();
+
+  if (!stolen.empty()) {
+    WorkStack &stack = *m_stacks.at(threadIndex);
+    std::lock_guard<std::mutex> lock(stack.mutex);
+    stack.objects.insert(stack.objects.end(), stolen.begin(), stolen.end());
+  }
+
+  return true;
+}
+
+/**
+ * ReachabilityMarker::visit
+ * Marks the objects an object points to.
+ * \param reached filled out with the newly marked objects which need to be visited.
+ */
+void ReachabilityMarker::visit(const PendingObject &object, std::vector<PendingObject> &reached)
+{
+  switch (object.type) {
+    case GIT_OBJECT_COMMIT:
     {
-      OdbObjectsData::iterTreeInfo itTreeInfo =
-      m_odbObjectsData->trees.info.find(tagInfo->oidTarget);
-    
-      if (itTreeInfo != m_odbObjectsData->trees.info.end()) {
-        { // lock
-          std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.trees);
-          ++itTreeInfo->second.reachability;
-        }
+      const OdbObjectsData::CommitInfo *commitInfo =
+        static_cast<const OdbObjectsData::CommitInfo *>(object.info);
+      for (const std::string &parent : commitInfo->parents) {
+        mark(parent, GIT_OBJECT_COMMIT, reached);
       }
+      mark(commitInfo->oidTree, GIT_OBJECT_TREE, reached);
     }
+      break;
 
-    case GIT_OBJECT_BLOB:
+    case GIT_OBJECT_TREE:
     {
-      OdbObjectsData::iterBlobInfo itBlobInfo =
-      m_odbObjectsData->blobs.info.find(tagInfo->oidTarget);
-    
-      if (itBlobInfo != m_odbObjectsData->blobs.info.end()) {
-        { // lock
-          std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.blobs);
-          ++itBlobInfo->second.reachability;
-        }
+      const OdbObjectsData::TreeInfoAndStats *treeInfo =
+        static_cast<const OdbObjectsData::TreeInfoAndStats *>(object.info);
+      for (const std::string &blob : treeInfo->entryBlobs) {
+        mark(blob, GIT_OBJECT_BLOB, reached);
+      }
+      for (const auto &treeNameLen : treeInfo->entryTreesNameLen) {
+        mark(treeNameLen.first, GIT_OBJECT_TREE, reached);
       }
     }
+      break;
 
     case GIT_OBJECT_TAG:
     {
-      OdbObjectsData::iterTagInfo itTargetTagInfo =
-      m_odbObjectsData->tags.info.find(tagInfo->oidTarget);
-    
-      if (itTargetTagInfo != m_odbObjectsData->tags.info.end()) {
-        { // lock
-          std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.tags);
-          ++itTargetTagInfo->second.reachability;
-        }
-      }
+      const OdbObjectsData::TagInfo *tagInfo = static_cast<const OdbObjectsData::TagInfo *>(object.info);
+      mark(tagInfo->oidTarget, tagInfo->typeTarget, reached);
     }
+      break;
+
     default:
       break;
   }
 }
 
 /**
- * WorkerReachCounter::setReachabilityFromCommits
- * Adds reachability counter where commits point (parents and tree).
+ * ReachabilityMarker::mark
+ * Sets the reachable bit of an object, if it exists.
+ * \param reached object added if this call marked it and it can reach other objects.
  */
-void WorkerReachCounter::setReachabilityFromCommits(void *objectInfo)
+void ReachabilityMarker::mark(const std::string &oid, git_object_t type, std::vector<PendingObject> &reached)
 {
-  const OdbObjectsData::CommitInfo *commitInfo =
-    static_cast<const OdbObjectsData::CommitInfo *>(objectInfo);
-  const size_t numParents = commitInfo->parents.size();
-
-  // set parents' reachability
-  for (size_t i = 0; i < numParents; ++i) {
-    OdbObjectsData::iterCommitInfo itParentCommitInfo =
-      m_odbObjectsData->commits.info.find(commitInfo->parents.at(i));
-    
-    if (itParentCommitInfo != m_odbObjectsData->commits.info.end()) {
-      { // lock
-        std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.commits);
-        ++itParentCommitInfo->second.reachability;
+  switch (type) {
+    case GIT_OBJECT_COMMIT:
+    {
+      OdbObjectsData::iterCommitInfo itCommitInfo = m_odbObjectsData->commits.info.find(oid);
+      if (itCommitInfo != m_odbObjectsData->commits.info.end() &&
+        m_odbObjectsData->commits.reachable.TestAndSet(itCommitInfo->second.index))
+      {
+        reached.emplace_back(PendingObject {GIT_OBJECT_COMMIT, &itCommitInfo->second});
       }
     }
-  }
+      break;
+
+    case GIT_OBJECT_TREE:
+    {
+      OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData->trees.info.find(oid);
+      if (itTreeInfo != m_odbObjectsData->trees.info.end() &&
+        m_odbObjectsData->trees.reachable.TestAndSet(itTreeInfo->second.index))
+      {
+        reached.emplace_back(PendingObject {GIT_OBJECT_TREE, &itTreeInfo->second});
+      }
+    }
+      break;
+
+    case GIT_OBJECT_BLOB:
+    {
+      // blobs do not reach any other object, hence no need to visit them
+      OdbObjectsData::iterBlobInfo itBlobInfo = m_odbObjectsData->blobs.info.find(oid);
+      if (itBlobInfo != m_odbObjectsData->blobs.info.end()) {
+        m_odbObjectsData->blobs.reachable.TestAndSet(itBlobInfo->second.index);
+      }
+    }
+      break;
 
-  // add 1 to its tree's reachability
-  OdbObjectsData::iterTreeInfo itCommitTreeInfo =
-    m_odbObjectsData->trees.info.find(commitInfo->oidTree);
-  
-  if (itCommitTreeInfo != m_odbObjectsData->trees.info.end()) {
-    { // lock
-      std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.trees);
-      ++itCommitTreeInfo->second.reachability;
+    case GIT_OBJECT_TAG:
+    {
+      OdbObjectsData::iterTagInfo itTagInfo = m_odbObjectsData->tags.info.find(oid);
+      if (itTagInfo != m_odbObjectsData->tags.info.end() &&
+        m_odbObjectsData->tags.reachable.TestAndSet(itTagInfo->second.index))
+      {
+        reached.emplace_back(PendingObject {GIT_OBJECT_TAG, &itTagInfo->second});
+      }
     }
+      break;
+
+    default:
+      break;
   }
 }
 
 /**
- * WorkerReachCounter::setReachabilityFromTrees
- * Adds reachability counter where tree entries point (blobs and other trees).
+ * \struct ForEachOdbPayload
+ * Payload for forEachOdbCb: oids are queued in batches.
  */
-void WorkerReachCounter::setReachabilityFromTrees(void *objectInfo)
+struct ForEachOdbPayload
 {
-  const OdbObjectsData::TreeInfoAndStats *treeInfo =
-    static_cast<const OdbObjectsData::TreeInfoAndStats *>(objectInfo);
-
-  // set entry blobs' reachability
-  for (auto &blob : treeInfo->entryBlobs) {
-    OdbObjectsData::iterBlobInfo itBlobInfo = m_odbObjectsData->blobs.info.find(blob);
-    
-    if (itBlobInfo != m_odbObjectsData->blobs.info.end()) {
-      { // lock
-        std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.blobs);
-        ++itBlobInfo->second.reachability;
-      }
-    }
-  }
+  WorkerPool<WorkerStoreOdbData,WorkItemOids> *workerPool {nullptr};
+  std::unique_ptr<WorkItemOids> batch {};
 
-  // set entry trees' reachability
-  for (auto &treeNameLen : treeInfo->entryTreesNameLen) {
-    OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData->trees.info.find(treeNameLen.first);
-    
-    if (itTreeInfo != m_odbObjectsData->trees.info.end()) {
-      { // lock
-        std::lock_guard<std::mutex> lock(m_odbObjectsData->infoMutex.trees);
-        ++itTreeInfo->second.reachability;
-      }
+  // queues the batch being filled out, if any
+  void Flush() {
+    if (batch && !batch->Empty()) {
+      workerPool->InsertWork(std::move(batch));
     }
+    batch.reset();
   }
-}
+};
 
 /**
  * forEachOdbCb. Callback for git_odb_foreach.
@@ -830,15 +905,21 @@ void WorkerReachCounter::setReachabilityFromTrees(void *objectInfo)
  */
 static int forEachOdbCb(const git_oid *oid, void *payloadToCast)
 {
-  WorkerPool<WorkerStoreOdbData,WorkItemOid> *workerPool =
-    static_cast<WorkerPool<WorkerStoreOdbData,WorkItemOid>*>(payloadToCast);
+  ForEachOdbPayload *payload = static_cast<ForEachOdbPayload *>(payloadToCast);
 
   // Must insert copies of oid, since the pointers might not survive until worker thread picks it up
-  workerPool->InsertWork(std::make_unique<WorkItemOid>(*oid));
+  if (!payload->batch) {
+    payload->batch = std::make_unique<WorkItemOids>();
+  }
+  payload->batch->Add(*oid);
 
-  // check there were no problems inserting work
-  if (workerPool->Status() != WPStatus::kOk) {
-    return GIT_EUSER;
+  if (payload->batch->Full()) {
+    payload->Flush();
+
+    // check there were no problems inserting work
+    if (payload->workerPool->Status() != WPStatus::kOk) {
+      return GIT_EUSER;
+    }
   }
 
   return GIT_OK;
@@ -853,8 +934,8 @@ class RepoAnalysis
 public:
   static constexpr unsigned int kMinThreads = 4;
 
-  explicit RepoAnalysis(git_repository *repo)
-    : m_repo(repo) {}
+  RepoAnalysis(git_repository *repo, const RepoAnalysisOptions &options)
+    : m_repo(repo), m_options(options) {}
   ~RepoAnalysis() = default;
   RepoAnalysis(const RepoAnalysis &other) = delete;
   RepoAnalysis(RepoAnalysis &&other) = delete;
@@ -868,17 +949,12 @@ private:
   // stage 1 methods: store data from repository (with threads)
   int storeObjectsInfo();
   int storeAndCountRefs();
-  // stage 2 methods: count reachability of each object (with threads)
+  // stage 2 methods: mark reachable objects (with threads)
   // NOTE: we need this stage, since so far libgit2 doesn't provide unreachable objects
   bool setObjectsReachability();
-  void setReachabilityFromRefs();
-  void setUnreachables();
+  void setObjectsIndices();
   // stage 3 methods: prune unreachable oids
   void pruneUnreachables();
-  void pruneUnreachableTags();
-  void pruneUnreachableCommits();
-  void pruneUnreachableTrees();
-  void pruneUnreachableBlobs();
   // stage 4 methods: repositorySize and biggestObjects
   void statsCountAndMax();
   // stage 5 methods: historyStructure and biggestCheckouts
@@ -887,19 +963,48 @@ private:
   OdbObjectsData::iterTreeInfo calculateTreeStatistics(const std::string &oidTree);
   bool calculateMaxTagDepth();
   OdbObjectsData::iterTagInfo calculateTagDepth(const std::string &oidTag);
+  // stage 6 methods (optional): sizeByPath
+  void statsSizeByPath();
+  void attributeTreePaths(const std::string &oidTree, const std::string &pathPrefix,
+    std::unordered_map<std::string, size_t> &dirsSize, std::unordered_map<std::string, size_t> &filesSize);
   // methods to return the statistics calculated
   void fillOutStatistics();
   v8::Local<v8::Object> repositorySizeToJS() const;
   v8::Local<v8::Object> biggestObjectsToJS() const;
   v8::Local<v8::Object> historyStructureToJS() const;
   v8::Local<v8::Object> biggestCheckoutsToJS() const;
+  v8::Local<v8::Object> sizeByPathToJS() const;
+  // quick mode methods: check limits, from the cheapest signal to the most expensive one
+  int quickAnalyze();
+  bool quickBudgetLeft();
+  bool quickDone() const;
+  int quickScanObjectHeaders();
+  int quickScanObjectHeader(const git_oid *oid, git_odb *odb);
+  int quickCheckTreeEntries();
+  int quickCheckHistoryDepth();
+  v8::Local<v8::Object> quickStatisticsToJS() const;
 
   git_repository *m_repo {nullptr};
+  RepoAnalysisOptions m_options {};
   Statistics m_statistics {};
+  // commit oids sorted so that parents come before their children.
+  // Only filled out when sizeByPath statistics are requested.
+  std::vector<const std::string *> m_commitsParentsFirst {};
   // odb objects info to build while reading the object database by each thread
   OdbObjectsData m_odbObjectsData {};
   // oid and type of peeled references
   std::unordered_map<std::string, git_object_t> m_peeledRefs {};
+  // quick mode progress and results
+  struct {
+    std::chrono::steady_clock::time_point start {};
+    size_t objectsRead {0};
+    bool partial {false};
+    std::vector<std::string> limitsExceeded {};
+    std::vector<std::string> limitsChecked {};
+    // trees whose size allows them to exceed limits.treeEntries
+    std::vector<git_oid> treesToCheck {};
+    bool maxDepthCalculated {false};
+  } m_quick {};
 };
 
 /**
@@ -912,6 +1017,10 @@ int RepoAnalysis::Analyze()
 {
   int errorCode {GIT_OK};
 
+  if (m_options.IsQuick()) {
+    return quickAnalyze();
+  }
+
   // stage 1
   if ((errorCode = storeObjectsInfo() != GIT_OK)) {
     return errorCode;
@@ -933,6 +1042,11 @@ int RepoAnalysis::Analyze()
     return GIT_EUSER;
   }
 
+  // stage 6
+  if (m_options.sizeByPathTopN > 0) {
+    statsSizeByPath();
+  }
+
   fillOutStatistics();
 
   return errorCode;
@@ -943,6 +1057,10 @@ int RepoAnalysis::Analyze()
  */
 v8::Local<v8::Object> RepoAnalysis::StatisticsToJS() const
 {
+  if (m_options.IsQuick()) {
+    return quickStatisticsToJS();
+  }
+
   v8::Local<v8::Object> result = Nan::New<Object>();
 
   v8::Local<v8::Object> repositorySize = repositorySizeToJS();
@@ -957,6 +1075,11 @@ v8::Local<v8::Object> RepoAnalysis::StatisticsToJS() const
   v8::Local<v8::Object> biggestCheckouts = biggestCheckoutsToJS();
   Nan::Set(result, Nan::New("biggestCheckouts").ToLocalChecked(), biggestCheckouts);
 
+  if (m_options.sizeByPathTopN > 0) {
+    v8::Local<v8::Object> sizeByPath = sizeByPathToJS();
+    Nan::Set(result, Nan::New("sizeByPath").ToLocalChecked(), sizeByPath);
+  }
+
   return result;
 }
 
@@ -964,7 +1087,7 @@ v8::Local<v8::Object> RepoAnalysis::StatisticsToJS() const
  * RepoAnalysis::storeObjectsInfo
  * Store information from read odb objects.
  * Starts building a container which eventually will hold only reachable objects.
- * Leverages threads via a worker pool <WorkerStoreOdbData,WorkItemOid>.
+ * Leverages threads via a worker pool <WorkerStoreOdbData,WorkItemOids>.
  */
 int RepoAnalysis::storeObjectsInfo()
 {
@@ -983,18 +1106,22 @@ int RepoAnalysis::storeObjectsInfo()
 
   std::vector< std::shared_ptr<WorkerStoreOdbData> > workers {};
   for (unsigned int i = 0; i < numThreads; ++i) {
-    workers.emplace_back(std::make_shared<WorkerStoreOdbData>(repoPath, &m_odbObjectsData));
+    workers.emplace_back(std::make_shared<WorkerStoreOdbData>(repoPath, &m_odbObjectsData,
+      m_options.sizeByPathTopN > 0));
   }
 
   // initialize worker pool
-  WorkerPool<WorkerStoreOdbData,WorkItemOid> workerPool {};  
+  WorkerPool<WorkerStoreOdbData,WorkItemOids> workerPool {};  
   workerPool.Init(workers);
 
-  if ((errorCode = git_odb_foreach(odb, forEachOdbCb, &workerPool)) != GIT_OK) {
+  ForEachOdbPayload payload {&workerPool};
+  if ((errorCode = git_odb_foreach(odb, forEachOdbCb, &payload)) != GIT_OK) {
     workerPool.Shutdown();
     git_odb_free(odb);
     return errorCode;
   }
+  // queue the last oids read
+  payload.Flush();
 
   // main thread will work on the refs while waiting for the threads to finish
   if ((errorCode = storeAndCountRefs() != GIT_OK)) {
@@ -1097,149 +1224,75 @@ int RepoAnalysis::storeAndCountRefs()
 
 /**
  * RepoAnalysis::setObjectsReachability
- * Leverages threads via a worker pool <WorkerReachCounter,WorkItemOidStrType> to
- * set reachability from tags, commits, and trees.
- * NOTE: the worker pool leveraged in this method runs at a different stage than the
- * worker pool leveraged in previous stages, meaning they do not run at the same time, hence
+ * Marks as reachable all the objects that can be reached from the peeled references, following
+ * tags, commits' parents and trees, and trees' entries.
+ * Leverages threads via ReachabilityMarker, which partitions the references among threads
+ * and balances the traversal with work stealing.
+ * NOTE: this stage does not run at the same time as the worker pool from previous stages, hence
  * access to 'm_odbObjectsData->....info' won't suffer from a data race.
- * NOTE: performance didn't improve leveraging threads for adding objects to unreachables container.
- * \return false if the workerPool finished with errors; true otherwise
+ * \return false if marking finished with errors; true otherwise
  */
 bool RepoAnalysis::setObjectsReachability()
 {
-  // references are not objects, hence they won't be sent to the worker threads
-  setReachabilityFromRefs();
+  setObjectsIndices();
 
   const unsigned int numThreads =
     std::max<unsigned int>(std::thread::hardware_concurrency(), static_cast<unsigned int>(kMinThreads));
-  std::vector< std::shared_ptr<WorkerReachCounter> > workers {};
-  for (unsigned int i = 0; i < numThreads; ++i) {
-    workers.emplace_back(std::make_shared<WorkerReachCounter>(&m_odbObjectsData));
+  ReachabilityMarker marker(&m_odbObjectsData, numThreads);
+
+  // references are not objects, so they are the roots of the traversal
+  for (const auto &ref : m_peeledRefs) {
+    marker.AddRoot(ref.first, ref.second);
   }
 
-  // initialize worker pool
-  WorkerPool<WorkerReachCounter,WorkItemOidStrType> workerPool {};  
-  workerPool.Init(workers);
+  return marker.Run();
+}
 
-  // NOTE: avoid queueing same type of objects in a row, so that different mutex can be used concurrently
-  uint8_t workInserted {0};
-  OdbObjectsData::iterTagInfo itTagInfo = m_odbObjectsData.tags.info.begin();
-  OdbObjectsData::iterCommitInfo itCommitInfo = m_odbObjectsData.commits.info.begin();
-  OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData.trees.info.begin();
-  do {
-    workInserted = 0;
-    // insert tag
-    if (itTagInfo != m_odbObjectsData.tags.info.end()) {
-      workerPool.InsertWork(std::make_unique<WorkItemOidStrType>(&itTagInfo->second, GIT_OBJECT_TAG));
-      ++itTagInfo;
-      ++workInserted;
-    }
-    // insert commmit
-    if (itCommitInfo != m_odbObjectsData.commits.info.end()) {
-      workerPool.InsertWork(std::make_unique<WorkItemOidStrType>(&itCommitInfo->second, GIT_OBJECT_COMMIT));
-      ++itCommitInfo;
-      ++workInserted;
-    }
-    // insert tree
-    if (itTreeInfo != m_odbObjectsData.trees.info.end()) {
-      workerPool.InsertWork(std::make_unique<WorkItemOidStrType>(&itTreeInfo->second, GIT_OBJECT_TREE));
-      ++itTreeInfo;
-      ++workInserted;
-    }
-    // blobs do not reach to any other object, hence no need to process them
-  } while (workInserted);
+/**
+ * RepoAnalysis::setObjectsIndices
+ * Gives each object a dense index among the objects of its type,
+ * and sizes the reachability bitsets accordingly.
+ */
+void RepoAnalysis::setObjectsIndices()
+{
+  uint32_t index {0};
+  for (auto &tag : m_odbObjectsData.tags.info) {
+    tag.second.index = index++;
+  }
+  m_odbObjectsData.tags.reachable.Reset(index);
 
-  // wait for the threads to finish and shutdown the work pool
-  workerPool.Shutdown();
+  index = 0;
+  for (auto &commit : m_odbObjectsData.commits.info) {
+    commit.second.index = index++;
+  }
+  m_odbObjectsData.commits.reachable.Reset(index);
 
-  // check there were no problems during execution
-  if (workerPool.Status() != WPStatus::kOk) {
-    return false;
+  index = 0;
+  for (auto &tree : m_odbObjectsData.trees.info) {
+    tree.second.index = index++;
   }
+  m_odbObjectsData.trees.reachable.Reset(index);
 
-  setUnreachables();
-
-  return true;
-}
-
-/**
- * RepoAnalysis::setReachabilityFromRefs
- * Adds reachability counter where peeled refs point (normally a commit or a tag).
-  */
-void RepoAnalysis::setReachabilityFromRefs()
-{
-  for (const auto &ref : m_peeledRefs) {
-    switch (ref.second) {
-      case GIT_OBJECT_COMMIT:
-      {
-        OdbObjectsData::iterCommitInfo itCommitInfo =
-        m_odbObjectsData.commits.info.find(ref.first);
-      
-        if (itCommitInfo != m_odbObjectsData.commits.info.end()) {
-          ++itCommitInfo->second.reachability;
-        }
-      }
-        break;
-      case GIT_OBJECT_TREE:
-      {
-        OdbObjectsData::iterTreeInfo itTreeInfo =
-        m_odbObjectsData.trees.info.find(ref.first);
-      
-        if (itTreeInfo != m_odbObjectsData.trees.info.end()) {
-          ++itTreeInfo->second.reachability;
-        }
-      }
-        break;
-      case GIT_OBJECT_BLOB:
-      {
-        OdbObjectsData::iterBlobInfo itBlobInfo =
-        m_odbObjectsData.blobs.info.find(ref.first);
-      
-        if (itBlobInfo != m_odbObjectsData.blobs.info.end()) {
-          ++itBlobInfo->second.reachability;
-        }
-      }
-        break;
-      case GIT_OBJECT_TAG:
-      {
-        OdbObjectsData::iterTagInfo itTagInfo =
-        m_odbObjectsData.tags.info.find(ref.first);
-      
-        if (itTagInfo != m_odbObjectsData.tags.info.end()) {
-          ++itTagInfo->second.reachability;
-        }
-      }
-        break;
-      default:
-        break;
-    }
+  index = 0;
+  for (auto &blob : m_odbObjectsData.blobs.info) {
+    blob.second.index = index++;
   }
+  m_odbObjectsData.blobs.reachable.Reset(index);
 }
 
 /**
- * RepoAnalysis::setUnreachables
- * After setting reachability, we add the unreached objects to their unreachables container.
+ * eraseUnreachables
+ * Removes from an object info container the objects not marked as reachable.
  */
-void RepoAnalysis::setUnreachables()
+template <typename InfoContainer>
+static void eraseUnreachables(InfoContainer &info, const AtomicBitset &reachable)
 {
-  for (const auto &tag : m_odbObjectsData.tags.info) {
-    if (!tag.second.reachability) {
-      m_odbObjectsData.tags.unreachables.emplace(tag.first);
+  for (auto it = info.begin(); it != info.end(); ) {
+    if (reachable.Test(it->second.index)) {
+      ++it;
     }
-  }
-  for (const auto &commit : m_odbObjectsData.commits.info) {
-    if (!commit.second.reachability) {
-      m_odbObjectsData.commits.unreachables.emplace(commit.first);
-    }
-  }
-  for (const auto &tree : m_odbObjectsData.trees.info) {
-    if (!tree.second.reachability) {
-      m_odbObjectsData.trees.unreachables.emplace(tree.first);
-    }
-  }
-  for (const auto &blob : m_odbObjectsData.blobs.info) {
-    if (!blob.second.reachability) {
-      m_odbObjectsData.blobs.unreachables.emplace(blob.first);
+    else {
+      it = info.erase(it);
     }
   }
 }
@@ -1247,192 +1300,15 @@ void RepoAnalysis::setUnreachables()
 /**
  * RepoAnalysis::pruneUnreachables
  * Removes from their containers the unreachable objects.
- * Decreases reachability of the objects they can reach.
+ * Since reachability was marked following the whole history from the references,
+ * objects only reachable from unreachable ones are unmarked too, and no cascade is needed.
   */
 void RepoAnalysis::pruneUnreachables()
 {
-  // NOTE: order is important here, since each method prunes its own objects, but
-  // only decreases reachability of the objects connected to it; and those
-  // connected objects will be checked and pruned afterwards.
-  pruneUnreachableTags();
-  pruneUnreachableCommits();
-  pruneUnreachableTrees();
-  pruneUnreachableBlobs();
-}
-
-/**
- * RepoAnalysis::pruneUnreachableTags
- * Prune tags and their chained tags if they become unreachable.
- * Also decreases reachability of targets.
-  */
-void RepoAnalysis::pruneUnreachableTags()
-{
-  while (!m_odbObjectsData.tags.unreachables.empty()) {
-    std::unordered_set<std::string> newUnreachables {};
-
-    // erase unreachable tags
-    for (OdbObjectsData::iterUnreachable itTagUnrch = m_odbObjectsData.tags.unreachables.begin();
-      itTagUnrch != m_odbObjectsData.tags.unreachables.end(); ++itTagUnrch)
-    {
-      OdbObjectsData::iterTagInfo itTagInfo = m_odbObjectsData.tags.info.find(*itTagUnrch);
-    
-      if (itTagInfo != m_odbObjectsData.tags.info.end()) {
-        const std::string &oidTarget = itTagInfo->second.oidTarget;
-        switch (itTagInfo->second.typeTarget) {
-          case GIT_OBJECT_TAG:
-          {
-            // if target is another tag, add it to newUnreachables
-            OdbObjectsData::iterTagInfo itTargetTagInfo = m_odbObjectsData.tags.info.find(oidTarget);
-            if (itTargetTagInfo != m_odbObjectsData.tags.info.end()) {
-              if (--itTargetTagInfo->second.reachability == OdbObjectsData::kUnreachable) {
-                newUnreachables.emplace(itTargetTagInfo->first);
-              }
-            }
-          }
-            break;
-          case GIT_OBJECT_COMMIT:
-          {
-            OdbObjectsData::iterCommitInfo itCommitInfo = m_odbObjectsData.commits.info.find(oidTarget);
-            if (itCommitInfo != m_odbObjectsData.commits.info.end()) {
-              if (--itCommitInfo->second.reachability == OdbObjectsData::kUnreachable) {
-                m_odbObjectsData.commits.unreachables.emplace(itCommitInfo->first);
-              }
-            }
-          }
-            break;
-          case GIT_OBJECT_TREE:
-          {
-            OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData.trees.info.find(oidTarget);
-            if (itTreeInfo != m_odbObjectsData.trees.info.end()) {
-              if (--itTreeInfo->second.reachability == OdbObjectsData::kUnreachable) {
-                m_odbObjectsData.trees.unreachables.emplace(itTreeInfo->first);
-              }
-            }
-          }
-            break;
-          case GIT_OBJECT_BLOB:
-          {
-            OdbObjectsData::iterBlobInfo itBlobInfo = m_odbObjectsData.blobs.info.find(oidTarget);
-            if (itBlobInfo != m_odbObjectsData.blobs.info.end()) {
-              if (--itBlobInfo->second.reachability == OdbObjectsData::kUnreachable) {
-                m_odbObjectsData.blobs.unreachables.emplace(itBlobInfo->first);
-              }
-            }
-          }
-            break;
-          default:
-            break;
-        }
-        // erase tag from the tag's container
-        m_odbObjectsData.tags.info.erase(itTagInfo);
-      }
-    }
-    // set new unreachable tags
-    m_odbObjectsData.tags.unreachables = std::move(newUnreachables);
-  }
-}
-
-/**
- * RepoAnalysis::pruneUnreachableCommits
- * Prune commits and decrease reachability of their associated trees.
-  */
-void RepoAnalysis::pruneUnreachableCommits()
-{
-  while (!m_odbObjectsData.commits.unreachables.empty()) {
-    std::unordered_set<std::string> newUnreachables {};
-
-    // erase unreachable commits
-    for (OdbObjectsData::iterUnreachable itCommitUnrch = m_odbObjectsData.commits.unreachables.begin();
-      itCommitUnrch != m_odbObjectsData.commits.unreachables.end(); ++itCommitUnrch)
-    {
-      OdbObjectsData::iterCommitInfo itCommitInfo = m_odbObjectsData.commits.info.find(*itCommitUnrch);
-    
-      if (itCommitInfo != m_odbObjectsData.commits.info.end())
-      {
-        // decrease commit's parents reachability and add them as newUnreachable
-        const size_t numParents = itCommitInfo->second.parents.size();
-        for (size_t i = 0; i < numParents; ++i) {
-          OdbObjectsData::iterCommitInfo itParentCommitInfo =
-            m_odbObjectsData.commits.info.find(itCommitInfo->second.parents.at(i));
-          
-          if (itParentCommitInfo != m_odbObjectsData.commits.info.end()) {
-            if (--itParentCommitInfo->second.reachability == OdbObjectsData::kUnreachable) {
-              newUnreachables.emplace(itParentCommitInfo->first);
-            }
-          }
-        }
-        // decrease reachability of the commit's tree
-        OdbObjectsData::iterTreeInfo itTreeInfo =
-          m_odbObjectsData.trees.info.find(itCommitInfo->second.oidTree);
-        if (itTreeInfo != m_odbObjectsData.trees.info.end()) {
-          if (--itTreeInfo->second.reachability == OdbObjectsData::kUnreachable) {
-            m_odbObjectsData.trees.unreachables.emplace(itTreeInfo->first);
-          }
-        }
-        // erase commit from the commit's container
-        m_odbObjectsData.commits.info.erase(itCommitInfo);
-      }
-    }
-    // set new unreachable commits
-    m_odbObjectsData.commits.unreachables = std::move(newUnreachables);
-  }
-}
-
-/**
- * RepoAnalysis::pruneUnreachableTrees
- * Prune unreachable trees and decrement reachability of their entries.
-  */
-void RepoAnalysis::pruneUnreachableTrees()
-{
-  while (!m_odbObjectsData.trees.unreachables.empty()) {
-    std::unordered_set<std::string> newUnreachables {};
-
-    // erase unreachable trees
-    for (OdbObjectsData::iterUnreachable itTreeUnrch = m_odbObjectsData.trees.unreachables.begin();
-      itTreeUnrch != m_odbObjectsData.trees.unreachables.end(); ++itTreeUnrch)
-    {
-      OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData.trees.info.find(*itTreeUnrch);
-    
-      if (itTreeInfo != m_odbObjectsData.trees.info.end()) {
-        // decrease reachability of the entry blobs
-        for (auto &blob : itTreeInfo->second.entryBlobs) {
-          OdbObjectsData::iterBlobInfo itEntryBlobInfo = m_odbObjectsData.blobs.info.find(blob);
-          if (itEntryBlobInfo != m_odbObjectsData.blobs.info.end()) {
-            if (--itEntryBlobInfo->second.reachability == OdbObjectsData::kUnreachable) {
-              m_odbObjectsData.blobs.unreachables.emplace(blob);
-            }
-          }
-        }
-        // decrease reachability of the entry trees and add them as newUnreachables
-        for (auto &treeNameLen : itTreeInfo->second.entryTreesNameLen) {
-          OdbObjectsData::iterTreeInfo itEntryTreeInfo =
-            m_odbObjectsData.trees.info.find(treeNameLen.first);
-          if (itEntryTreeInfo != m_odbObjectsData.trees.info.end()) {
-            if (--itEntryTreeInfo->second.reachability == OdbObjectsData::kUnreachable) {
-              newUnreachables.emplace(treeNameLen.first);
-            }
-          }
-        }
-        // erase tree from the tree's container
-        m_odbObjectsData.trees.info.erase(itTreeInfo);
-      }
-    }
-    // set new unreachable trees
-    m_odbObjectsData.trees.unreachables = std::move(newUnreachables);
-  }
-}
-
-/**
- * RepoAnalysis::pruneUnreachableBlobs
- * Rremoves unreachable blobs from their container.
-  */
-void RepoAnalysis::pruneUnreachableBlobs()
-{
-  for (OdbObjectsData::iterUnreachable itBlobUnrch = m_odbObjectsData.blobs.unreachables.begin();
-    itBlobUnrch != m_odbObjectsData.blobs.unreachables.end(); ++itBlobUnrch)
-  {
-    m_odbObjectsData.blobs.info.erase(*itBlobUnrch);
-  }
+  eraseUnreachables(m_odbObjectsData.tags.info, m_odbObjectsData.tags.reachable);
+  eraseUnreachables(m_odbObjectsData.commits.info, m_odbObjectsData.commits.reachable);
+  eraseUnreachables(m_odbObjectsData.trees.info, m_odbObjectsData.trees.reachable);
+  eraseUnreachables(m_odbObjectsData.blobs.info, m_odbObjectsData.blobs.reachable);
 }
 
 /**
@@ -1493,7 +1369,8 @@ bool RepoAnalysis::statsHistoryAndBiggestCheckouts()
   }
 
   // calculate max commit history depth
-  m_statistics.historyStructure.maxDepth = m_odbObjectsData.commits.graph.CalculateMaxDepth();
+  m_statistics.historyStructure.maxDepth = m_odbObjectsData.commits.graph.CalculateMaxDepth(
+    m_options.sizeByPathTopN > 0 ? &m_commitsParentsFirst : nullptr);
 
   return true;
 }
@@ -1666,6 +1543,107 @@ OdbObjectsData::iterTagInfo RepoAnalysis::calculateTagDepth(const std::string &o
   return itTagInfo;
 }
 
+/**
+ * RepoAnalysis::statsSizeByPath
+ * Attributes the size of every unique blob to the path that introduced it, and adds it
+ * to that path and to all of its parent directories.
+ * Commits are visited parents first, so a blob is attributed to the path it had when it
+ * first appeared in history, which is what a git-sizer/filter-repo analysis reports.
+ * Only the top N directories and files by cumulative size are kept.
+ */
+void RepoAnalysis::statsSizeByPath()
+{
+  std::unordered_map<std::string, size_t> dirsSize {};
+  std::unordered_map<std::string, size_t> filesSize {};
+
+  for (const std::string *oidCommit : m_commitsParentsFirst) {
+    OdbObjectsData::iterCommitInfo itCommitInfo = m_odbObjectsData.commits.info.find(*oidCommit);
+    if (itCommitInfo == m_odbObjectsData.commits.info.end()) {
+      continue;
+    }
+    attributeTreePaths(itCommitInfo->second.oidTree, "", dirsSize, filesSize);
+  }
+
+  // so far directories only hold the size of the files directly under them,
+  // so roll their sizes up to their parent directories
+  std::unordered_map<std::string, size_t> cumulativeDirsSize {};
+  for (const auto &dirSize : dirsSize) {
+    std::string dirPath = dirSize.first;
+    while (!dirPath.empty()) {
+      cumulativeDirsSize[dirPath] += dirSize.second;
+      const size_t lastSeparator = dirPath.rfind('/');
+      dirPath.resize(lastSeparator == std::string::npos ? 0 : lastSeparator);
+    }
+  }
+
+  auto topN = [](const std::unordered_map<std::string, size_t> &pathsSize, size_t n) {
+    std::vector<PathSize> result {};
+    result.reserve(pathsSize.size());
+    for (const auto &pathSize : pathsSize) {
+      result.emplace_back(PathSize {pathSize.first, pathSize.second});
+    }
+    const size_t numResults = std::min<size_t>(n, result.size());
+    std::partial_sort(result.begin(), result.begin() + numResults, result.end(),
+      [](const PathSize &a, const PathSize &b) {
+        return a.size != b.size ? a.size > b.size : a.path < b.path;
+      });
+    result.resize(numResults);
+    return result;
+  };
+
+  m_statistics.sizeByPath.directories = topN(cumulativeDirsSize, m_options.sizeByPathTopN);
+  m_statistics.sizeByPath.files = topN(filesSize, m_options.sizeByPathTopN);
+}
+
+/**
+ * RepoAnalysis::attributeTreePaths
+ *
+ * Recursively attributes the blobs of a tree not attributed yet to their path.
+ * A tree is processed only once: if it appears again (under the same or another path),
+ * all of its blobs have already been attributed.
+ * As in calculateTreeStatistics, recursion depth is bounded by the maximum path depth.
+ * \param oidTree tree to process.
+ * \param pathPrefix path of the tree, ending with '/' unless it is the root tree.
+ * \param dirsSize size of the blobs attributed directly under each directory.
+ * \param filesSize size of the blobs attributed to each file.
+ */
+void RepoAnalysis::attributeTreePaths(const std::string &oidTree, const std::string &pathPrefix,
+  std::unordered_map<std::string, size_t> &dirsSize, std::unordered_map<std::string, size_t> &filesSize)
+{
+  OdbObjectsData::iterTreeInfo itTreeInfo = m_odbObjectsData.trees.info.find(oidTree);
+  if (itTreeInfo == m_odbObjectsData.trees.info.end()) {
+    return;
+  }
+
+  OdbObjectsData::TreeInfoAndStats &treeInfoAndStats = itTreeInfo->second;
+  if (treeInfoAndStats.pathsDone) {
+    return;
+  }
+  treeInfoAndStats.pathsDone = true;
+
+  const std::string dirPath = pathPrefix.empty() ? "" : pathPrefix.substr(0, pathPrefix.size() - 1);
+  const size_t numBlobs = treeInfoAndStats.entryBlobs.size();
+  for (size_t i = 0; i < numBlobs; ++i) {
+    OdbObjectsData::iterBlobInfo itBlobInfo = m_odbObjectsData.blobs.info.find(treeInfoAndStats.entryBlobs.at(i));
+    if (itBlobInfo == m_odbObjectsData.blobs.info.end() || itBlobInfo->second.pathAttributed) {
+      continue;
+    }
+    itBlobInfo->second.pathAttributed = true;
+
+    const size_t blobSize = itBlobInfo->second.size;
+    filesSize[pathPrefix + treeInfoAndStats.entryBlobsNames.at(i)] += blobSize;
+    if (!dirPath.empty()) {
+      dirsSize[dirPath] += blobSize;
+    }
+  }
+
+  const size_t numSubTrees = treeInfoAndStats.entryTreesNameLen.size();
+  for (size_t i = 0; i < numSubTrees; ++i) {
+    attributeTreePaths(treeInfoAndStats.entryTreesNameLen.at(i).first,
+      pathPrefix + treeInfoAndStats.entryTreesNames.at(i) + "/", dirsSize, filesSize);
+  }
+}
+
 /**
  * RepoAnalysis::fillOutStatistics
  */
@@ -1796,18 +1774,407 @@ v8::Local<v8::Object> RepoAnalysis::biggestCheckoutsToJS() const
   return result;
 }
 
+/**
+ * RepoAnalysis::sizeByPathToJS
+ */
+v8::Local<v8::Object> RepoAnalysis::sizeByPathToJS() const
+{
+  auto pathsSizeToJS = [](const std::vector<PathSize> &pathsSize) {
+    v8::Local<v8::Array> result = Nan::New<Array>(pathsSize.size());
+    for (size_t i = 0; i < pathsSize.size(); ++i) {
+      v8::Local<v8::Object> pathSize = Nan::New<Object>();
+      Nan::Set(pathSize, Nan::New("path").ToLocalChecked(),
+        Nan::New(pathsSize[i].path).ToLocalChecked());
+      Nan::Set(pathSize, Nan::New("size").ToLocalChecked(),
+        Nan::New<Number>(pathsSize[i].size));
+      Nan::Set(result, Nan::New<Number>(i), pathSize);
+    }
+    return result;
+  };
+
+  v8::Local<v8::Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("directories").ToLocalChecked(),
+    pathsSizeToJS(m_statistics.sizeByPath.directories));
+  Nan::Set(result, Nan::New("files").ToLocalChecked(),
+    pathsSizeToJS(m_statistics.sizeByPath.files));
+
+  return result;
+}
+
+/**
+ * RepoAnalysis::quickAnalyze
+ * Quick mode, for admission checks: instead of calculating all the statistics, only
+ * checks whether the repository exceeds the limits requested, from the cheapest signal
+ * to the most expensive one, stopping as soon as a limit is exceeded or the budget is spent:
+ * - blob sizes, from the object headers (no object is inflated).
+ * - tree entries, only for the trees big enough to exceed the limit.
+ * - history depth, only if there are more commits than the limit.
+ * NOTE: objects are not pruned by reachability in this mode, so sizes and counts are those
+ * of the whole object database, which is an upper bound of the reachable ones.
+ * \return GIT_OK if checks finished, even early; libgit2 error code otherwise.
+ */
+int RepoAnalysis::quickAnalyze()
+{
+  int errorCode {GIT_OK};
+  m_quick.start = std::chrono::steady_clock::now();
+
+  if ((errorCode = quickScanObjectHeaders()) != GIT_OK || quickDone()) {
+    return errorCode;
+  }
+  if (m_options.limits.blobSize > 0) {
+    m_quick.limitsChecked.emplace_back("blobSize");
+  }
+
+  if (m_options.limits.treeEntries > 0) {
+    if ((errorCode = quickCheckTreeEntries()) != GIT_OK || quickDone()) {
+      return errorCode;
+    }
+    m_quick.limitsChecked.emplace_back("treeEntries");
+  }
+
+  if (m_options.limits.historyDepth > 0) {
+    if ((errorCode = quickCheckHistoryDepth()) != GIT_OK || quickDone()) {
+      return errorCode;
+    }
+    m_quick.limitsChecked.emplace_back("historyDepth");
+  }
+
+  return errorCode;
+}
+
+/**
+ * RepoAnalysis::quickBudgetLeft
+ * Accounts for one more object read.
+ * \return false, flagging results as partial, if the budget has been spent; true otherwise.
+ */
+bool RepoAnalysis::quickBudgetLeft()
+{
+  ++m_quick.objectsRead;
+
+  if (m_options.budget.objects > 0 && m_quick.objectsRead > m_options.budget.objects) {
+    m_quick.partial = true;
+  }
+  // checking the clock for every object would be noticeable with object headers
+  else if (m_options.budget.timeMs > 0 && (m_quick.objectsRead & 0xff) == 0) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - m_quick.start);
+    if (static_cast<uint64_t>(elapsed.count()) >= m_options.budget.timeMs) {
+      m_quick.partial = true;
+    }
+  }
+
+  return !m_quick.partial;
+}
+
+/**
+ * RepoAnalysis::quickDone
+ * \return true if a limit has been exceeded or the budget has been spent.
+ */
+bool RepoAnalysis::quickDone() const
+{
+  return m_quick.partial || !m_quick.limitsExceeded.empty();
+}
+
+/**
+ * RepoAnalysis::quickScanObjectHeaders
+ * Reads the header of every object in the object database to count objects,
+ * check blob sizes, and find the trees which could exceed the entries limit.
+ */
+int RepoAnalysis::quickScanObjectHeaders()
+{
+  int errorCode {GIT_OK};
+  git_odb *odb {nullptr};
+
+  if ((errorCode = git_repository_odb(&odb, m_repo)) != GIT_OK) {
+    return errorCode;
+  }
+
+  struct Payload { RepoAnalysis *repoAnalysis; git_odb *odb; } payload {this, odb};
+  errorCode = git_odb_foreach(odb, [](const git_oid *oid, void *payloadToCast) {
+    Payload *payload = static_cast<Payload *>(payloadToCast);
+    return payload->repoAnalysis->quickScanObjectHeader(oid, payload->odb);
+  }, &payload);
+
+  git_odb_free(odb);
+
+  // iteration stopped on purpose
+  if (errorCode == GIT_EUSER && quickDone()) {
+    git_error_clear();
+    errorCode = GIT_OK;
+  }
+
+  return errorCode;
+}
+
+/**
+ * RepoAnalysis::quickScanObjectHeader
+ * \return GIT_OK to keep scanning; GIT_EUSER to stop; libgit2 error code otherwise.
+ */
+int RepoAnalysis::quickScanObjectHeader(const git_oid *oid, git_odb *odb)
+{
+  if (!quickBudgetLeft()) {
+    return GIT_EUSER;
+  }
+
+  int errorCode {GIT_OK};
+  size_t size {0};
+  git_object_t type {GIT_OBJECT_INVALID};
+  if ((errorCode = git_odb_read_header(&size, &type, odb, oid)) != GIT_OK) {
+    return errorCode;
+  }
+
+  // each tree entry takes at least: "40000 " + 1 character name + '\0' + raw oid
+  static constexpr size_t kMinTreeEntrySize = 6 + 1 + 1 + GIT_OID_RAWSZ;
+
+  switch (type) {
+    case GIT_OBJECT_COMMIT:
+      ++m_statistics.repositorySize.commits.count;
+      m_statistics.repositorySize.commits.size += size;
+      break;
+
+    case GIT_OBJECT_TREE:
+      ++m_statistics.repositorySize.trees.count;
+      m_statistics.repositorySize.trees.size += size;
+      if (m_options.limits.treeEntries > 0 && size / kMinTreeEntrySize > m_options.limits.treeEntries) {
+        m_quick.treesToCheck.emplace_back(*oid);
+      }
+      break;
+
+    case GIT_OBJECT_BLOB:
+      ++m_statistics.repositorySize.blobs.count;
+      m_statistics.repositorySize.blobs.size += size;
+      m_statistics.biggestObjects.blobs.maxSize =
+        std::max<size_t>(m_statistics.biggestObjects.blobs.maxSize, size);
+      if (m_options.limits.blobSize > 0 && size > m_options.limits.blobSize) {
+        m_quick.limitsExceeded.emplace_back("blobSize");
+        return GIT_EUSER;
+      }
+      break;
+
+    case GIT_OBJECT_TAG:
+      ++m_statistics.repositorySize.annotatedTags.count;
+      break;
+
+    default:
+      break;
+  }
+
+  return GIT_OK;
+}
+
+/**
+ * RepoAnalysis::quickCheckTreeEntries
+ * Counts the entries of the trees found big enough to exceed the limit.
+ */
+int RepoAnalysis::quickCheckTreeEntries()
+{
+  int errorCode {GIT_OK};
+
+  for (const git_oid &oidTree : m_quick.treesToCheck) {
+    if (!quickBudgetLeft()) {
+      return GIT_OK;
+    }
+
+    git_tree *tree {nullptr};
+    if ((errorCode = git_tree_lookup(&tree, m_repo, &oidTree)) != GIT_OK) {
+      return errorCode;
+    }
+    const size_t numEntries = git_tree_entrycount(tree);
+    git_tree_free(tree);
+
+    m_statistics.biggestObjects.trees.maxEntries =
+      std::max<size_t>(m_statistics.biggestObjects.trees.maxEntries, numEntries);
+    if (numEntries > m_options.limits.treeEntries) {
+      m_quick.limitsExceeded.emplace_back("treeEntries");
+      return GIT_OK;
+    }
+  }
+
+  return errorCode;
+}
+
+/**
+ * RepoAnalysis::quickCheckHistoryDepth
+ * History can't be deeper than the number of commits, so the commits graph
+ * is only built when there are more commits than the limit.
+ */
+int RepoAnalysis::quickCheckHistoryDepth()
+{
+  if (m_statistics.repositorySize.commits.count <= m_options.limits.historyDepth) {
+    return GIT_OK;
+  }
+
+  int errorCode {GIT_OK};
+  CommitDataSource commitDataSource(m_repo, m_options.useCommitGraph);
+  std::vector<git_oid> tips {};
+  if ((errorCode = commitDataSource.GetReferenceTips(&tips)) != GIT_OK) {
+    return errorCode;
+  }
+
+  CommitsGraph graph {};
+  errorCode = commitDataSource.AddReachableCommitsToGraph(tips, &graph, [this]() {
+    return quickBudgetLeft();
+  });
+  // budget spent
+  if (errorCode == GIT_EUSER) {
+    return GIT_OK;
+  }
+  if (errorCode != GIT_OK) {
+    return errorCode;
+  }
+
+  m_statistics.historyStructure.maxDepth = graph.CalculateMaxDepth();
+  m_quick.maxDepthCalculated = true;
+  if (m_statistics.historyStructure.maxDepth > m_options.limits.historyDepth) {
+    m_quick.limitsExceeded.emplace_back("historyDepth");
+  }
+
+  return GIT_OK;
+}
+
+/**
+ * RepoAnalysis::quickStatisticsToJS
+ */
+v8::Local<v8::Object> RepoAnalysis::quickStatisticsToJS() const
+{
+  auto stringsToJS = [](const std::vector<std::string> &strings) {
+    v8::Local<v8::Array> result = Nan::New<Array>(strings.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+      Nan::Set(result, Nan::New<Number>(i), Nan::New(strings[i]).ToLocalChecked());
+    }
+    return result;
+  };
+
+  v8::Local<v8::Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("partial").ToLocalChecked(), Nan::New<Boolean>(m_quick.partial));
+  Nan::Set(result, Nan::New("limitsExceeded").ToLocalChecked(), stringsToJS(m_quick.limitsExceeded));
+  Nan::Set(result, Nan::New("limitsChecked").ToLocalChecked(), stringsToJS(m_quick.limitsChecked));
+
+  // repositorySize
+  v8::Local<v8::Object> commits = Nan::New<Object>();
+  Nan::Set(commits, Nan::New("count").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.commits.count));
+  Nan::Set(commits, Nan::New("size").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.commits.size));
+
+  v8::Local<v8::Object> trees = Nan::New<Object>();
+  Nan::Set(trees, Nan::New("count").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.trees.count));
+  Nan::Set(trees, Nan::New("size").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.trees.size));
+
+  v8::Local<v8::Object> blobs = Nan::New<Object>();
+  Nan::Set(blobs, Nan::New("count").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.blobs.count));
+  Nan::Set(blobs, Nan::New("size").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.blobs.size));
+
+  v8::Local<v8::Object> annotatedTags = Nan::New<Object>();
+  Nan::Set(annotatedTags, Nan::New("count").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.repositorySize.annotatedTags.count));
+
+  v8::Local<v8::Object> repositorySize = Nan::New<Object>();
+  Nan::Set(repositorySize, Nan::New("commits").ToLocalChecked(), commits);
+  Nan::Set(repositorySize, Nan::New("trees").ToLocalChecked(), trees);
+  Nan::Set(repositorySize, Nan::New("blobs").ToLocalChecked(), blobs);
+  Nan::Set(repositorySize, Nan::New("annotatedTags").ToLocalChecked(), annotatedTags);
+  Nan::Set(result, Nan::New("repositorySize").ToLocalChecked(), repositorySize);
+
+  // biggestObjects
+  v8::Local<v8::Object> biggestBlobs = Nan::New<Object>();
+  Nan::Set(biggestBlobs, Nan::New("maxSize").ToLocalChecked(),
+    Nan::New<Number>(m_statistics.biggestObjects.blobs.maxSize));
+
+  v8::Local<v8::Object> biggestObjects = Nan::New<Object>();
+  Nan::Set(biggestObjects, Nan::New("blobs").ToLocalChecked(), biggestBlobs);
+  // only trees which could exceed the limit are inspected
+  if (!m_quick.treesToCheck.empty()) {
+    v8::Local<v8::Object> biggestTrees = Nan::New<Object>();
+    Nan::Set(biggestTrees, Nan::New("maxEntries").ToLocalChecked(),
+      Nan::New<Number>(m_statistics.biggestObjects.trees.maxEntries));
+    Nan::Set(biggestObjects, Nan::New("trees").ToLocalChecked(), biggestTrees);
+  }
+  Nan::Set(result, Nan::New("biggestObjects").ToLocalChecked(), biggestObjects);
+
+  // historyStructure
+  if (m_quick.maxDepthCalculated) {
+    v8::Local<v8::Object> historyStructure = Nan::New<Object>();
+    Nan::Set(historyStructure, Nan::New("maxDepth").ToLocalChecked(),
+      Nan::New<Number>(m_statistics.historyStructure.maxDepth));
+    Nan::Set(result, Nan::New("historyStructure").ToLocalChecked(), historyStructure);
+  }
+
+  return result;
+}
+
+/**
+ * numberFromJSObject
+ * \return the value of a numeric property of a JS object, or 0 if not a positive number.
+ */
+static double numberFromJSObject(v8::Local<v8::Object> jsObject, const char *name)
+{
+  v8::Local<v8::String> propName = Nan::New(name).ToLocalChecked();
+  if (!Nan::Has(jsObject, propName).FromJust()) {
+    return 0;
+  }
+
+  v8::Local<v8::Value> value = Nan::Get(jsObject, propName).ToLocalChecked();
+  if (!value->IsNumber() || !(Nan::To<double>(value).FromJust() > 0)) {
+    return 0;
+  }
+
+  return Nan::To<double>(value).FromJust();
+}
+
 NAN_METHOD(GitRepository::Statistics)
 {
+  if (info.Length() >= 2 && !info[0]->IsNull() && !info[0]->IsUndefined() && !info[0]->IsObject()) {
+    return Nan::ThrowError("Options must be an object, null, or undefined.");
+  }
+
   if (!info[info.Length() - 1]->IsFunction()) {
     return Nan::ThrowError("Callback is required and must be a Function.");
   }
 
+  RepoAnalysisOptions options {};
+  if (info.Length() >= 2 && info[0]->IsObject()) {
+    v8::Local<v8::Object> jsOptions = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+    options.sizeByPathTopN = static_cast<size_t>(numberFromJSObject(jsOptions, "sizeByPath"));
+
+    v8::Local<v8::String> limitsName = Nan::New("limits").ToLocalChecked();
+    if (Nan::Has(jsOptions, limitsName).FromJust()) {
+      v8::Local<v8::Value> limits = Nan::Get(jsOptions, limitsName).ToLocalChecked();
+      if (limits->IsObject()) {
+        v8::Local<v8::Object> jsLimits = Nan::To<v8::Object>(limits).ToLocalChecked();
+        options.limits.blobSize = static_cast<size_t>(numberFromJSObject(jsLimits, "blobSize"));
+        options.limits.treeEntries = static_cast<size_t>(numberFromJSObject(jsLimits, "treeEntries"));
+        options.limits.historyDepth = static_cast<uint32_t>(
+          std::min<double>(numberFromJSObject(jsLimits, "historyDepth"), UINT32_MAX));
+      }
+    }
+
+    v8::Local<v8::String> budgetName = Nan::New("budget").ToLocalChecked();
+    if (Nan::Has(jsOptions, budgetName).FromJust()) {
+      v8::Local<v8::Value> budget = Nan::Get(jsOptions, budgetName).ToLocalChecked();
+      if (budget->IsObject()) {
+        v8::Local<v8::Object> jsBudget = Nan::To<v8::Object>(budget).ToLocalChecked();
+        options.budget.timeMs = static_cast<uint64_t>(numberFromJSObject(jsBudget, "timeMs"));
+        options.budget.objects = static_cast<size_t>(numberFromJSObject(jsBudget, "objects"));
+      }
+    }
+
+    v8::Local<v8::String> useCommitGraphName = Nan::New("useCommitGraph").ToLocalChecked();
+    if (Nan::Has(jsOptions, useCommitGraphName).FromJust()) {
+      options.useCommitGraph = !Nan::Get(jsOptions, useCommitGraphName).ToLocalChecked()->IsFalse();
+    }
+  }
+
   StatisticsBaton* baton = new StatisticsBaton();
 
    baton->error_code = GIT_OK;
    baton->error = NULL;
    baton->repo = Nan::ObjectWrap::Unwrap<GitRepository>(info.This())->GetValue();
-   baton->out = static_cast<void *>(new RepoAnalysis(baton->repo));
+   baton->out = static_cast<void *>(new RepoAnalysis(baton->repo, options));
    
   Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
   std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
@@ -1,3 +1,6 @@
+#include "../include/commit_graph_file.h"
+#include "../include/v8_helpers.h"
+
 #define SET_ON_OBJECT(obj, field, data) Nan::Set(obj, Nan::New(field).ToLocalChecked(), data)
 
 v8::Local<v8::Object> signatureToJavascript(const git_signature *signature) {
@@ -107,6 +110,107 @@ private:
   std::vector<std::string> parentIds;
 };
 
+/**
+ * \class CommitColumns
+ * Metadata of a batch of commits stored by columns, so that JS can read it
+ * without creating an object per commit:
+ * - oids and parents: raw oids (GIT_OID_RAWSZ bytes each), one after another.
+ * - parentOffsets: the parents of commit i are parents[parentOffsets[i]..parentOffsets[i + 1]).
+ * - authorTimes and committerTimes: milliseconds since epoch.
+ * - strings: UTF-8 author name, author email, committer name, committer email and message
+ *   of each commit; string j of commit i is strings[stringOffsets[i * 5 + j]..stringOffsets[i * 5 + j + 1]).
+ */
+class CommitColumns {
+public:
+  static constexpr size_t kStringsPerCommit = 5;
+
+  CommitColumns(size_t maxCount) {
+    oids.reserve(maxCount * GIT_OID_RAWSZ);
+    parentOffsets.reserve(maxCount + 1);
+    parentOffsets.push_back(0);
+    authorTimes.reserve(maxCount);
+    committerTimes.reserve(maxCount);
+    stringOffsets.reserve(maxCount * kStringsPerCommit + 1);
+    stringOffsets.push_back(0);
+  }
+
+  CommitColumns(const CommitColumns &) = delete;
+  CommitColumns(CommitColumns &&) = delete;
+  CommitColumns &operator=(const CommitColumns &) = delete;
+  CommitColumns &operator=(CommitColumns &&) = delete;
+  ~CommitColumns() = default;
+
+  void append(const git_commit *commit) {
+    oids.append(reinterpret_cast<const char *>(git_commit_id(commit)->id), GIT_OID_RAWSZ);
+
+    const unsigned int parentCount = git_commit_parentcount(commit);
+    for (unsigned int parentIndex = 0; parentIndex < parentCount; ++parentIndex) {
+      parents.append(reinterpret_cast<const char *>(git_commit_parent_id(commit, parentIndex)->id), GIT_OID_RAWSZ);
+    }
+    parentOffsets.push_back(parentOffsets.back() + parentCount);
+
+    const git_signature *author = git_commit_author(commit);
+    const git_signature *committer = git_commit_committer(commit);
+    authorTimes.push_back(static_cast<double>(author->when.time) * 1000);
+    committerTimes.push_back(static_cast<double>(committer->when.time) * 1000);
+
+    appendString(author->name);
+    appendString(author->email);
+    appendString(committer->name);
+    appendString(committer->email);
+    appendString(git_commit_message(commit));
+  }
+
+  v8::Local<v8::Object> toJavascript() const {
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+    SET_ON_OBJECT(result, "count", Nan::New<v8::Number>(authorTimes.size()));
+    SET_ON_OBJECT(result, "oids", Nan::CopyBuffer(oids.data(), oids.size()).ToLocalChecked());
+    SET_ON_OBJECT(result, "parentOffsets", nodegit::typedArrayFromVector<v8::Uint32Array>(parentOffsets));
+    SET_ON_OBJECT(result, "parents", Nan::CopyBuffer(parents.data(), parents.size()).ToLocalChecked());
+    SET_ON_OBJECT(result, "authorTimes", nodegit::typedArrayFromVector<v8::Float64Array>(authorTimes));
+    SET_ON_OBJECT(result, "committerTimes", nodegit::typedArrayFromVector<v8::Float64Array>(committerTimes));
+    SET_ON_OBJECT(result, "strings", Nan::CopyBuffer(strings.data(), strings.size()).ToLocalChecked());
+    SET_ON_OBJECT(result, "stringOffsets", nodegit::typedArrayFromVector<v8::Uint32Array>(stringOffsets));
+    return result;
+  }
+
+private:
+  void appendString(const char *value) {
+    if (value) {
+      strings.append(value);
+    }
+    stringOffsets.push_back(static_cast<uint32_t>(strings.size()));
+  }
+
+  std::string oids;
+  std::string parents;
+  std::vector<uint32_t> parentOffsets;
+  std::vector<double> authorTimes;
+  std::vector<double> committerTimes;
+  std::string strings;
+  std::vector<uint32_t> stringOffsets;
+};
+
+// frees the result of commitWalk, a CommitColumns if columnar or a vector of CommitModel otherwise
+static void freeCommitWalkOut(void *&out, bool columnar) {
+  if (out == NULL) {
+    return;
+  }
+
+  if (columnar) {
+    delete static_cast<CommitColumns *>(out);
+  } else {
+    std::vector<CommitModel *> *commits = static_cast<std::vector<CommitModel *> *>(out);
+    while (commits->size()) {
+      delete commits->back();
+      commits->pop_back();
+    }
+
+    delete commits;
+  }
+  out = NULL;
+}
+
 NAN_METHOD(GitRevwalk::CommitWalk) {
   if (info.Length() == 0 || !info[0]->IsNumber()) {
     return Nan::ThrowError("Max count is required and must be a number.");
@@ -125,19 +229,25 @@ NAN_METHOD(GitRevwalk::CommitWalk) {
   baton->error_code = GIT_OK;
   baton->error = NULL;
   baton->max_count = Nan::To<unsigned int>(info[0]).FromJust();
-  std::vector<CommitModel *> *out = new std::vector<CommitModel *>;
-  out->reserve(baton->max_count);
-  baton->out = static_cast<void *>(out);
+  baton->returnPlainObjects = false;
+  baton->columnar = false;
   if (info.Length() == 3 && info[1]->IsObject()) {
     v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
     v8::Local<v8::String> propName = Nan::New("returnPlainObjects").ToLocalChecked();
     if (Nan::Has(options, propName).FromJust()) {
       baton->returnPlainObjects = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
-    } else {
-      baton->returnPlainObjects = false;
     }
+    propName = Nan::New("columnar").ToLocalChecked();
+    if (Nan::Has(options, propName).FromJust()) {
+      baton->columnar = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+    }
+  }
+  if (baton->columnar) {
+    baton->out = static_cast<void *>(new CommitColumns(baton->max_count));
   } else {
-    baton->returnPlainObjects = false;
+    std::vector<CommitModel *> *out = new std::vector<CommitModel *>;
+    out->reserve(baton->max_count);
+    baton->out = static_cast<void *>(out);
   }
   baton->walk = Nan::ObjectWrap::Unwrap<GitRevwalk>(info.This())->GetValue();
   Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
@@ -151,14 +261,14 @@ NAN_METHOD(GitRevwalk::CommitWalk) {
 }
 
 nodegit::LockMaster GitRevwalk::CommitWalkWorker::AcquireLocks() {
-  nodegit::LockMaster lockMaster(true);
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
   return lockMaster;
 }
 
 void GitRevwalk::CommitWalkWorker::Execute() {
   giterr_clear();
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
 
-  std::vector<CommitModel *> *out = static_cast<std::vector<CommitModel *> *>(baton->out);
   for (int i = 0; i < baton->max_count; i++) {
     git_oid next_commit_id;
     baton->error_code = git_revwalk_next(&next_commit_id, baton->walk);
@@ -173,13 +283,7 @@ void GitRevwalk::CommitWalkWorker::Execute() {
         baton->error = git_error_dup(giterr_last());
       }
 
-      while (out->size()) {
-        delete out->back();
-        out->pop_back();
-      }
-
-      delete out;
-      baton->out = NULL;
+      freeCommitWalkOut(baton->out, baton->columnar);
 
       return;
     }
@@ -192,18 +296,18 @@ void GitRevwalk::CommitWalkWorker::Execute() {
         baton->error = git_error_dup(giterr_last());
       }
 
-      while (out->size()) {
-        delete out->back();
-        out->pop_back();
-      }
-
-      delete out;
-      baton->out = NULL;
+      freeCommitWalkOut(baton->out, baton->columnar);
 
       return;
     }
 
-    out->push_back(new CommitModel(commit, baton->returnPlainObjects));
+    if (baton->columnar) {
+      static_cast<CommitColumns *>(baton->out)->append(commit);
+      git_commit_free(commit);
+    } else {
+      static_cast<std::vector<CommitModel *> *>(baton->out)->push_back(
+        new CommitModel(commit, baton->returnPlainObjects));
+    }
   }
 }
 
@@ -216,19 +320,21 @@ void GitRevwalk::CommitWalkWorker::HandleErrorCallback() {
     free((void *)baton->error);
   }
 
-  auto out = static_cast<std::vector<CommitModel *> *>(baton->out);
-  while (out->size()) {
-    delete out->back();
-    out->pop_back();
-  }
-
-  delete out;
+  freeCommitWalkOut(baton->out, baton->columnar);
 
   delete baton;
 }
 
 void GitRevwalk::CommitWalkWorker::HandleOKCallback() {
-  if (baton->out != NULL) {
+  if (baton->out != NULL && baton->columnar) {
+    CommitColumns *columns = static_cast<CommitColumns *>(baton->out);
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      columns->toJavascript()
+    };
+    freeCommitWalkOut(baton->out, baton->columnar);
+    callback->Call(2, argv, async_resource);
+  } else if (baton->out != NULL) {
     std::vector<CommitModel *> *out = static_cast<std::vector<CommitModel *> *>(baton->out);
     const unsigned int size = out->size();
     Local<Array> result = Nan::New<Array>(size);
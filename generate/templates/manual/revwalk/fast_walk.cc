@@ -1,3 +1,5 @@
+#include "../include/commit_graph_file.h"
+
 NAN_METHOD(GitRevwalk::FastWalk)
 {
   if (info.Length() == 0 || !info[0]->IsNumber()) {
@@ -28,12 +30,14 @@ NAN_METHOD(GitRevwalk::FastWalk)
 }
 
 nodegit::LockMaster GitRevwalk::FastWalkWorker::AcquireLocks() {
-  nodegit::LockMaster lockMaster(true);
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
   return lockMaster;
 }
 
 void GitRevwalk::FastWalkWorker::Execute()
 {
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
   for (int i = 0; i < baton->max_count; i++)
   {
     git_oid *nextCommit = (git_oid *)malloc(sizeof(git_oid));
@@ -0,0 +1,198 @@
+#include "../include/commit_graph_file.h"
+
+/**
+ * \struct PackedOids
+ * Raw oids (GIT_OID_RAWSZ bytes each) written one after another in a single malloc'd buffer,
+ * so that it can be handed over to a Node Buffer without copying it.
+ */
+struct PackedOids
+{
+  PackedOids() = default;
+  ~PackedOids() { free(data); }
+  PackedOids(const PackedOids &other) = delete;
+  PackedOids(PackedOids &&other) = delete;
+  PackedOids& operator=(const PackedOids &other) = delete;
+  PackedOids& operator=(PackedOids &&other) = delete;
+
+  // \return false if out of memory
+  bool Append(const git_oid &oid, size_t maxCount) {
+    if (length + GIT_OID_RAWSZ > capacity) {
+      // grow geometrically, but never beyond what max_count can need
+      const size_t kMinCapacity = 1024 * GIT_OID_RAWSZ;
+      const size_t newCapacity = std::min<size_t>(
+        std::max<size_t>(capacity * 2, kMinCapacity), maxCount * GIT_OID_RAWSZ);
+      char *newData = static_cast<char *>(realloc(data, newCapacity));
+      if (newData == nullptr) {
+        return false;
+      }
+      data = newData;
+      capacity = newCapacity;
+    }
+
+    memcpy(data + length, oid.id, GIT_OID_RAWSZ);
+    length += GIT_OID_RAWSZ;
+    return true;
+  }
+
+  // gives up ownership of the buffer, to be freed with free()
+  char *Release() {
+    char *result = data;
+    data = nullptr;
+    length = capacity = 0;
+    return result;
+  }
+
+  char *data {nullptr};
+  size_t length {0};
+  size_t capacity {0};
+};
+
+NAN_METHOD(GitRevwalk::FastWalkPacked)
+{
+  if (info.Length() == 0 || !info[0]->IsNumber()) {
+    return Nan::ThrowError("Max count is required and must be a number.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  FastWalkPackedBaton* baton = new FastWalkPackedBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->max_count = Nan::To<unsigned int>(info[0]).FromJust();
+  baton->out = static_cast<void *>(new PackedOids());
+  baton->walk = Nan::ObjectWrap::Unwrap<GitRevwalk>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  FastWalkPackedWorker *worker = new FastWalkPackedWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRevwalk>("fastWalkPacked", info.This());
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRevwalk::FastWalkPackedWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
+  return lockMaster;
+}
+
+void GitRevwalk::FastWalkPackedWorker::Execute()
+{
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
+  PackedOids *packedOids = static_cast<PackedOids *>(baton->out);
+  git_oid nextCommit;
+
+  for (int i = 0; i < baton->max_count; i++)
+  {
+    git_error_clear();
+    baton->error_code = git_revwalk_next(&nextCommit, baton->walk);
+
+    if (baton->error_code != GIT_OK)
+    {
+      // We couldn't get a commit out of the revwalk. It's either in
+      // an error state or there aren't anymore commits in the revwalk.
+      if (baton->error_code != GIT_ITEROVER) {
+        baton->error = git_error_dup(git_error_last());
+
+        delete packedOids;
+        baton->out = NULL;
+      }
+      else {
+        baton->error_code = GIT_OK;
+      }
+
+      break;
+    }
+
+    if (!packedOids->Append(nextCommit, baton->max_count)) {
+      baton->error_code = GIT_ERROR;
+      git_error_set_oom();
+      baton->error = git_error_dup(git_error_last());
+
+      delete packedOids;
+      baton->out = NULL;
+      break;
+    }
+  }
+}
+
+void GitRevwalk::FastWalkPackedWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<PackedOids *>(baton->out);
+
+  delete baton;
+}
+
+void GitRevwalk::FastWalkPackedWorker::HandleOKCallback()
+{
+  if (baton->out != NULL)
+  {
+    PackedOids *packedOids = static_cast<PackedOids *>(baton->out);
+    const size_t length = packedOids->length;
+
+    // the Buffer takes ownership of the memory, and will free() it
+    Local<v8::Object> result = length > 0
+      ? Nan::NewBuffer(packedOids->Release(), length).ToLocalChecked()
+      : Nan::NewBuffer(0).ToLocalChecked();
+
+    delete packedOids;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else
+  {
+    if (baton->error)
+    {
+      Local<v8::Object> err;
+      if (baton->error->message) {
+        err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+      } else {
+        err = Nan::To<v8::Object>(Nan::Error("Method fastWalkPacked has thrown an error.")).ToLocalChecked();
+      }
+      Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+      Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.fastWalkPacked").ToLocalChecked());
+      Local<v8::Value> argv[1] = {
+        err
+      };
+      callback->Call(1, argv, async_resource);
+      if (baton->error->message)
+      {
+        free((void *)baton->error->message);
+      }
+
+      free((void *)baton->error);
+    }
+    else if (baton->error_code < 0)
+    {
+      Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Method fastWalkPacked has thrown an error.")).ToLocalChecked();
+      Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+      Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.fastWalkPacked").ToLocalChecked());
+      Local<v8::Value> argv[1] = {
+        err
+      };
+      callback->Call(1, argv, async_resource);
+    }
+    else
+    {
+      callback->Call(0, NULL, async_resource);
+    }
+  }
+
+  delete baton;
+}
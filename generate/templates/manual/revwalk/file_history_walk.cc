@@ -1,3 +1,5 @@
+#include "../include/commit_graph_file.h"
+
 // Note: commit is not owned by this class (must be freed elsewhere)
 class FileHistoryEvent {
 public:
@@ -59,13 +61,50 @@ public:
     return historyEntry;
   }
 
+  // Diff from parentTree to currentTree with renames detected.
+  // If sharedDiff is given, the diff is only computed the first time, and it's kept there
+  // for the next calls with the same trees; the caller frees it.
+  static int findSimilarDiff(
+    git_diff **diff,
+    git_repository *repo,
+    git_tree *parentTree,
+    git_tree *currentTree,
+    git_diff **sharedDiff
+  ) {
+    if (sharedDiff != NULL && *sharedDiff != NULL) {
+      *diff = *sharedDiff;
+      return GIT_OK;
+    }
+
+    int errorCode;
+    if ((errorCode = git_diff_tree_to_tree(diff, repo, parentTree, currentTree, NULL)) != GIT_OK) {
+      return errorCode;
+    }
+    if ((errorCode = git_diff_find_similar(*diff, NULL)) != GIT_OK) {
+      git_diff_free(*diff);
+      return errorCode;
+    }
+
+    if (sharedDiff != NULL) {
+      *sharedDiff = *diff;
+    }
+    return GIT_OK;
+  }
+
+  static void releaseDiff(git_diff *diff, git_diff **sharedDiff) {
+    if (sharedDiff == NULL) {
+      git_diff_free(diff);
+    }
+  }
+
   static int buildHistoryEvent(
     FileHistoryEvent **fileHistoryEvent,
     git_repository *repo,
     git_commit *currentCommit,
     git_tree *currentTree,
     git_tree *parentTree,
-    const char *filePath
+    const char *filePath,
+    git_diff **sharedDiff = NULL
   ) {
     int errorCode;
     git_tree_entry *currentEntry;
@@ -85,12 +124,7 @@ public:
     // The filePath was added
     if (currentEntry && !parentEntry) {
       git_diff *diff;
-      if ((errorCode = git_diff_tree_to_tree(&diff, repo, parentTree, currentTree, NULL)) != GIT_OK) {
-        git_tree_entry_free(currentEntry);
-        return errorCode;
-      }
-      if ((errorCode = git_diff_find_similar(diff, NULL)) != GIT_OK) {
-        git_diff_free(diff);
+      if ((errorCode = findSimilarDiff(&diff, repo, parentTree, currentTree, sharedDiff)) != GIT_OK) {
         git_tree_entry_free(currentEntry);
         return errorCode;
       }
@@ -108,14 +142,14 @@ public:
               delta->old_file.path,
               delta->new_file.path
             );
-            git_diff_free(diff);
+            releaseDiff(diff, sharedDiff);
             git_tree_entry_free(currentEntry);
             return GIT_OK;
           }
           break;
         }
       }
-      git_diff_free(diff);
+      releaseDiff(diff, sharedDiff);
       git_tree_entry_free(currentEntry);
 
       *fileHistoryEvent = new FileHistoryEvent(GIT_DELTA_ADDED, true, false, currentCommit, NULL, NULL);
@@ -125,12 +159,7 @@ public:
     // The filePath was deleted
     if (!currentEntry && parentEntry) {
       git_diff *diff;
-      if ((errorCode = git_diff_tree_to_tree(&diff, repo, parentTree, currentTree, NULL)) != GIT_OK) {
-        git_tree_entry_free(parentEntry);
-        return errorCode;
-      }
-      if ((errorCode = git_diff_find_similar(diff, NULL)) != GIT_OK) {
-        git_diff_free(diff);
+      if ((errorCode = findSimilarDiff(&diff, repo, parentTree, currentTree, sharedDiff)) != GIT_OK) {
         git_tree_entry_free(parentEntry);
         return errorCode;
       }
@@ -148,14 +177,14 @@ public:
               delta->old_file.path,
               delta->new_file.path
             );
-            git_diff_free(diff);
+            releaseDiff(diff, sharedDiff);
             git_tree_entry_free(parentEntry);
             return GIT_OK;
           }
           break;
         }
       }
-      git_diff_free(diff);
+      releaseDiff(diff, sharedDiff);
       git_tree_entry_free(parentEntry);
 
       *fileHistoryEvent =  new FileHistoryEvent(GIT_DELTA_DELETED, false, false, currentCommit, NULL, NULL);
@@ -219,7 +248,7 @@ NAN_METHOD(GitRevwalk::FileHistoryWalk)
 }
 
 nodegit::LockMaster GitRevwalk::FileHistoryWalkWorker::AcquireLocks() {
-  nodegit::LockMaster lockMaster(true);
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
   return lockMaster;
 }
 
@@ -228,6 +257,12 @@ void GitRevwalk::FileHistoryWalkWorker::Execute()
   git_repository *repo = git_revwalk_repository(baton->walk);
   git_oid currentOid;
   git_error_clear();
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
+  // when the repository has a commit-graph with changed-path Bloom filters,
+  // most of the commits that didn't change the path are skipped without reading their trees
+  std::unique_ptr<CommitGraphFile> commitGraph = CommitGraphFile::Open(repo);
+  const CommitGraphFile::BloomKey bloomKey(baton->file_path);
   for (
     unsigned int revwalkIterations = 0;
     revwalkIterations < baton->max_count && (baton->error_code = git_revwalk_next(&currentOid, baton->walk)) == GIT_OK;
@@ -238,6 +273,12 @@ void GitRevwalk::FileHistoryWalkWorker::Execute()
       break;
     }
 
+    if (commitGraph && git_commit_parentcount(currentCommit) == 1
+      && !commitGraph->MaybeChangedPath(&currentOid, bloomKey)) {
+      git_commit_free(currentCommit);
+      continue;
+    }
+
     git_tree *currentTree;
     if ((baton->error_code = git_commit_tree(&currentTree, currentCommit)) != GIT_OK) {
       git_commit_free(currentCommit);
@@ -0,0 +1,505 @@
+#include <unordered_set>
+
+#include "../include/commit_graph_file.h"
+
+/**
+ * \struct PathHistory
+ * History events of one of the paths of fileHistoryWalkPaths.
+ */
+struct PathHistory
+{
+  PathHistory(const std::string &aPath) : path(aPath), bloomKey(aPath) {}
+  ~PathHistory() {
+    for (FileHistoryEvent *event : events) {
+      delete event;
+    }
+  }
+  PathHistory(const PathHistory &other) = delete;
+  PathHistory(PathHistory &&other) = delete;
+  PathHistory& operator=(const PathHistory &other) = delete;
+  PathHistory& operator=(PathHistory &&other) = delete;
+
+  std::string path {};
+  CommitGraphFile::BloomKey bloomKey;
+  std::vector<FileHistoryEvent *> events {};
+  // Raw oids (GIT_OID_RAWSZ bytes) of the commits hidden for this path, which hides
+  // their ancestors too; the same as git_revwalk_hide() does for a single path.
+  // Commits are removed once walked, after passing it on to their parents.
+  std::unordered_set<std::string> hidden {};
+};
+
+/**
+ * \class CommitParentsTrees
+ * Trees of the parents of a commit, and the diffs from each of them to the commit tree,
+ * looked up the first time a path needs them and shared by all the paths.
+ */
+class CommitParentsTrees
+{
+public:
+  CommitParentsTrees(git_repository *repo, git_commit *commit, git_tree *tree)
+    : m_repo(repo), m_commit(commit), m_tree(tree),
+      m_parentTrees(git_commit_parentcount(commit), nullptr),
+      m_diffs(git_commit_parentcount(commit), nullptr) {}
+
+  ~CommitParentsTrees() {
+    for (git_tree *parentTree : m_parentTrees) {
+      git_tree_free(parentTree);
+    }
+    for (git_diff *diff : m_diffs) {
+      git_diff_free(diff);
+    }
+  }
+
+  CommitParentsTrees(const CommitParentsTrees &other) = delete;
+  CommitParentsTrees(CommitParentsTrees &&other) = delete;
+  CommitParentsTrees& operator=(const CommitParentsTrees &other) = delete;
+  CommitParentsTrees& operator=(CommitParentsTrees &&other) = delete;
+
+  // \return GIT_OK on success; libgit2 error code otherwise.
+  int GetParentTree(git_tree **parentTree, unsigned int parentIndex) {
+    if (m_parentTrees[parentIndex] == nullptr) {
+      git_commit *parentCommit {nullptr};
+      int errorCode;
+      if ((errorCode = git_commit_parent(&parentCommit, m_commit, parentIndex)) != GIT_OK) {
+        return errorCode;
+      }
+      errorCode = git_commit_tree(&m_parentTrees[parentIndex], parentCommit);
+      git_commit_free(parentCommit);
+      if (errorCode != GIT_OK) {
+        m_parentTrees[parentIndex] = nullptr;
+        return errorCode;
+      }
+    }
+
+    *parentTree = m_parentTrees[parentIndex];
+    return GIT_OK;
+  }
+
+  // \return GIT_OK on success; libgit2 error code otherwise.
+  int BuildHistoryEvent(FileHistoryEvent **fileHistoryEvent, unsigned int parentIndex, const char *filePath) {
+    git_tree *parentTree {nullptr};
+    int errorCode;
+    if ((errorCode = GetParentTree(&parentTree, parentIndex)) != GIT_OK) {
+      return errorCode;
+    }
+
+    return FileHistoryEvent::buildHistoryEvent(
+      fileHistoryEvent,
+      m_repo,
+      m_commit,
+      m_tree,
+      parentTree,
+      filePath,
+      &m_diffs[parentIndex]
+    );
+  }
+
+private:
+  git_repository *m_repo {nullptr};
+  git_commit *m_commit {nullptr};
+  git_tree *m_tree {nullptr};
+  std::vector<git_tree *> m_parentTrees {};
+  std::vector<git_diff *> m_diffs {};
+};
+
+/**
+ * \class FileHistoryWalkPathsState
+ * Input paths and output of fileHistoryWalkPaths.
+ */
+class FileHistoryWalkPathsState
+{
+public:
+  FileHistoryWalkPathsState() = default;
+  ~FileHistoryWalkPathsState() = default;
+  FileHistoryWalkPathsState(const FileHistoryWalkPathsState &other) = delete;
+  FileHistoryWalkPathsState(FileHistoryWalkPathsState &&other) = delete;
+  FileHistoryWalkPathsState& operator=(const FileHistoryWalkPathsState &other) = delete;
+  FileHistoryWalkPathsState& operator=(FileHistoryWalkPathsState &&other) = delete;
+
+  void AddPath(const std::string &path) {
+    for (const std::unique_ptr<PathHistory> &pathHistory : m_paths) {
+      if (pathHistory->path == path) {
+        return;
+      }
+    }
+    m_paths.emplace_back(new PathHistory(path));
+  }
+
+  int Walk(git_revwalk *walk, unsigned int maxCount);
+
+  v8::Local<v8::Object> toJavascript(bool reachedEndOfHistory);
+
+private:
+  int walkCommit(git_repository *repo, git_commit *commit, git_tree *tree, std::vector<PathHistory *> &activePaths);
+  int walkMergeCommit(CommitParentsTrees &parentsTrees, git_commit *commit, PathHistory *pathHistory);
+
+  std::vector<std::unique_ptr<PathHistory>> m_paths {};
+};
+
+/**
+ * FileHistoryWalkPathsState::Walk
+ * Walks up to maxCount commits once, building the history of all the paths.
+ * \return GIT_ITEROVER if the end of the history was reached, GIT_OK if maxCount commits were walked;
+ * libgit2 error code otherwise.
+ */
+int FileHistoryWalkPathsState::Walk(git_revwalk *walk, unsigned int maxCount)
+{
+  git_repository *repo = git_revwalk_repository(walk);
+  std::unique_ptr<CommitGraphFile> commitGraph = CommitGraphFile::Open(repo);
+  std::vector<PathHistory *> activePaths {};
+  activePaths.reserve(m_paths.size());
+  git_oid currentOid;
+  int errorCode {GIT_OK};
+
+  for (
+    unsigned int revwalkIterations = 0;
+    revwalkIterations < maxCount && (errorCode = git_revwalk_next(&currentOid, walk)) == GIT_OK;
+    ++revwalkIterations
+  ) {
+    git_commit *currentCommit {nullptr};
+    if ((errorCode = git_commit_lookup(&currentCommit, repo, &currentOid)) != GIT_OK) {
+      break;
+    }
+
+    // the commit is skipped for the paths it's hidden for, and its parents get hidden instead
+    const std::string currentOidStr(reinterpret_cast<const char *>(currentOid.id), GIT_OID_RAWSZ);
+    const unsigned int parentCount = git_commit_parentcount(currentCommit);
+    activePaths.clear();
+    for (const std::unique_ptr<PathHistory> &pathHistory : m_paths) {
+      if (pathHistory->hidden.erase(currentOidStr) == 0) {
+        // skip the paths that the Bloom filter of the commit tells didn't change from its parent
+        if (!commitGraph || parentCount != 1 || commitGraph->MaybeChangedPath(&currentOid, pathHistory->bloomKey)) {
+          activePaths.push_back(pathHistory.get());
+        }
+        continue;
+      }
+      for (unsigned int parentIndex = 0; parentIndex < parentCount; ++parentIndex) {
+        pathHistory->hidden.emplace(
+          reinterpret_cast<const char *>(git_commit_parent_id(currentCommit, parentIndex)->id), GIT_OID_RAWSZ);
+      }
+    }
+
+    if (activePaths.empty()) {
+      git_commit_free(currentCommit);
+      continue;
+    }
+
+    git_tree *currentTree {nullptr};
+    if ((errorCode = git_commit_tree(&currentTree, currentCommit)) != GIT_OK) {
+      git_commit_free(currentCommit);
+      break;
+    }
+
+    errorCode = walkCommit(repo, currentCommit, currentTree, activePaths);
+
+    git_tree_free(currentTree);
+    git_commit_free(currentCommit);
+    if (errorCode != GIT_OK) {
+      break;
+    }
+  }
+
+  return errorCode;
+}
+
+/**
+ * FileHistoryWalkPathsState::walkCommit
+ * Adds the events of a commit to the history of the paths given.
+ * \return GIT_OK on success; libgit2 error code otherwise.
+ */
+int FileHistoryWalkPathsState::walkCommit(
+  git_repository *repo,
+  git_commit *commit,
+  git_tree *tree,
+  std::vector<PathHistory *> &activePaths)
+{
+  const unsigned int parentCount = git_commit_parentcount(commit);
+  int errorCode {GIT_OK};
+
+  if (parentCount == 0) {
+    for (PathHistory *pathHistory : activePaths) {
+      git_tree_entry* entry;
+      if (git_tree_entry_bypath(&entry, tree, pathHistory->path.c_str()) == GIT_OK) {
+        pathHistory->events.push_back(new FileHistoryEvent(GIT_DELTA_ADDED, false, false, commit, NULL, NULL));
+        git_tree_entry_free(entry);
+      }
+    }
+    return GIT_OK;
+  }
+
+  CommitParentsTrees parentsTrees(repo, commit, tree);
+
+  if (parentCount == 1) {
+    git_tree *parentTree {nullptr};
+    if ((errorCode = parentsTrees.GetParentTree(&parentTree, 0)) != GIT_OK) {
+      return errorCode;
+    }
+
+    // nothing changed for any path
+    if (git_oid_equal(git_tree_id(tree), git_tree_id(parentTree))) {
+      return GIT_OK;
+    }
+
+    for (PathHistory *pathHistory : activePaths) {
+      FileHistoryEvent *fileHistoryEvent;
+      if ((errorCode = parentsTrees.BuildHistoryEvent(&fileHistoryEvent, 0, pathHistory->path.c_str())) != GIT_OK) {
+        return errorCode;
+      }
+
+      if (fileHistoryEvent->type != GIT_DELTA_UNMODIFIED) {
+        pathHistory->events.push_back(fileHistoryEvent);
+      } else {
+        delete fileHistoryEvent;
+      }
+    }
+    return GIT_OK;
+  }
+
+  for (PathHistory *pathHistory : activePaths) {
+    if ((errorCode = walkMergeCommit(parentsTrees, commit, pathHistory)) != GIT_OK) {
+      return errorCode;
+    }
+  }
+  return GIT_OK;
+}
+
+/**
+ * FileHistoryWalkPathsState::walkMergeCommit
+ * Same as the merge commits case of fileHistoryWalk, for one path.
+ * \return GIT_OK on success; libgit2 error code otherwise.
+ */
+int FileHistoryWalkPathsState::walkMergeCommit(
+  CommitParentsTrees &parentsTrees,
+  git_commit *commit,
+  PathHistory *pathHistory)
+{
+  const unsigned int parentCount = git_commit_parentcount(commit);
+  std::pair<bool, unsigned int> firstMatchingParentIndex(false, 0);
+  bool fileExistsInCurrent = false, fileExistsInSomeParent = false;
+  int errorCode {GIT_OK};
+
+  for (unsigned int parentIndex = 0; parentIndex < parentCount; ++parentIndex) {
+    FileHistoryEvent *fileHistoryEvent;
+    if ((errorCode = parentsTrees.BuildHistoryEvent(
+      &fileHistoryEvent, parentIndex, pathHistory->path.c_str())) != GIT_OK) {
+      return errorCode;
+    }
+
+    switch (fileHistoryEvent->type) {
+      case GIT_DELTA_ADDED: {
+        fileExistsInCurrent = true;
+        break;
+      }
+      case GIT_DELTA_MODIFIED: {
+        fileExistsInCurrent = true;
+        fileExistsInSomeParent = true;
+        break;
+      }
+      case GIT_DELTA_DELETED: {
+        fileExistsInSomeParent = true;
+        break;
+      }
+      case GIT_DELTA_RENAMED: {
+        if (fileHistoryEvent->existsInCurrentTree) {
+          fileExistsInCurrent = true;
+        } else {
+          fileExistsInSomeParent = true;
+        }
+        break;
+      }
+      case GIT_DELTA_UNMODIFIED: {
+        if (fileHistoryEvent->existsInCurrentTree) {
+          fileExistsInCurrent = true;
+          fileExistsInSomeParent = true;
+        }
+        firstMatchingParentIndex = std::make_pair(true, parentIndex);
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+
+    delete fileHistoryEvent;
+
+    if (firstMatchingParentIndex.first) {
+      break;
+    }
+  }
+
+  if (!firstMatchingParentIndex.first) {
+    assert(fileExistsInCurrent || fileExistsInSomeParent);
+    git_delta_t mergeType = GIT_DELTA_UNREADABLE; // It will never result in this case because of the assertion above.
+    if (fileExistsInCurrent && fileExistsInSomeParent) {
+      mergeType = GIT_DELTA_MODIFIED;
+    } else if (fileExistsInCurrent) {
+      mergeType = GIT_DELTA_ADDED;
+    } else if (fileExistsInSomeParent) {
+      mergeType = GIT_DELTA_DELETED;
+    }
+
+    pathHistory->events.push_back(new FileHistoryEvent(
+      mergeType,
+      mergeType != GIT_DELTA_DELETED,
+      true,
+      commit,
+      NULL,
+      NULL
+    ));
+    return GIT_OK;
+  }
+
+  for (unsigned int parentIndex = 0; parentIndex < parentCount; ++parentIndex) {
+    if (parentIndex == firstMatchingParentIndex.second) {
+      continue;
+    }
+
+    pathHistory->hidden.emplace(
+      reinterpret_cast<const char *>(git_commit_parent_id(commit, parentIndex)->id), GIT_OID_RAWSZ);
+  }
+  return GIT_OK;
+}
+
+v8::Local<v8::Object> FileHistoryWalkPathsState::toJavascript(bool reachedEndOfHistory)
+{
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  for (const std::unique_ptr<PathHistory> &pathHistory : m_paths) {
+    const unsigned int size = pathHistory->events.size();
+    v8::Local<v8::Array> events = Nan::New<v8::Array>(size);
+    for (unsigned int i = 0; i < size; i++) {
+      Nan::Set(events, Nan::New(i), pathHistory->events[i]->toJavascript());
+    }
+    Nan::Set(events, Nan::New("reachedEndOfHistory").ToLocalChecked(), Nan::New(reachedEndOfHistory));
+    Nan::Set(result, Nan::New(pathHistory->path).ToLocalChecked(), events);
+  }
+  return result;
+}
+
+NAN_METHOD(GitRevwalk::FileHistoryWalkPaths)
+{
+  if (info.Length() == 0 || !info[0]->IsArray()) {
+    return Nan::ThrowError("File paths to get the history are required.");
+  }
+
+  if (info.Length() == 1 || !info[1]->IsNumber()) {
+    return Nan::ThrowError("Max count is required and must be a number.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  v8::Local<v8::Array> jsFilePaths = v8::Local<v8::Array>::Cast(info[0]);
+  FileHistoryWalkPathsState *state = new FileHistoryWalkPathsState();
+  for (uint32_t i = 0; i < jsFilePaths->Length(); ++i) {
+    v8::Local<v8::Value> jsFilePath = Nan::Get(jsFilePaths, i).ToLocalChecked();
+    if (!jsFilePath->IsString()) {
+      delete state;
+      return Nan::ThrowError("File paths must be strings.");
+    }
+    Nan::Utf8String filePath(Nan::To<v8::String>(jsFilePath).ToLocalChecked());
+    state->AddPath(std::string(*filePath));
+  }
+
+  FileHistoryWalkPathsBaton* baton = new FileHistoryWalkPathsBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->max_count = Nan::To<unsigned int>(info[1]).FromJust();
+  baton->out = static_cast<void *>(state);
+  baton->walk = Nan::ObjectWrap::Unwrap<GitRevwalk>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  FileHistoryWalkPathsWorker *worker = new FileHistoryWalkPathsWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRevwalk>("fileHistoryWalkPaths", info.This());
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRevwalk::FileHistoryWalkPathsWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
+  return lockMaster;
+}
+
+void GitRevwalk::FileHistoryWalkPathsWorker::Execute()
+{
+  git_error_clear();
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
+  FileHistoryWalkPathsState *state = static_cast<FileHistoryWalkPathsState *>(baton->out);
+  baton->error_code = state->Walk(baton->walk, baton->max_count);
+
+  if (baton->error_code != GIT_OK && baton->error_code != GIT_ITEROVER) {
+    // Something went wrong in our loop, discard everything in the async worker
+    delete state;
+    baton->out = NULL;
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+  }
+}
+
+void GitRevwalk::FileHistoryWalkPathsWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<FileHistoryWalkPathsState *>(baton->out);
+
+  delete baton;
+}
+
+void GitRevwalk::FileHistoryWalkPathsWorker::HandleOKCallback()
+{
+  if (baton->out != NULL) {
+    FileHistoryWalkPathsState *state = static_cast<FileHistoryWalkPathsState *>(baton->out);
+    v8::Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      state->toJavascript(baton->error_code == GIT_ITEROVER)
+    };
+    delete state;
+
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error) {
+    v8::Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method fileHistoryWalkPaths has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.fileHistoryWalkPaths").ToLocalChecked());
+    v8::Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0) {
+    v8::Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Method fileHistoryWalkPaths has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.fileHistoryWalkPaths").ToLocalChecked());
+    v8::Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -0,0 +1,157 @@
+#include "../include/commit_data_source.h"
+#include "../include/graph_layout.h"
+#include "../include/v8_helpers.h"
+
+NAN_METHOD(GitRevwalk::GraphLayout)
+{
+  if (info.Length() == 0 || !info[0]->IsNumber()) {
+    return Nan::ThrowError("Max count is required and must be a number.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  ::GraphLayout *layout = new ::GraphLayout();
+  if (info.Length() > 2 && node::Buffer::HasInstance(info[1])) {
+    v8::Local<v8::Object> state = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+    if (!layout->LoadState(node::Buffer::Data(state), node::Buffer::Length(state))) {
+      delete layout;
+      return Nan::ThrowError("State is not a valid graph layout state.");
+    }
+  }
+
+  GraphLayoutBaton* baton = new GraphLayoutBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->max_count = Nan::To<unsigned int>(info[0]).FromJust();
+  baton->out = static_cast<void *>(layout);
+  baton->walk = Nan::ObjectWrap::Unwrap<GitRevwalk>(info.This())->GetValue();
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  GraphLayoutWorker *worker = new GraphLayoutWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRevwalk>("graphLayout", info.This());
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRevwalk::GraphLayoutWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
+  return lockMaster;
+}
+
+void GitRevwalk::GraphLayoutWorker::Execute()
+{
+  git_error_clear();
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
+  ::GraphLayout *layout = static_cast<::GraphLayout *>(baton->out);
+  // parents are read from the commit-graph file when there is one
+  CommitDataSource commitDataSource(git_revwalk_repository(baton->walk));
+  CommitDataSource::CommitData commitData {};
+  git_oid nextCommit;
+
+  for (unsigned int i = 0; i < baton->max_count; ++i) {
+    baton->error_code = git_revwalk_next(&nextCommit, baton->walk);
+    if (baton->error_code == GIT_OK) {
+      baton->error_code = commitDataSource.Lookup(&nextCommit, &commitData);
+    }
+
+    if (baton->error_code != GIT_OK) {
+      if (baton->error_code == GIT_ITEROVER) {
+        baton->error_code = GIT_OK;
+      }
+      else {
+        if (git_error_last() != NULL) {
+          baton->error = git_error_dup(git_error_last());
+        }
+        delete layout;
+        baton->out = NULL;
+      }
+      break;
+    }
+
+    layout->AddCommit(nextCommit, commitData.parents);
+  }
+}
+
+void GitRevwalk::GraphLayoutWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  delete static_cast<::GraphLayout *>(baton->out);
+
+  delete baton;
+}
+
+void GitRevwalk::GraphLayoutWorker::HandleOKCallback()
+{
+  if (baton->out != NULL) {
+    ::GraphLayout *layout = static_cast<::GraphLayout *>(baton->out);
+    const std::string &oids = layout->GetOids();
+    const std::string state = layout->SaveState();
+
+    v8::Local<v8::Object> result = Nan::New<v8::Object>();
+    Nan::Set(result, Nan::New("count").ToLocalChecked(), Nan::New<v8::Number>(layout->GetLanes().size()));
+    Nan::Set(result, Nan::New("firstRow").ToLocalChecked(), Nan::New<v8::Number>(layout->GetFirstRow()));
+    Nan::Set(result, Nan::New("oids").ToLocalChecked(), Nan::CopyBuffer(oids.data(), oids.size()).ToLocalChecked());
+    Nan::Set(result, Nan::New("lanes").ToLocalChecked(),
+      nodegit::typedArrayFromVector<v8::Uint32Array>(layout->GetLanes()));
+    Nan::Set(result, Nan::New("markers").ToLocalChecked(),
+      nodegit::typedArrayFromVector<v8::Uint8Array>(layout->GetMarkers()));
+    Nan::Set(result, Nan::New("edges").ToLocalChecked(),
+      nodegit::typedArrayFromVector<v8::Uint32Array>(layout->GetEdges()));
+    Nan::Set(result, Nan::New("numLanes").ToLocalChecked(), Nan::New<v8::Number>(layout->GetNumLanes()));
+    Nan::Set(result, Nan::New("state").ToLocalChecked(), Nan::CopyBuffer(state.data(), state.size()).ToLocalChecked());
+    delete layout;
+
+    v8::Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  }
+  else if (baton->error) {
+    v8::Local<v8::Object> err;
+    if (baton->error->message) {
+      err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    } else {
+      err = Nan::To<v8::Object>(Nan::Error("Method graphLayout has thrown an error.")).ToLocalChecked();
+    }
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.graphLayout").ToLocalChecked());
+    v8::Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message)
+    {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+  else if (baton->error_code < 0) {
+    v8::Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Method graphLayout has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.graphLayout").ToLocalChecked());
+    v8::Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  }
+  else {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
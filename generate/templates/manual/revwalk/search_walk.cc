@@ -0,0 +1,272 @@
+#include <cmath>
+
+#include "../include/commit_graph_file.h"
+#include "../include/commit_search.h"
+
+// sets the pattern of a field from a String or a RegExp; \return false if a RegExp is not valid,
+// or has flags other than i and g (g changes nothing when testing each commit once)
+static bool setSearchPattern(
+  CommitSearch *search,
+  CommitSearch::Field field,
+  v8::Local<v8::Value> value,
+  bool ignoreCase,
+  std::string *error
+) {
+  if (value->IsRegExp()) {
+    v8::Local<v8::RegExp> regExp = value.As<v8::RegExp>();
+    if ((regExp->GetFlags() & ~(v8::RegExp::kIgnoreCase | v8::RegExp::kGlobal)) != 0) {
+      *error = "only the i and g flags are supported";
+      return false;
+    }
+    Nan::Utf8String source(regExp->GetSource());
+    return search->SetPattern(field, std::string(*source, source.length()), true,
+      (regExp->GetFlags() & v8::RegExp::kIgnoreCase) != 0, error);
+  }
+
+  Nan::Utf8String text(value);
+  return search->SetPattern(field, std::string(*text, text.length()), false, ignoreCase, error);
+}
+
+// \return the date of a Date or a number of milliseconds, in milliseconds
+static double searchDateValue(v8::Local<v8::Value> value) {
+  return value->IsDate() ? value.As<v8::Date>()->ValueOf() : Nan::To<double>(value).FromJust();
+}
+
+NAN_METHOD(GitRevwalk::SearchWalk) {
+  if (info.Length() == 0 || !info[0]->IsNumber()) {
+    return Nan::ThrowError("Max count is required and must be a number.");
+  }
+
+  if (info.Length() < 3 || !info[1]->IsObject()) {
+    return Nan::ThrowError("Search options are required and must be an object.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  v8::Local<v8::Object> options = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+  CommitSearch *search = new CommitSearch();
+  bool ignoreCase {false};
+  v8::Local<v8::String> propName = Nan::New("ignoreCase").ToLocalChecked();
+  if (Nan::Has(options, propName).FromJust()) {
+    ignoreCase = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+  }
+
+  const std::pair<const char *, CommitSearch::Field> patternFields[] = {
+    { "grep", CommitSearch::Field::kMessage },
+    { "author", CommitSearch::Field::kAuthor },
+    { "committer", CommitSearch::Field::kCommitter }
+  };
+  for (const auto &patternField : patternFields) {
+    v8::Local<v8::Value> value = Nan::Get(options, Nan::New(patternField.first).ToLocalChecked()).ToLocalChecked();
+    if (value->IsNull() || value->IsUndefined()) {
+      continue;
+    }
+
+    std::string error {};
+    if (!setSearchPattern(search, patternField.second, value, ignoreCase, &error)) {
+      delete search;
+      return Nan::ThrowError(("Invalid " + std::string(patternField.first) + " pattern: " + error).c_str());
+    }
+  }
+
+  // commit dates are in seconds: since is inclusive, rounded up, and until inclusive, rounded down
+  v8::Local<v8::Value> since = Nan::Get(options, Nan::New("since").ToLocalChecked()).ToLocalChecked();
+  if (!(since->IsNull() || since->IsUndefined())) {
+    search->SetSince(static_cast<int64_t>(std::ceil(searchDateValue(since) / 1000)));
+  }
+  v8::Local<v8::Value> until = Nan::Get(options, Nan::New("until").ToLocalChecked()).ToLocalChecked();
+  if (!(until->IsNull() || until->IsUndefined())) {
+    search->SetUntil(static_cast<int64_t>(std::floor(searchDateValue(until) / 1000)));
+  }
+  v8::Local<v8::Value> merges = Nan::Get(options, Nan::New("merges").ToLocalChecked()).ToLocalChecked();
+  if (merges->IsBoolean()) {
+    search->SetMerges(merges->IsTrue() ? CommitSearch::Merges::kOnly : CommitSearch::Merges::kNone);
+  }
+
+  SearchWalkBaton* baton = new SearchWalkBaton();
+
+  baton->error_code = GIT_OK;
+  baton->error = NULL;
+  baton->max_count = Nan::To<unsigned int>(info[0]).FromJust();
+  baton->search = static_cast<void *>(search);
+  baton->returnPlainObjects = false;
+  baton->columnar = false;
+  propName = Nan::New("returnPlainObjects").ToLocalChecked();
+  if (Nan::Has(options, propName).FromJust()) {
+    baton->returnPlainObjects = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+  }
+  propName = Nan::New("columnar").ToLocalChecked();
+  if (Nan::Has(options, propName).FromJust()) {
+    baton->columnar = Nan::Get(options, propName).ToLocalChecked()->IsTrue();
+  }
+  // matches are usually few: don't reserve max_count entries
+  if (baton->columnar) {
+    baton->out = static_cast<void *>(new CommitColumns(0));
+  } else {
+    baton->out = static_cast<void *>(new std::vector<CommitModel *>);
+  }
+  baton->walk = Nan::ObjectWrap::Unwrap<GitRevwalk>(info.This())->GetValue();
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  std::map<std::string, std::shared_ptr<nodegit::CleanupHandle>> cleanupHandles;
+  SearchWalkWorker *worker = new SearchWalkWorker(baton, callback, cleanupHandles);
+  worker->Reference<GitRevwalk>("searchWalk", info.This());
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+  return;
+}
+
+nodegit::LockMaster GitRevwalk::SearchWalkWorker::AcquireLocks() {
+  nodegit::LockMaster lockMaster(true, git_revwalk_repository(baton->walk));
+  return lockMaster;
+}
+
+void GitRevwalk::SearchWalkWorker::Execute() {
+  git_error_clear();
+  CommitGraphFile::ApplyConfigToRepository(git_revwalk_repository(baton->walk));
+
+  CommitSearch *search = static_cast<CommitSearch *>(baton->search);
+  git_repository *repo = git_revwalk_repository(baton->walk);
+  git_odb *odb {nullptr};
+  if ((baton->error_code = git_repository_odb(&odb, repo)) != GIT_OK) {
+    if (git_error_last() != NULL) {
+      baton->error = git_error_dup(git_error_last());
+    }
+    freeCommitWalkOut(baton->out, baton->columnar);
+    return;
+  }
+
+  // the raw commits are matched, most of them are never parsed into a git_commit
+  int numMatches {0};
+  while (numMatches < baton->max_count) {
+    git_oid next_commit_id;
+    baton->error_code = git_revwalk_next(&next_commit_id, baton->walk);
+
+    if (baton->error_code == GIT_ITEROVER) {
+      baton->error_code = GIT_OK;
+      break;
+    }
+
+    git_odb_object *object {nullptr};
+    if (baton->error_code == GIT_OK) {
+      baton->error_code = git_odb_read(&object, odb, &next_commit_id);
+    }
+
+    if (baton->error_code != GIT_OK) {
+      if (git_error_last() != NULL) {
+        baton->error = git_error_dup(git_error_last());
+      }
+
+      freeCommitWalkOut(baton->out, baton->columnar);
+      break;
+    }
+
+    const bool matches = search->Matches(
+      static_cast<const char *>(git_odb_object_data(object)), git_odb_object_size(object));
+    git_odb_object_free(object);
+    if (!matches) {
+      continue;
+    }
+
+    git_commit *commit;
+    baton->error_code = git_commit_lookup(&commit, repo, &next_commit_id);
+
+    if (baton->error_code != GIT_OK) {
+      if (git_error_last() != NULL) {
+        baton->error = git_error_dup(git_error_last());
+      }
+
+      freeCommitWalkOut(baton->out, baton->columnar);
+      break;
+    }
+
+    if (baton->columnar) {
+      static_cast<CommitColumns *>(baton->out)->append(commit);
+      git_commit_free(commit);
+    } else {
+      static_cast<std::vector<CommitModel *> *>(baton->out)->push_back(
+        new CommitModel(commit, baton->returnPlainObjects));
+    }
+    ++numMatches;
+  }
+
+  git_odb_free(odb);
+}
+
+void GitRevwalk::SearchWalkWorker::HandleErrorCallback() {
+  if (baton->error) {
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  }
+
+  freeCommitWalkOut(baton->out, baton->columnar);
+  delete static_cast<CommitSearch *>(baton->search);
+
+  delete baton;
+}
+
+void GitRevwalk::SearchWalkWorker::HandleOKCallback() {
+  delete static_cast<CommitSearch *>(baton->search);
+  baton->search = NULL;
+
+  if (baton->out != NULL && baton->columnar) {
+    CommitColumns *columns = static_cast<CommitColumns *>(baton->out);
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      columns->toJavascript()
+    };
+    freeCommitWalkOut(baton->out, baton->columnar);
+    callback->Call(2, argv, async_resource);
+  } else if (baton->out != NULL) {
+    std::vector<CommitModel *> *out = static_cast<std::vector<CommitModel *> *>(baton->out);
+    const unsigned int size = out->size();
+    Local<Array> result = Nan::New<Array>(size);
+    for (unsigned int i = 0; i < size; i++) {
+      CommitModel *commitModel = out->at(i);
+      Nan::Set(
+        result,
+        Nan::New<Number>(i),
+        commitModel->toJavascript()
+      );
+      delete commitModel;
+    }
+
+    delete out;
+
+    Local<v8::Value> argv[2] = {
+      Nan::Null(),
+      result
+    };
+    callback->Call(2, argv, async_resource);
+  } else if (baton->error) {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error(baton->error->message)).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.searchWalk").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+    if (baton->error->message) {
+      free((void *)baton->error->message);
+    }
+
+    free((void *)baton->error);
+  } else if (baton->error_code < 0) {
+    Local<v8::Object> err = Nan::To<v8::Object>(Nan::Error("Revwalk searchWalk has thrown an error.")).ToLocalChecked();
+    Nan::Set(err, Nan::New("errno").ToLocalChecked(), Nan::New(baton->error_code));
+    Nan::Set(err, Nan::New("errorFunction").ToLocalChecked(), Nan::New("Revwalk.searchWalk").ToLocalChecked());
+    Local<v8::Value> argv[1] = {
+      err
+    };
+    callback->Call(1, argv, async_resource);
+  } else {
+    callback->Call(0, NULL, async_resource);
+  }
+
+  delete baton;
+}
@@ -0,0 +1,249 @@
+#include "../include/ahead_behind_batch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <tuple>
+
+AheadBehindBatch::AheadBehindBatch(git_repository *repo, bool useCommitGraph)
+  : m_commitDataSource(repo, useCommitGraph)
+{}
+
+/**
+ * AheadBehindBatch::AddPair
+ */
+size_t AheadBehindBatch::AddPair(const git_oid &local, const git_oid &upstream)
+{
+  auto tipIndex = [this](const git_oid &oid) {
+    return m_tipIndexes.emplace(
+      std::string(reinterpret_cast<const char *>(oid.id), GIT_OID_RAWSZ),
+      static_cast<uint32_t>(m_tipIndexes.size())
+    ).first->second;
+  };
+  const uint32_t localIndex = tipIndex(local);
+  const uint32_t upstreamIndex = tipIndex(upstream);
+  m_pairs.emplace_back(localIndex, upstreamIndex);
+  return m_pairs.size() - 1;
+}
+
+/**
+ * AheadBehindBatch::getCommit
+ */
+int AheadBehindBatch::getCommit(const git_oid &oid, uint32_t *index)
+{
+  auto inserted = m_commitIndexes.emplace(
+    std::string(reinterpret_cast<const char *>(oid.id), GIT_OID_RAWSZ),
+    static_cast<uint32_t>(m_commits.size())
+  );
+  *index = inserted.first->second;
+  if (!inserted.second) {
+    return GIT_OK;
+  }
+
+  CommitDataSource::CommitData data {};
+  int errorCode;
+  if ((errorCode = m_commitDataSource.Lookup(&oid, &data)) != GIT_OK) {
+    m_commitIndexes.erase(inserted.first);
+    return errorCode;
+  }
+
+  Commit commit {};
+  commit.oid = oid;
+  commit.parents = std::move(data.parents);
+  // commits missing from the commit-graph are newer than all those in it
+  commit.generation = data.generation == CommitsGraph::kUnknownGeneration ? UINT32_MAX : data.generation;
+  commit.commitTime = data.commitTime;
+  m_commits.push_back(std::move(commit));
+  m_bitmaps.resize(m_commits.size() * m_numWords, 0);
+  m_countedBitmaps.resize(m_commits.size() * m_numWords, 0);
+  return GIT_OK;
+}
+
+/**
+ * AheadBehindBatch::isFull
+ */
+bool AheadBehindBatch::isFull(uint32_t index) const
+{
+  const size_t numTips = m_tipIndexes.size();
+  const uint64_t *bitmap = &m_bitmaps[index * m_numWords];
+  for (size_t word = 0; word < m_numWords; ++word) {
+    const size_t bitsInWord = std::min<size_t>(64, numTips - word * 64);
+    const uint64_t fullWord = bitsInWord == 64 ? UINT64_MAX : ((uint64_t(1) << bitsInWord) - 1);
+    if (bitmap[word] != fullWord) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * AheadBehindBatch::isStale
+ * A commit reachable from both commits of each pair, or from none of them, counts for no pair,
+ * and neither do the commits only reachable through it.
+ */
+bool AheadBehindBatch::isStale(uint32_t index) const
+{
+  const uint64_t *bitmap = &m_bitmaps[index * m_numWords];
+  auto hasTip = [bitmap](uint32_t tip) {
+    return (bitmap[tip / 64] >> (tip % 64)) & 1;
+  };
+  for (const std::pair<uint32_t, uint32_t> &pair : m_pairs) {
+    if (hasTip(pair.first) != hasTip(pair.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * AheadBehindBatch::bitmapKey
+ */
+std::string AheadBehindBatch::bitmapKey(uint32_t index, const std::vector<uint64_t> &bitmaps) const
+{
+  return std::string(reinterpret_cast<const char *>(&bitmaps[index * m_numWords]), m_numWords * sizeof(uint64_t));
+}
+
+/**
+ * AheadBehindBatch::Compute
+ * Commits are visited newest first, by (generation, commit time). With generation numbers a commit
+ * is always visited after all of its descendants; commits missing from the commit-graph are ordered
+ * by commit time, as git does, and can then be reached with more tips after being counted. So the
+ * walk goes on while a queued commit is newer than a commit counted without all the tips: it may
+ * be one of its descendants, and its parents will be visited again with the tips they lacked.
+ */
+int AheadBehindBatch::Compute()
+{
+  m_ahead.assign(m_pairs.size(), 0);
+  m_behind.assign(m_pairs.size(), 0);
+  if (m_pairs.empty()) {
+    return GIT_OK;
+  }
+  m_numWords = (m_tipIndexes.size() + 63) / 64;
+
+  // newest first: (generation, commit time, index)
+  typedef std::tuple<uint32_t, int64_t, uint32_t> QueueEntry;
+  std::priority_queue<QueueEntry> queue {};
+  size_t numQueuedNotStale {0};
+  auto enqueue = [&](uint32_t index) {
+    Commit &commit = m_commits[index];
+    commit.queued = true;
+    commit.stale = isStale(index);
+    queue.emplace(commit.generation, commit.commitTime, index);
+    if (!commit.stale) {
+      ++numQueuedNotStale;
+    }
+  };
+
+  int errorCode;
+  for (const auto &tip : m_tipIndexes) {
+    git_oid oid;
+    memcpy(oid.id, tip.first.data(), GIT_OID_RAWSZ);
+    uint32_t index;
+    if ((errorCode = getCommit(oid, &index)) != GIT_OK) {
+      return errorCode;
+    }
+    m_bitmaps[index * m_numWords + tip.second / 64] |= uint64_t(1) << (tip.second % 64);
+  }
+  for (uint32_t index = 0; index < m_commits.size(); ++index) {
+    enqueue(index);
+  }
+
+  // number of commits reachable from each set of tips
+  std::unordered_map<std::string, uint32_t> numCommitsByBitmap {};
+  // (generation, commit time) -> number of commits counted without all the tips
+  typedef std::pair<uint32_t, int64_t> CommitOrder;
+  std::map<CommitOrder, uint32_t> numPartiallyCountedByOrder {};
+  auto mayReachPartiallyCounted = [&]() {
+    return !numPartiallyCountedByOrder.empty()
+      && CommitOrder(std::get<0>(queue.top()), std::get<1>(queue.top())) >= numPartiallyCountedByOrder.begin()->first;
+  };
+  while (!queue.empty() && (numQueuedNotStale > 0 || mayReachPartiallyCounted())) {
+    const uint32_t index = std::get<2>(queue.top());
+    queue.pop();
+    m_commits[index].queued = false;
+    if (!m_commits[index].stale) {
+      --numQueuedNotStale;
+    }
+    const bool full = isFull(index);
+
+    // a commit can be reached again with more tips when commit times are skewed
+    const CommitOrder order(m_commits[index].generation, m_commits[index].commitTime);
+    if (m_commits[index].counted) {
+      --numCommitsByBitmap[bitmapKey(index, m_countedBitmaps)];
+      if (m_commits[index].countedPartially && --numPartiallyCountedByOrder[order] == 0) {
+        numPartiallyCountedByOrder.erase(order);
+      }
+    }
+    ++numCommitsByBitmap[bitmapKey(index, m_bitmaps)];
+    std::copy_n(&m_bitmaps[index * m_numWords], m_numWords, &m_countedBitmaps[index * m_numWords]);
+    m_commits[index].counted = true;
+    m_commits[index].countedPartially = !full;
+    if (!full) {
+      ++numPartiallyCountedByOrder[order];
+    }
+
+    for (size_t parentIndex = 0; parentIndex < m_commits[index].parents.size(); ++parentIndex) {
+      uint32_t parent;
+      // m_commits can grow: don't keep references to it across getCommit
+      if ((errorCode = getCommit(m_commits[index].parents[parentIndex], &parent)) != GIT_OK) {
+        return errorCode;
+      }
+
+      bool changed {false};
+      for (size_t word = 0; word < m_numWords; ++word) {
+        const uint64_t bits = m_bitmaps[parent * m_numWords + word] | m_bitmaps[index * m_numWords + word];
+        changed = changed || bits != m_bitmaps[parent * m_numWords + word];
+        m_bitmaps[parent * m_numWords + word] = bits;
+      }
+      if (!changed) {
+        continue;
+      }
+      if (!m_commits[parent].queued) {
+        enqueue(parent);
+      }
+      else if (m_commits[parent].stale != isStale(parent)) {
+        m_commits[parent].stale = !m_commits[parent].stale;
+        if (m_commits[parent].stale) {
+          --numQueuedNotStale;
+        }
+        else {
+          ++numQueuedNotStale;
+        }
+      }
+    }
+  }
+
+  // tip -> (pair, whether it's the local side)
+  std::vector<std::vector<std::pair<uint32_t, bool>>> pairsByTip(m_tipIndexes.size());
+  for (uint32_t pairIndex = 0; pairIndex < m_pairs.size(); ++pairIndex) {
+    pairsByTip[m_pairs[pairIndex].first].emplace_back(pairIndex, true);
+    pairsByTip[m_pairs[pairIndex].second].emplace_back(pairIndex, false);
+  }
+  for (const auto &entry : numCommitsByBitmap) {
+    if (entry.second == 0) {
+      continue;
+    }
+    std::vector<uint64_t> bitmap(m_numWords);
+    memcpy(bitmap.data(), entry.first.data(), entry.first.size());
+    auto hasTip = [&bitmap](uint32_t tip) {
+      return (bitmap[tip / 64] >> (tip % 64)) & 1;
+    };
+    for (uint32_t tip = 0; tip < pairsByTip.size(); ++tip) {
+      if (!hasTip(tip)) {
+        continue;
+      }
+      for (const auto &pairOfTip : pairsByTip[tip]) {
+        const std::pair<uint32_t, uint32_t> &pair = m_pairs[pairOfTip.first];
+        if (pairOfTip.second && !hasTip(pair.second)) {
+          m_ahead[pairOfTip.first] += entry.second;
+        }
+        else if (!pairOfTip.second && !hasTip(pair.first)) {
+          m_behind[pairOfTip.first] += entry.second;
+        }
+      }
+    }
+  }
+
+  return GIT_OK;
+}
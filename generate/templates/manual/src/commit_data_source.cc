@@ -0,0 +1,129 @@
+#include "../include/commit_data_source.h"
+
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+CommitDataSource::CommitDataSource(git_repository *repo, bool useCommitGraph)
+  : m_repo(repo)
+{
+  if (useCommitGraph) {
+    m_commitGraph = CommitGraphFile::Open(repo, CommitGraphFile::kLoadCommitData);
+  }
+}
+
+/**
+ * CommitDataSource::Lookup
+ */
+int CommitDataSource::Lookup(const git_oid *oid, CommitData *data)
+{
+  if (m_commitGraph && m_commitGraph->LookupCommit(oid, &data->parents, &data->commitTime, &data->generation)) {
+    ++m_numLookupsFromCommitGraph;
+    return GIT_OK;
+  }
+
+  git_commit *commit {nullptr};
+  int errorCode;
+  if ((errorCode = git_commit_lookup(&commit, m_repo, oid)) != GIT_OK) {
+    return errorCode;
+  }
+
+  const unsigned int numParents = git_commit_parentcount(commit);
+  data->parents.resize(numParents);
+  for (unsigned int i = 0; i < numParents; ++i) {
+    git_oid_cpy(&data->parents[i], git_commit_parent_id(commit, i));
+  }
+  data->commitTime = static_cast<int64_t>(git_commit_time(commit));
+  data->generation = CommitsGraph::kUnknownGeneration;
+  git_commit_free(commit);
+
+  ++m_numLookupsFromOdb;
+  return GIT_OK;
+}
+
+/**
+ * CommitDataSource::GetReferenceTips
+ */
+int CommitDataSource::GetReferenceTips(std::vector<git_oid> *tips)
+{
+  int errorCode {GIT_OK};
+  git_reference_iterator *iterator {nullptr};
+  if ((errorCode = git_reference_iterator_glob_new(&iterator, m_repo, "refs/*")) != GIT_OK) {
+    return errorCode;
+  }
+
+  git_reference *reference {nullptr};
+  while ((errorCode = git_reference_next(&reference, iterator)) == GIT_OK) {
+    git_object *target {nullptr};
+    if (git_reference_peel(&target, reference, GIT_OBJECT_COMMIT) == GIT_OK) {
+      tips->push_back(*git_object_id(target));
+      git_object_free(target);
+    }
+    git_reference_free(reference);
+  }
+  git_reference_iterator_free(iterator);
+  if (errorCode != GIT_ITEROVER) {
+    return errorCode;
+  }
+  git_error_clear();
+
+  // HEAD could be detached
+  git_oid headOid;
+  if (git_reference_name_to_id(&headOid, m_repo, "HEAD") == GIT_OK) {
+    tips->push_back(headOid);
+  }
+  git_error_clear();
+
+  return GIT_OK;
+}
+
+/**
+ * CommitDataSource::AddReachableCommitsToGraph
+ */
+int CommitDataSource::AddReachableCommitsToGraph(
+  const std::vector<git_oid> &tips,
+  CommitsGraph *graph,
+  const std::function<bool()> &keepGoing)
+{
+  std::unordered_set<std::string> seen {};
+  // oid of a commit to add, and whether it is one of the tips
+  std::vector<std::pair<git_oid, bool>> pending {};
+  for (const git_oid &tip : tips) {
+    if (seen.emplace(reinterpret_cast<const char *>(tip.id), GIT_OID_RAWSZ).second) {
+      pending.emplace_back(tip, true);
+    }
+  }
+
+  CommitData data {};
+  std::vector<std::string> parents {};
+  while (!pending.empty()) {
+    if (keepGoing && !keepGoing()) {
+      return GIT_EUSER;
+    }
+
+    const git_oid oid = pending.back().first;
+    const bool isTip = pending.back().second;
+    pending.pop_back();
+
+    int errorCode;
+    if ((errorCode = Lookup(&oid, &data)) != GIT_OK) {
+      // parents missing from a shallow clone are left out; CommitsGraph ignores them
+      if (errorCode == GIT_ENOTFOUND && !isTip) {
+        git_error_clear();
+        continue;
+      }
+      return errorCode;
+    }
+
+    parents.clear();
+    for (const git_oid &parentOid : data.parents) {
+      parents.emplace_back(reinterpret_cast<const char *>(parentOid.id), GIT_OID_RAWSZ);
+      if (seen.emplace(parents.back()).second) {
+        pending.emplace_back(parentOid, false);
+      }
+    }
+    graph->AddNode(std::string(reinterpret_cast<const char *>(oid.id), GIT_OID_RAWSZ), parents);
+  }
+
+  return GIT_OK;
+}
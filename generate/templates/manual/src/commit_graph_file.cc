@@ -0,0 +1,509 @@
+#include "../include/commit_graph_file.h"
+#include "../include/mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+  const uint32_t kSignature = 0x43475048; // "CGPH"
+  const uint32_t kChunkOidFanout = 0x4f494446; // "OIDF"
+  const uint32_t kChunkOidLookup = 0x4f49444c; // "OIDL"
+  const uint32_t kChunkCommitData = 0x43444154; // "CDAT"
+  const uint32_t kChunkExtraEdges = 0x45444745; // "EDGE"
+  const uint32_t kChunkBloomIndexes = 0x42494458; // "BIDX"
+  const uint32_t kChunkBloomData = 0x42444154; // "BDAT"
+  const size_t kHeaderSize = 8;
+  const size_t kChunkLookupEntrySize = 12;
+  const size_t kBloomDataHeaderSize = 12;
+  const size_t kCommitDataEntrySize = GIT_OID_RAWSZ + 16;
+  const uint32_t kParentNone = 0x70000000;
+  const uint32_t kParentExtraEdges = 0x80000000;
+  const uint32_t kBloomSeed = 0x293ae76f;
+  const uint32_t kBloomStepSeed = 0x7e646e2c;
+
+  uint32_t readUint32BE(const unsigned char *data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+      (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+  }
+
+  uint64_t readUint64BE(const unsigned char *data) {
+    return (static_cast<uint64_t>(readUint32BE(data)) << 32) | readUint32BE(data + 4);
+  }
+
+  uint32_t rotateLeft(uint32_t value, int count) {
+    return (value << count) | (value >> (32 - count));
+  }
+
+  // byte of a murmur3 input; version 1 sign-extends bytes >= 0x80, like git did on x86
+  uint32_t murmur3Byte(const char *data, size_t index, int hashVersion) {
+    return hashVersion == 1
+      ? static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(data[index])))
+      : static_cast<uint32_t>(static_cast<unsigned char>(data[index]));
+  }
+
+  // bytes of a chunk, read in place from the mapped file
+  struct ChunkView {
+    const char *start {nullptr};
+    size_t length {0};
+
+    const char *data() const { return start; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+  };
+}
+
+/**
+ * \struct CommitGraphFile::Layer
+ * One commit-graph file: the commit oids it contains and their Bloom filters.
+ * The file is mapped in memory and its chunks are read in place.
+ */
+struct CommitGraphFile::Layer
+{
+  MappedFile file {};
+  uint32_t fanout[256] {};
+  uint32_t numCommits {0};
+  uint32_t basePosition {0}; // number of commits in the layers below this one
+  ChunkView oids {}; // raw oids, sorted
+  ChunkView commitData {};
+  ChunkView extraEdges {};
+  ChunkView bloomIndexes {}; // big-endian uint32 end offset of each filter in bloomData
+  ChunkView bloomData {};
+  int hashVersion {0};
+  uint32_t numHashes {0};
+
+  bool HasBloomFilters() const { return numHashes > 0; }
+
+  // \return the position of the commit in this layer, or false if it's not here
+  bool Find(const git_oid *oid, uint32_t *position) const {
+    const unsigned char firstByte = oid->id[0];
+    uint32_t low = firstByte == 0 ? 0 : fanout[firstByte - 1];
+    uint32_t high = fanout[firstByte];
+    while (low < high) {
+      const uint32_t middle = low + (high - low) / 2;
+      const int cmp = memcmp(oids.data() + static_cast<size_t>(middle) * GIT_OID_RAWSZ, oid->id, GIT_OID_RAWSZ);
+      if (cmp == 0) {
+        *position = middle;
+        return true;
+      }
+      if (cmp < 0) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return false;
+  }
+};
+
+CommitGraphFile::~CommitGraphFile() = default;
+
+CommitGraphFile::BloomKey::BloomKey(const std::string &path)
+{
+  // git adds each leading directory of a changed path to the filter too
+  std::string trimmedPath = path;
+  while (!trimmedPath.empty() && trimmedPath.back() == '/') {
+    trimmedPath.pop_back();
+  }
+
+  std::vector<size_t> lengths {};
+  for (size_t i = 0; i < trimmedPath.size(); ++i) {
+    if (trimmedPath[i] == '/') {
+      lengths.push_back(i);
+    }
+  }
+  lengths.push_back(trimmedPath.size());
+
+  for (int hashVersion = 1; hashVersion <= 2; ++hashVersion) {
+    for (size_t length : lengths) {
+      m_seedHashes[hashVersion - 1].push_back(Murmur3(kBloomSeed, trimmedPath.data(), length, hashVersion));
+      m_stepHashes[hashVersion - 1].push_back(Murmur3(kBloomStepSeed, trimmedPath.data(), length, hashVersion));
+    }
+  }
+}
+
+/**
+ * CommitGraphFile::Murmur3
+ * 32-bit murmur3, as implemented by git for its changed-path Bloom filters.
+ */
+uint32_t CommitGraphFile::Murmur3(uint32_t seed, const char *data, size_t len, int hashVersion)
+{
+  const uint32_t c1 = 0xcc9e2d51;
+  const uint32_t c2 = 0x1b873593;
+  const size_t len4 = len / 4;
+
+  for (size_t i = 0; i < len4; ++i) {
+    uint32_t k = murmur3Byte(data, 4 * i, hashVersion) |
+      (murmur3Byte(data, 4 * i + 1, hashVersion) << 8) |
+      (murmur3Byte(data, 4 * i + 2, hashVersion) << 16) |
+      (murmur3Byte(data, 4 * i + 3, hashVersion) << 24);
+    k *= c1;
+    k = rotateLeft(k, 15);
+    k *= c2;
+
+    seed ^= k;
+    seed = rotateLeft(seed, 13) * 5 + 0xe6546b64;
+  }
+
+  const size_t tail = len4 * 4;
+  uint32_t k1 = 0;
+  switch (len & 3) {
+    case 3:
+      k1 ^= murmur3Byte(data, tail + 2, hashVersion) << 16;
+      // fall through
+    case 2:
+      k1 ^= murmur3Byte(data, tail + 1, hashVersion) << 8;
+      // fall through
+    case 1:
+      k1 ^= murmur3Byte(data, tail, hashVersion);
+      k1 *= c1;
+      k1 = rotateLeft(k1, 15);
+      k1 *= c2;
+      seed ^= k1;
+      break;
+  }
+
+  seed ^= static_cast<uint32_t>(len);
+  seed ^= (seed >> 16);
+  seed *= 0x85ebca6b;
+  seed ^= (seed >> 13);
+  seed *= 0xc2b2ae35;
+  seed ^= (seed >> 16);
+  return seed;
+}
+
+/**
+ * CommitGraphFile::loadLayer
+ * Reads the oids and the Bloom filters of a commit-graph file.
+ * \return nullptr if the file doesn't exist or is not a valid SHA-1 commit-graph.
+ */
+std::unique_ptr<CommitGraphFile::Layer> CommitGraphFile::loadLayer(
+  const std::string &filePath, int flags, uint32_t basePosition)
+{
+  std::unique_ptr<Layer> layer = std::make_unique<Layer>();
+  if (layer->file.Map(filePath) != GIT_OK) {
+    return nullptr;
+  }
+  const char *fileData = layer->file.Data();
+  const uint64_t fileSize = layer->file.Length();
+
+  if (fileSize < kHeaderSize) {
+    return nullptr;
+  }
+  const unsigned char *headerData = reinterpret_cast<const unsigned char *>(fileData);
+  // version 1, SHA-1 oids
+  if (readUint32BE(headerData) != kSignature || headerData[4] != 1 || headerData[5] != 1) {
+    return nullptr;
+  }
+  const size_t numChunks = headerData[6];
+  if (fileSize < kHeaderSize + (numChunks + 1) * kChunkLookupEntrySize) {
+    return nullptr;
+  }
+
+  layer->basePosition = basePosition;
+  const bool loadBloomFilters = (flags & kLoadBloomFilters) != 0;
+  const bool loadCommitData = (flags & kLoadCommitData) != 0;
+  ChunkView fanout {};
+  ChunkView bloomData {};
+  for (size_t i = 0; i < numChunks; ++i) {
+    const unsigned char *entry = headerData + kHeaderSize + i * kChunkLookupEntrySize;
+    const uint32_t chunkId = readUint32BE(entry);
+    const uint64_t chunkOffset = readUint64BE(entry + 4);
+    const uint64_t chunkEnd = readUint64BE(entry + kChunkLookupEntrySize + 4);
+    if (chunkOffset > chunkEnd || chunkEnd > fileSize) {
+      return nullptr;
+    }
+    const ChunkView chunk { fileData + chunkOffset, static_cast<size_t>(chunkEnd - chunkOffset) };
+
+    switch (chunkId) {
+      case kChunkOidFanout:
+        if (chunk.size() != 256 * 4) {
+          return nullptr;
+        }
+        fanout = chunk;
+        break;
+      case kChunkOidLookup:
+        layer->oids = chunk;
+        break;
+      case kChunkCommitData:
+        if (loadCommitData) {
+          layer->commitData = chunk;
+        }
+        break;
+      case kChunkExtraEdges:
+        if (loadCommitData) {
+          layer->extraEdges = chunk;
+        }
+        break;
+      case kChunkBloomIndexes:
+        if (loadBloomFilters) {
+          layer->bloomIndexes = chunk;
+        }
+        break;
+      case kChunkBloomData:
+        if (loadBloomFilters) {
+          if (chunk.size() < kBloomDataHeaderSize) {
+            return nullptr;
+          }
+          bloomData = chunk;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (fanout.empty()) {
+    return nullptr;
+  }
+  const unsigned char *fanoutData = reinterpret_cast<const unsigned char *>(fanout.data());
+  for (size_t i = 0; i < 256; ++i) {
+    layer->fanout[i] = readUint32BE(fanoutData + i * 4);
+    if (i > 0 && layer->fanout[i] < layer->fanout[i - 1]) {
+      return nullptr;
+    }
+  }
+  layer->numCommits = layer->fanout[255];
+  if (layer->oids.size() != static_cast<size_t>(layer->numCommits) * GIT_OID_RAWSZ) {
+    return nullptr;
+  }
+  if (loadCommitData && layer->commitData.size() != static_cast<size_t>(layer->numCommits) * kCommitDataEntrySize) {
+    return nullptr;
+  }
+
+  // Bloom filters are optional
+  if (!bloomData.empty() && layer->bloomIndexes.size() == static_cast<size_t>(layer->numCommits) * 4) {
+    const unsigned char *bloomHeader = reinterpret_cast<const unsigned char *>(bloomData.data());
+    const uint32_t hashVersion = readUint32BE(bloomHeader);
+    const uint32_t numHashes = readUint32BE(bloomHeader + 4);
+    if ((hashVersion == 1 || hashVersion == 2) && numHashes > 0) {
+      layer->hashVersion = static_cast<int>(hashVersion);
+      layer->numHashes = numHashes;
+      layer->bloomData = ChunkView { bloomData.data() + kBloomDataHeaderSize, bloomData.size() - kBloomDataHeaderSize };
+    }
+  }
+  if (!layer->HasBloomFilters()) {
+    layer->bloomIndexes = ChunkView {};
+  }
+
+  return layer;
+}
+
+/**
+ * CommitGraphFile::isEnabled
+ * core.commitGraph, true unless set otherwise; false if the configuration can't be read.
+ */
+bool CommitGraphFile::isEnabled(git_repository *repo)
+{
+  git_config *config {nullptr};
+  if (git_repository_config_snapshot(&config, repo) != GIT_OK) {
+    git_error_clear();
+    return false;
+  }
+  int enabled {1};
+  if (git_config_get_bool(&enabled, config, "core.commitGraph") != GIT_OK) {
+    git_error_clear();
+    enabled = 1;
+  }
+  git_config_free(config);
+  return enabled != 0;
+}
+
+/**
+ * CommitGraphFile::ApplyConfigToRepository
+ * libgit2 gives the object database of a repository the objects/info/commit-graph file when
+ * it opens it, whatever core.commitGraph says. Setting it again frees the previous one, which
+ * a walk on another thread could be reading: hence the repository lock.
+ */
+void CommitGraphFile::ApplyConfigToRepository(git_repository *repo)
+{
+  if (isEnabled(repo)) {
+    return;
+  }
+
+  git_odb *odb {nullptr};
+  if (git_repository_odb(&odb, repo) != GIT_OK) {
+    git_error_clear();
+    return;
+  }
+  git_odb_set_commit_graph(odb, nullptr);
+  git_odb_free(odb);
+}
+
+/**
+ * CommitGraphFile::Open
+ */
+std::unique_ptr<CommitGraphFile> CommitGraphFile::Open(git_repository *repo, int flags)
+{
+  if (!isEnabled(repo)) {
+    return nullptr;
+  }
+
+  const std::string infoDir = std::string(git_repository_commondir(repo)) + "objects/info/";
+  std::unique_ptr<CommitGraphFile> commitGraph(new CommitGraphFile());
+
+  std::unique_ptr<Layer> layer = loadLayer(infoDir + "commit-graph", flags, 0);
+  if (layer) {
+    commitGraph->m_layers.push_back(std::move(layer));
+  } else {
+    // split commit-graph: one layer per line, the base one first
+    std::ifstream chainFile(infoDir + "commit-graphs/commit-graph-chain");
+    std::string hash {};
+    while (std::getline(chainFile, hash)) {
+      if (hash.empty()) {
+        continue;
+      }
+      layer = loadLayer(infoDir + "commit-graphs/graph-" + hash + ".graph", flags,
+        static_cast<uint32_t>(commitGraph->GetNumCommits()));
+      if (!layer) {
+        // the layers on top of a missing one can't be trusted to be complete, but the ones below can
+        break;
+      }
+      commitGraph->m_layers.push_back(std::move(layer));
+    }
+  }
+
+  if (commitGraph->m_layers.empty()) {
+    return nullptr;
+  }
+  if (flags & kLoadCommitData) {
+    return commitGraph;
+  }
+  for (const std::unique_ptr<Layer> &loadedLayer : commitGraph->m_layers) {
+    if (loadedLayer->HasBloomFilters()) {
+      return commitGraph;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * CommitGraphFile::oidAtPosition
+ * Positions are global to the chain of commit-graph files: the commits of the base layer first.
+ */
+bool CommitGraphFile::oidAtPosition(uint32_t position, git_oid *oid) const
+{
+  for (const std::unique_ptr<Layer> &layer : m_layers) {
+    if (position >= layer->basePosition && position - layer->basePosition < layer->numCommits) {
+      memcpy(oid->id, layer->oids.data() + static_cast<size_t>(position - layer->basePosition) * GIT_OID_RAWSZ,
+        GIT_OID_RAWSZ);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * CommitGraphFile::LookupCommit
+ */
+bool CommitGraphFile::LookupCommit(
+  const git_oid *commitOid,
+  std::vector<git_oid> *parents,
+  int64_t *commitTime,
+  uint32_t *generation) const
+{
+  for (const std::unique_ptr<Layer> &layer : m_layers) {
+    uint32_t position {0};
+    if (layer->commitData.empty() || !layer->Find(commitOid, &position)) {
+      continue;
+    }
+
+    // tree oid, first parent, second parent, then generation (30 bits) and commit time (34 bits)
+    const unsigned char *entry = reinterpret_cast<const unsigned char *>(layer->commitData.data()) +
+      static_cast<size_t>(position) * kCommitDataEntrySize;
+    const uint32_t parent1 = readUint32BE(entry + GIT_OID_RAWSZ);
+    const uint32_t parent2 = readUint32BE(entry + GIT_OID_RAWSZ + 4);
+    const uint32_t generationAndTimeHigh = readUint32BE(entry + GIT_OID_RAWSZ + 8);
+    const uint32_t timeLow = readUint32BE(entry + GIT_OID_RAWSZ + 12);
+
+    parents->clear();
+    git_oid parentOid;
+    if (parent1 != kParentNone) {
+      if (!oidAtPosition(parent1, &parentOid)) {
+        return false;
+      }
+      parents->push_back(parentOid);
+    }
+    if (parent2 != kParentNone && (parent2 & kParentExtraEdges) == 0) {
+      if (!oidAtPosition(parent2, &parentOid)) {
+        return false;
+      }
+      parents->push_back(parentOid);
+    }
+    else if (parent2 != kParentNone) {
+      // octopus merge: the second and next parents are listed in the extra edges, the last one flagged
+      const unsigned char *edges = reinterpret_cast<const unsigned char *>(layer->extraEdges.data());
+      const size_t numEdges = layer->extraEdges.size() / 4;
+      for (size_t edgeIndex = parent2 & ~kParentExtraEdges; ; ++edgeIndex) {
+        if (edgeIndex >= numEdges) {
+          return false;
+        }
+        const uint32_t edge = readUint32BE(edges + edgeIndex * 4);
+        if (!oidAtPosition(edge & ~kParentExtraEdges, &parentOid)) {
+          return false;
+        }
+        parents->push_back(parentOid);
+        if (edge & kParentExtraEdges) {
+          break;
+        }
+      }
+    }
+
+    *generation = generationAndTimeHigh >> 2;
+    *commitTime = static_cast<int64_t>((static_cast<uint64_t>(generationAndTimeHigh & 0x3) << 32) | timeLow);
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * CommitGraphFile::MaybeChangedPath
+ */
+bool CommitGraphFile::MaybeChangedPath(const git_oid *commitOid, const BloomKey &key) const
+{
+  for (const std::unique_ptr<Layer> &layer : m_layers) {
+    uint32_t position {0};
+    if (!layer->Find(commitOid, &position)) {
+      continue;
+    }
+    if (!layer->HasBloomFilters()) {
+      return true;
+    }
+
+    const unsigned char *indexes = reinterpret_cast<const unsigned char *>(layer->bloomIndexes.data());
+    const uint32_t filterStart = position == 0 ? 0 : readUint32BE(indexes + (position - 1) * 4);
+    const uint32_t filterEnd = readUint32BE(indexes + position * 4);
+    if (filterStart >= filterEnd || filterEnd > layer->bloomData.size()) {
+      // empty or corrupt filter: nothing can be told
+      return true;
+    }
+
+    const unsigned char *filter = reinterpret_cast<const unsigned char *>(layer->bloomData.data()) + filterStart;
+    const uint64_t numBits = static_cast<uint64_t>(filterEnd - filterStart) * 8;
+    const std::vector<uint32_t> &seedHashes = key.m_seedHashes[layer->hashVersion - 1];
+    const std::vector<uint32_t> &stepHashes = key.m_stepHashes[layer->hashVersion - 1];
+
+    // if the path or any of its directories is not in the filter, the path didn't change
+    for (size_t i = 0; i < seedHashes.size(); ++i) {
+      for (uint32_t hashIndex = 0; hashIndex < layer->numHashes; ++hashIndex) {
+        const uint32_t hash = seedHashes[i] + hashIndex * stepHashes[i];
+        const uint64_t bit = hash % numBits;
+        if ((filter[bit / 8] & (1 << (bit % 8))) == 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  return true;
+}
+
+size_t CommitGraphFile::GetNumCommits() const
+{
+  size_t numCommits {0};
+  for (const std::unique_ptr<Layer> &layer : m_layers) {
+    numCommits += layer->numCommits;
+  }
+  return numCommits;
+}
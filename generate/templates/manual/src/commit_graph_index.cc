@@ -0,0 +1,346 @@
+#include <nan.h>
+#include <string.h>
+#include <thread>
+
+extern "C" {
+  #include <git2.h>
+}
+
+#include "../include/context.h"
+#include "../include/commit_graph_index.h"
+#include "../include/oid.h"
+#include "../include/v8_helpers.h"
+#include "../include/worker_pool.h"
+
+using namespace std;
+using namespace v8;
+using namespace node;
+
+namespace {
+  // \return false if the value is neither an Oid nor a valid sha, with the libgit2 error set
+  bool rawOidFromJavascript(v8::Local<v8::Value> value, std::string *rawOid) {
+    git_oid oid;
+    if (value->IsString()) {
+      Nan::Utf8String oidString(Nan::To<v8::String>(value).ToLocalChecked());
+      if (git_oid_fromstr(&oid, *oidString) != GIT_OK) {
+        return false;
+      }
+    }
+    else if (value->IsObject()) {
+      git_oid_cpy(&oid, Nan::ObjectWrap::Unwrap<GitOid>(Nan::To<v8::Object>(value).ToLocalChecked())->GetValue());
+    }
+    else {
+      git_error_set_str(GIT_ERROR_INVALID, "Oid id is required.");
+      return false;
+    }
+
+    rawOid->assign(reinterpret_cast<const char *>(oid.id), GIT_OID_RAWSZ);
+    return true;
+  }
+
+  // \return false if the value is neither an Array of Oids or shas, nor a single one
+  bool rawOidsFromJavascript(v8::Local<v8::Value> value, std::vector<std::string> *rawOids) {
+    if (!value->IsArray()) {
+      rawOids->resize(1);
+      return rawOidFromJavascript(value, &rawOids->front());
+    }
+
+    v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(value);
+    rawOids->resize(array->Length());
+    for (uint32_t i = 0; i < array->Length(); ++i) {
+      if (!rawOidFromJavascript(Nan::Get(array, i).ToLocalChecked(), &(*rawOids)[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * \class WorkItemQueries
+   * Range of the queries of a QueryBaton, so that each work item holds a batch of them.
+   */
+  class WorkItemQueries : public WorkItem {
+  public:
+    static constexpr size_t kMaxQueries = 256;
+
+    WorkItemQueries(size_t begin, size_t end) : m_begin(begin), m_end(end) {}
+    ~WorkItemQueries() = default;
+    WorkItemQueries(const WorkItemQueries &other) = delete;
+    WorkItemQueries(WorkItemQueries &&other) = delete;
+    WorkItemQueries& operator=(const WorkItemQueries &other) = delete;
+    WorkItemQueries& operator=(WorkItemQueries &&other) = delete;
+
+    size_t GetBegin() const { return m_begin; }
+    size_t GetEnd() const { return m_end; }
+
+  private:
+    size_t m_begin {0};
+    size_t m_end {0};
+  };
+
+  /**
+   * \class WorkerQueries
+   * Worker for the WorkPool answering queries on a graph. The graph is only read, and each
+   * query writes its own result, so workers don't need to synchronize.
+   */
+  template<class Run>
+  class WorkerQueries : public IWorker
+  {
+  public:
+    WorkerQueries(const Run &run) : m_run(run) {}
+    ~WorkerQueries() = default;
+    WorkerQueries(const WorkerQueries &other) = delete;
+    WorkerQueries(WorkerQueries &&other) = delete;
+    WorkerQueries& operator=(const WorkerQueries &other) = delete;
+    WorkerQueries& operator=(WorkerQueries &&other) = delete;
+
+    bool Initialize() { return true; }
+    bool Execute(std::unique_ptr<WorkItem> &&work) {
+      std::unique_ptr<WorkItemQueries> wi {static_cast<WorkItemQueries *>(work.release())};
+      for (size_t i = wi->GetBegin(); i < wi->GetEnd(); ++i) {
+        m_run(i);
+      }
+      return true;
+    }
+
+  private:
+    const Run &m_run;
+  };
+
+  // runs run(i) for i in [0, numQueries), in parallel when there are enough queries
+  template<class Run>
+  bool runQueries(size_t numQueries, const Run &run) {
+    const unsigned int numThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    if (numThreads == 1 || numQueries <= WorkItemQueries::kMaxQueries) {
+      for (size_t i = 0; i < numQueries; ++i) {
+        run(i);
+      }
+      return true;
+    }
+
+    std::vector< std::shared_ptr<WorkerQueries<Run>> > workers {};
+    for (unsigned int i = 0; i < numThreads; ++i) {
+      workers.emplace_back(std::make_shared<WorkerQueries<Run>>(run));
+    }
+
+    WorkerPool<WorkerQueries<Run>, WorkItemQueries> workerPool {};
+    workerPool.Init(workers);
+    for (size_t begin = 0; begin < numQueries; begin += WorkItemQueries::kMaxQueries) {
+      workerPool.InsertWork(std::make_unique<WorkItemQueries>(
+        begin, std::min(begin + WorkItemQueries::kMaxQueries, numQueries)));
+    }
+    workerPool.Shutdown();
+
+    return workerPool.Status() == WPStatus::kOk;
+  }
+}
+
+CommitGraphIndex::CommitGraphIndex(CommitsGraph *graph) : graph(graph) {}
+
+void CommitGraphIndex::InitializeComponent(Local<v8::Object> target, nodegit::Context *nodegitContext) {
+  Nan::HandleScope scope;
+
+  Local<External> nodegitExternal = Nan::New<External>(nodegitContext);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(JSNewFunction, nodegitExternal);
+
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tpl->SetClassName(Nan::New("CommitGraphIndex").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tpl, "count", Count, nodegitExternal);
+  Nan::SetPrototypeMethod(tpl, "maxGeneration", MaxGeneration, nodegitExternal);
+  Nan::SetPrototypeMethod(tpl, "generation", Generation, nodegitExternal);
+  Nan::SetPrototypeMethod(tpl, "isAncestorBatch", IsAncestorBatch, nodegitExternal);
+  Nan::SetPrototypeMethod(tpl, "mergeBaseBatch", MergeBaseBatch, nodegitExternal);
+
+  Local<Function> constructor_template = Nan::GetFunction(tpl).ToLocalChecked();
+  nodegitContext->SaveToPersistent("CommitGraphIndex::Template", constructor_template);
+  Nan::Set(target, Nan::New("CommitGraphIndex").ToLocalChecked(), constructor_template);
+}
+
+NAN_METHOD(CommitGraphIndex::JSNewFunction) {
+
+  if (info.Length() == 0 || !info[0]->IsExternal()) {
+       return Nan::ThrowError("A new CommitGraphIndex cannot be instantiated.");
+   }
+
+  CommitGraphIndex* object = new CommitGraphIndex(static_cast<CommitsGraph *>(Local<External>::Cast(info[0])->Value()));
+  object->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+Local<v8::Value> CommitGraphIndex::New(CommitsGraph *graph) {
+  Nan::EscapableHandleScope scope;
+  Local<v8::Value> argv[1] = { Nan::New<External>((void *)graph) };
+  nodegit::Context *nodegitContext = nodegit::Context::GetCurrentContext();
+  Local<Function> constructor_template = nodegitContext->GetFromPersistent("CommitGraphIndex::Template").As<Function>();
+  return scope.Escape(Nan::NewInstance(constructor_template, 1, argv).ToLocalChecked());
+}
+
+const CommitsGraph *CommitGraphIndex::GetValue() const {
+  return this->graph.get();
+}
+
+void CommitGraphIndex::Reference() {
+  Ref();
+}
+
+void CommitGraphIndex::Unreference() {
+  Unref();
+}
+
+NAN_METHOD(CommitGraphIndex::Count) {
+  const CommitsGraph *graph = Nan::ObjectWrap::Unwrap<CommitGraphIndex>(info.This())->GetValue();
+  info.GetReturnValue().Set(Nan::New<Number>(graph->GetNumCommits()));
+}
+
+NAN_METHOD(CommitGraphIndex::MaxGeneration) {
+  const CommitsGraph *graph = Nan::ObjectWrap::Unwrap<CommitGraphIndex>(info.This())->GetValue();
+  info.GetReturnValue().Set(Nan::New<Number>(graph->GetMaxDepth()));
+}
+
+// Returns the generation number of a commit (1 for root commits),
+// or 0 if the commit was not reachable when the index was built.
+NAN_METHOD(CommitGraphIndex::Generation) {
+  if (info.Length() == 0 || (!info[0]->IsObject() && !info[0]->IsString())) {
+    return Nan::ThrowError("Oid id is required.");
+  }
+
+  std::string rawOid;
+  if (!rawOidFromJavascript(info[0], &rawOid)) {
+    if (git_error_last()) {
+      return Nan::ThrowError(git_error_last()->message);
+    } else {
+      return Nan::ThrowError("Unknown Error");
+    }
+  }
+
+  const CommitsGraph *graph = Nan::ObjectWrap::Unwrap<CommitGraphIndex>(info.This())->GetValue();
+  const uint32_t generation = graph->GetGeneration(rawOid);
+
+  info.GetReturnValue().Set(Nan::New<Number>(generation));
+}
+
+// isAncestorBatch(ancestors, descendants, callback)
+// Resolves to a Uint8Array telling, for each pair, if the first commit is the second one or one
+// of its ancestors (1), or not (0, also for commits not reachable when the index was built).
+// descendants can be a single commit, to check all the ancestors against it.
+NAN_METHOD(CommitGraphIndex::IsAncestorBatch) {
+  queueQuery(info, Query::kIsAncestor);
+}
+
+// mergeBaseBatch(ones, twos, callback)
+// Resolves to a Buffer with the raw oid of a best common ancestor of each pair, as
+// Revwalk#fastWalkPacked, or zeros if they have none or are not in the index.
+// twos can be a single commit, to pair it with all the others.
+NAN_METHOD(CommitGraphIndex::MergeBaseBatch) {
+  queueQuery(info, Query::kMergeBase);
+}
+
+void CommitGraphIndex::queueQuery(const Nan::FunctionCallbackInfo<v8::Value> &info, Query query) {
+  if (info.Length() < 3) {
+    return Nan::ThrowError("Two Arrays of commits are required.");
+  }
+
+  if (!info[info.Length() - 1]->IsFunction()) {
+    return Nan::ThrowError("Callback is required and must be a Function.");
+  }
+
+  QueryBaton *baton = new QueryBaton();
+  baton->query = query;
+  baton->graph = Nan::ObjectWrap::Unwrap<CommitGraphIndex>(info.This())->GetValue();
+  if (
+    !info[0]->IsArray()
+    || !rawOidsFromJavascript(info[0], &baton->firstOids)
+    || !rawOidsFromJavascript(info[1], &baton->secondOids)
+  ) {
+    delete baton;
+    return Nan::ThrowError("Commits must be Oids or shas.");
+  }
+  if (baton->secondOids.size() != 1 && baton->secondOids.size() != baton->firstOids.size()) {
+    delete baton;
+    return Nan::ThrowError("Commits must be paired with a single commit or with as many commits.");
+  }
+
+  Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[info.Length() - 1]));
+  QueryWorker *worker = new QueryWorker(baton, callback);
+
+  worker->Reference<CommitGraphIndex>("commitGraphIndex", info.This());
+
+  nodegit::Context *nodegitContext = reinterpret_cast<nodegit::Context *>(info.Data().As<External>()->Value());
+  nodegitContext->QueueWorker(worker);
+}
+
+nodegit::LockMaster CommitGraphIndex::QueryWorker::AcquireLocks() {
+  return nodegit::LockMaster(true);
+}
+
+void CommitGraphIndex::QueryWorker::Execute() {
+  const CommitsGraph *graph = baton->graph;
+  const size_t numQueries = baton->firstOids.size();
+  const std::vector<std::string> &firstOids = baton->firstOids;
+  const std::vector<std::string> &secondOids = baton->secondOids;
+
+  // resolved once, as most queries share the second commit when it's a single one
+  const CommitsGraphNode *singleSecond = secondOids.size() == 1 ? graph->GetNode(secondOids.front()) : nullptr;
+  auto getNodes = [&](size_t i, const CommitsGraphNode **first, const CommitsGraphNode **second) {
+    *first = graph->GetNode(firstOids[i]);
+    *second = secondOids.size() == 1 ? singleSecond : graph->GetNode(secondOids[i]);
+    return *first != nullptr && *second != nullptr && (*first)->added && (*second)->added;
+  };
+
+  bool ok {false};
+  if (baton->query == Query::kIsAncestor) {
+    baton->isAncestor.assign(numQueries, 0);
+    uint8_t *results = baton->isAncestor.data();
+    ok = runQueries(numQueries, [&](size_t i) {
+      const CommitsGraphNode *ancestor, *descendant;
+      if (getNodes(i, &ancestor, &descendant)) {
+        results[i] = CommitsGraph::IsAncestor(ancestor, descendant) ? 1 : 0;
+      }
+    });
+  }
+  else {
+    baton->mergeBases.assign(numQueries * GIT_OID_RAWSZ, '\0');
+    char *results = &baton->mergeBases[0];
+    ok = runQueries(numQueries, [&](size_t i) {
+      const CommitsGraphNode *one, *two, *mergeBase;
+      if (getNodes(i, &one, &two) && (mergeBase = CommitsGraph::MergeBase(one, two)) != nullptr) {
+        memcpy(results + i * GIT_OID_RAWSZ, mergeBase->oid->data(), GIT_OID_RAWSZ);
+      }
+    });
+  }
+
+  if (!ok) {
+    SetErrorMessage("Could not run the queries on the commit graph index.");
+  }
+}
+
+void CommitGraphIndex::QueryWorker::HandleErrorCallback() {
+  if (!GetIsCancelled()) {
+    Local<v8::Value> argv[1] = {
+      Nan::Error(ErrorMessage())
+    };
+    callback->Call(1, argv, async_resource);
+  }
+
+  delete baton;
+}
+
+void CommitGraphIndex::QueryWorker::HandleOKCallback() {
+  Local<v8::Value> result;
+  if (baton->query == Query::kIsAncestor) {
+    result = nodegit::typedArrayFromVector<v8::Uint8Array>(baton->isAncestor);
+  }
+  else {
+    result = Nan::CopyBuffer(baton->mergeBases.data(), baton->mergeBases.size()).ToLocalChecked();
+  }
+
+  delete baton;
+
+  Local<v8::Value> argv[2] = {
+    Nan::Null(),
+    result
+  };
+  callback->Call(2, argv, async_resource);
+}
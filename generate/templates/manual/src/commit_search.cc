@@ -0,0 +1,195 @@
+#include "../include/commit_search.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+  // std::regex_search takes time quadratic in the length of the text at worst, so only the
+  // beginning of long fields is searched
+  const size_t kMaxRegexSearchLength = 8192;
+  // the backtracking executor of libstdc++ recurses once or more per character: keep well
+  // within the stack of worker threads
+  const size_t kMaxBacktrackingSearchLength = 1024;
+
+  bool startsWith(const char *begin, const char *end, const char *prefix, size_t prefixLength) {
+    return static_cast<size_t>(end - begin) >= prefixLength && memcmp(begin, prefix, prefixLength) == 0;
+  }
+
+  // end of "Name <email>" in the ident of an author or committer line
+  const char *identEnd(const char *begin, const char *end) {
+    for (const char *p = end; p > begin; --p) {
+      if (p[-1] == '>') {
+        return p;
+      }
+    }
+    return end;
+  }
+}
+
+/**
+ * CommitSearch::SetPattern
+ */
+bool CommitSearch::SetPattern(Field field, const std::string &pattern, bool isRegex, bool ignoreCase, std::string *error)
+{
+  Pattern &fieldPattern = m_patterns[static_cast<int>(field)];
+  fieldPattern.active = true;
+  fieldPattern.ignoreCase = ignoreCase;
+  fieldPattern.regex.reset();
+  fieldPattern.text = pattern;
+
+  if (isRegex) {
+    std::regex::flag_type flags = std::regex::ECMAScript;
+    if (ignoreCase) {
+      flags |= std::regex::icase;
+    }
+    fieldPattern.maxSearchLength = kMaxBacktrackingSearchLength;
+    try {
+#ifdef __GLIBCXX__
+      // the breadth-first executor of libstdc++ doesn't recurse per character, but can't match
+      // back-references
+      try {
+        fieldPattern.regex = std::make_unique<std::regex>(pattern, flags | std::regex_constants::__polynomial);
+        fieldPattern.maxSearchLength = kMaxRegexSearchLength;
+      }
+      catch (const std::regex_error &regexError) {
+        if (regexError.code() != std::regex_constants::error_complexity) {
+          throw;
+        }
+      }
+#endif
+      if (!fieldPattern.regex) {
+        fieldPattern.regex = std::make_unique<std::regex>(pattern, flags);
+      }
+    }
+    catch (const std::regex_error &regexError) {
+      *error = regexError.what();
+      fieldPattern.active = false;
+      return false;
+    }
+  }
+  else if (ignoreCase) {
+    std::transform(fieldPattern.text.begin(), fieldPattern.text.end(), fieldPattern.text.begin(),
+      [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  }
+
+  return true;
+}
+
+/**
+ * CommitSearch::Find
+ * memchr (vectorized by the C library) skips to the candidates for the first byte,
+ * so that most of the haystack is never compared byte by byte.
+ */
+const char *CommitSearch::Find(const char *haystack, size_t haystackLength, const std::string &needle)
+{
+  if (needle.empty()) {
+    return haystack;
+  }
+  if (needle.size() > haystackLength) {
+    return nullptr;
+  }
+
+  const char *last = haystack + haystackLength - needle.size();
+  const char *p = haystack;
+  while (p <= last) {
+    p = static_cast<const char *>(memchr(p, needle[0], last - p + 1));
+    if (p == nullptr) {
+      return nullptr;
+    }
+    if (memcmp(p + 1, needle.data() + 1, needle.size() - 1) == 0) {
+      return p;
+    }
+    ++p;
+  }
+  return nullptr;
+}
+
+/**
+ * CommitSearch::patternMatches
+ */
+bool CommitSearch::patternMatches(const Pattern &pattern, const char *begin, const char *end)
+{
+  if (pattern.regex) {
+    if (static_cast<size_t>(end - begin) > pattern.maxSearchLength) {
+      end = begin + pattern.maxSearchLength;
+    }
+    try {
+      return std::regex_search(begin, end, *pattern.regex);
+    }
+    catch (const std::regex_error &) {
+      // error_complexity or error_stack: too costly to match
+      return false;
+    }
+  }
+
+  if (!pattern.ignoreCase) {
+    return Find(begin, end - begin, pattern.text) != nullptr;
+  }
+
+  m_lowerCaseBuffer.assign(begin, end);
+  std::transform(m_lowerCaseBuffer.begin(), m_lowerCaseBuffer.end(), m_lowerCaseBuffer.begin(),
+    [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return Find(m_lowerCaseBuffer.data(), m_lowerCaseBuffer.size(), pattern.text) != nullptr;
+}
+
+/**
+ * CommitSearch::Matches
+ * The raw commit has header lines ("tree", "parent", "author", "committer"...; continuation
+ * lines of multi-line headers start with a space), then an empty line and the message.
+ */
+bool CommitSearch::Matches(const char *data, size_t length)
+{
+  const char *end = data + length;
+  const char *author = nullptr, *authorEnd = nullptr;
+  const char *committer = nullptr, *committerEnd = nullptr;
+  int64_t commitTime {0};
+  unsigned int numParents {0};
+
+  const char *line = data;
+  while (line < end && *line != '\n') {
+    const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+
+    if (startsWith(line, lineEnd, "parent ", 7)) {
+      ++numParents;
+    }
+    else if (startsWith(line, lineEnd, "author ", 7)) {
+      author = line + 7;
+      authorEnd = identEnd(author, lineEnd);
+    }
+    else if (startsWith(line, lineEnd, "committer ", 10)) {
+      committer = line + 10;
+      committerEnd = identEnd(committer, lineEnd);
+      commitTime = strtoll(std::string(committerEnd, lineEnd).c_str(), nullptr, 10);
+    }
+
+    line = lineEnd + 1;
+  }
+  const char *message = line < end ? line + 1 : end;
+
+  if (
+    (m_merges == Merges::kOnly && numParents < 2)
+    || (m_merges == Merges::kNone && numParents > 1)
+    || (m_hasSince && commitTime < m_since)
+    || (m_hasUntil && commitTime > m_until)
+  ) {
+    return false;
+  }
+
+  const Pattern &authorPattern = m_patterns[static_cast<int>(Field::kAuthor)];
+  if (authorPattern.active && (author == nullptr || !patternMatches(authorPattern, author, authorEnd))) {
+    return false;
+  }
+
+  const Pattern &committerPattern = m_patterns[static_cast<int>(Field::kCommitter)];
+  if (committerPattern.active && (committer == nullptr || !patternMatches(committerPattern, committer, committerEnd))) {
+    return false;
+  }
+
+  const Pattern &messagePattern = m_patterns[static_cast<int>(Field::kMessage)];
+  return !messagePattern.active || patternMatches(messagePattern, std::min(message, end), end);
+}
@@ -0,0 +1,247 @@
+#include "../include/commits_graph.h"
+
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * CommitsGraph::AddNode
+ * 
+ * \param oidStr oid of the commit object to add.
+ * \param parents oids of the commit's parents.
+ */
+void CommitsGraph::AddNode(const std::string &oidStr, const std::vector<std::string> &parents)
+{
+  const uint32_t numParents = static_cast<uint32_t>(parents.size());
+
+  auto emplacePair = m_mapOidNode.emplace(std::make_pair(
+    oidStr, std::make_unique<CommitsGraphNode>(numParents)));
+
+  CommitsGraphMap::iterator itNode = emplacePair.first;
+  itNode->second->oid = &itNode->first;
+
+  // if this node already added by a child, update its parentsLeft
+  if (emplacePair.second == false) {
+    itNode->second.get()->parentsLeft = numParents;
+  }
+  itNode->second->added = true;
+  ++m_numCommits;
+
+  // set roots
+  if (numParents == 0) {
+    m_roots.emplace_back(itNode->second.get());
+  }
+
+  // add parents
+  itNode->second->parents.reserve(numParents);
+  for (unsigned int i = 0; i < numParents; ++i) {
+    itNode->second->parents.emplace_back(addParentNode(parents.at(i), itNode->second.get()));
+  }
+}
+
+/**
+ * CommitsGraph::CalculateMaxDepth
+ * \param orderedOids if not null, filled out with the oids of the commits level by level,
+ * starting at the roots, so that a commit is always placed after all of its parents.
+ * \return Calculated maximum depth of the tree.
+ * 
+ * Also sets the generation number of each commit, which is the level it is found at.
+ * Parents which were never added (missing from the repository, as in shallow clones)
+ * are ignored, so that their children are processed as if they had no such parent.
+ * NOTE: to be called once, after adding all the commits, since it consumes parentsLeft.
+ * 
+ * Uses iterative algorithm to count levels.
+ * Considers multiple initial commits.
+ * Considers that children of one level can have multiple parents, hence we insert unique children
+ * at each level.
+ * Considers that same child can be in different levels. Here to prevent counting the same child
+ * multiple times, we only add a child when the last parent (parentsLeft) inserts it. This is
+ * actually what makes the algorithm fast.
+ * Recursive algorithm avoided to prevent stack overflow in case of excessive levels in the tree.
+ * 
+ * Explanation of the algorithm:
+ * once the graph is built with the commit history, `CalculateMaxDepth()` counts the maximum number
+ * of levels from any of the roots to any of the leaves, which gives us the maximum depth
+ * (`historyStructure.maxDepth` in the final result).
+ * Inside `CalculateMaxDepth()`, to count levels, we add in an iterative way for each level and
+ * starting at the roots level, all the children from that level, but only if each child is the last
+ * time we'll consider it in the algorithm (for example if a child node 'C' has 2 parents 'P1' and
+ * 'P2', and 'P1' has already been considered before in the algorithm as parent of 'C', and now we are
+ * processing 'C' as a child from 'P2', which will be the last time, as 'C' has no more parents left).
+ * This way we prevent counting 'C' multiple times.
+ */
+uint32_t CommitsGraph::CalculateMaxDepth(std::vector<const std::string *> *orderedOids)
+{
+  uint32_t maxDepth {0};
+  std::unordered_set<CommitsGraphNode *> parents {};
+  std::unordered_set<CommitsGraphNode *> children {};
+
+  // start from the root commmits
+  for (CommitsGraphNode *root : m_roots) {
+    children.insert(root);
+  }
+
+  // and from commits whose parents are all missing
+  for (auto &oidNode : m_mapOidNode) {
+    if (!oidNode.second->added) {
+      for (CommitsGraphNode *child : oidNode.second->children) {
+        if (--child->parentsLeft == 0) {
+          children.insert(child);
+        }
+      }
+    }
+  }
+
+  while (!children.empty()) {
+    ++maxDepth;
+    parents = std::move(children);
+
+    for (CommitsGraphNode *parent : parents) {
+      parent->generation = maxDepth;
+    }
+
+    if (orderedOids != nullptr) {
+      for (CommitsGraphNode *parent : parents) {
+        orderedOids->emplace_back(parent->oid);
+      }
+    }
+
+    // add unique children of next level, and only if from the last parent
+    for (CommitsGraphNode *parent : parents) {
+      for (CommitsGraphNode *child : parent->children) {
+        if (--child->parentsLeft == 0) {
+          children.insert(child);
+        }
+      }
+    }
+  }
+
+  m_maxDepth = maxDepth;
+
+  return maxDepth;
+}
+
+/**
+ * CommitsGraph::GetGeneration
+ * \param oidStr raw oid of the commit.
+ * \return generation number of the commit, or kUnknownGeneration if it's not in the graph.
+ */
+uint32_t CommitsGraph::GetGeneration(const std::string &oidStr) const
+{
+  CommitsGraphMap::const_iterator itNode = m_mapOidNode.find(oidStr);
+  if (itNode == m_mapOidNode.end()) {
+    return kUnknownGeneration;
+  }
+
+  return itNode->second->generation;
+}
+
+/**
+ * CommitsGraph::GetNode
+ * \param oidStr raw oid of the commit.
+ */
+const CommitsGraphNode *CommitsGraph::GetNode(const std::string &oidStr) const
+{
+  CommitsGraphMap::const_iterator itNode = m_mapOidNode.find(oidStr);
+  if (itNode == m_mapOidNode.end()) {
+    return nullptr;
+  }
+
+  return itNode->second.get();
+}
+
+/**
+ * CommitsGraph::IsAncestor
+ * Walks the ancestors of descendant, skipping those whose generation is not higher than
+ * the one of ancestor: they can't reach it.
+ */
+bool CommitsGraph::IsAncestor(const CommitsGraphNode *ancestor, const CommitsGraphNode *descendant)
+{
+  if (ancestor == descendant) {
+    return true;
+  }
+  if (ancestor->generation == kUnknownGeneration || descendant->generation <= ancestor->generation) {
+    return false;
+  }
+
+  std::unordered_set<const CommitsGraphNode *> seen {descendant};
+  std::vector<const CommitsGraphNode *> pending {descendant};
+  while (!pending.empty()) {
+    const CommitsGraphNode *node = pending.back();
+    pending.pop_back();
+
+    for (const CommitsGraphNode *parent : node->parents) {
+      if (parent == ancestor) {
+        return true;
+      }
+      if (parent->generation > ancestor->generation && seen.insert(parent).second) {
+        pending.push_back(parent);
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * CommitsGraph::MergeBase
+ * Marks the ancestors of each commit, highest generation first, so that every commit is
+ * visited after all its children. The first commit reached from both is a best common
+ * ancestor, and the walk ends there.
+ */
+const CommitsGraphNode *CommitsGraph::MergeBase(const CommitsGraphNode *one, const CommitsGraphNode *two)
+{
+  if (one == two) {
+    return one;
+  }
+
+  const uint8_t kFromOne = 1;
+  const uint8_t kFromTwo = 2;
+  const uint8_t kQueued = 4;
+
+  std::unordered_map<const CommitsGraphNode *, uint8_t> flags {};
+  std::priority_queue<std::pair<uint32_t, const CommitsGraphNode *>> queue {};
+
+  auto mark = [&](const CommitsGraphNode *node, uint8_t newFlags) {
+    uint8_t &nodeFlags = flags[node];
+    if (!(nodeFlags & kQueued)) {
+      queue.emplace(node->generation, node);
+    }
+    nodeFlags |= newFlags | kQueued;
+  };
+
+  mark(one, kFromOne);
+  mark(two, kFromTwo);
+  while (!queue.empty()) {
+    const CommitsGraphNode *node = queue.top().second;
+    queue.pop();
+
+    const uint8_t nodeFlags = flags[node] & (kFromOne | kFromTwo);
+    if (nodeFlags == (kFromOne | kFromTwo)) {
+      return node;
+    }
+    for (const CommitsGraphNode *parent : node->parents) {
+      mark(parent, nodeFlags);
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * CommitsGraph::addParentNode
+ * 
+ * \param oidParentStr oid of the parent commit to add.
+ * \param child Child of the parent commit being added.
+ * \return the node of the parent.
+ */
+CommitsGraphNode *CommitsGraph::addParentNode(const std::string &oidParentStr, CommitsGraphNode *child)
+{
+  CommitsGraphMap::iterator itParentNode = m_mapOidNode.emplace(std::make_pair(
+    oidParentStr, std::make_unique<CommitsGraphNode>())).first;
+  itParentNode->second->oid = &itParentNode->first;
+
+  // add child to parent
+  itParentNode->second->children.emplace_back(child);
+  return itParentNode->second.get();
+}
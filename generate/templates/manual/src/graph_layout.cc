@@ -0,0 +1,185 @@
+#include "../include/graph_layout.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  const uint32_t kStateVersion = 1;
+  const size_t kStateHeaderSize = 4 * 4;
+  const size_t kStateLaneSize = 1 + GIT_OID_RAWSZ;
+  const uint8_t kLaneActive = 1;
+  const uint8_t kLanePassThrough = 2;
+  const uint8_t kLaneFromCommit = 4;
+
+  void writeUint32LE(std::string *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+  }
+
+  uint32_t readUint32LE(const unsigned char *data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+      (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+  }
+}
+
+/**
+ * GraphLayout::LoadState
+ * State layout, little-endian: version, next row, lane of the previous commit, number of lanes,
+ * then for each lane a flags byte and the raw oid it waits for.
+ */
+bool GraphLayout::LoadState(const char *data, size_t length)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+  if (length < kStateHeaderSize || readUint32LE(bytes) != kStateVersion) {
+    return false;
+  }
+
+  const uint32_t nextRow = readUint32LE(bytes + 4);
+  const uint32_t previousCommitLane = readUint32LE(bytes + 8);
+  const uint32_t numLanes = readUint32LE(bytes + 12);
+  if (length != kStateHeaderSize + static_cast<size_t>(numLanes) * kStateLaneSize) {
+    return false;
+  }
+
+  m_lanes.assign(numLanes, Lane());
+  for (uint32_t i = 0; i < numLanes; ++i) {
+    const unsigned char *laneData = bytes + kStateHeaderSize + i * kStateLaneSize;
+    m_lanes[i].active = (laneData[0] & kLaneActive) != 0;
+    m_lanes[i].passThrough = (laneData[0] & kLanePassThrough) != 0;
+    m_lanes[i].fromCommit = (laneData[0] & kLaneFromCommit) != 0;
+    memcpy(m_lanes[i].expected.id, laneData + 1, GIT_OID_RAWSZ);
+  }
+  m_nextRow = m_firstRow = nextRow;
+  m_previousCommitLane = previousCommitLane;
+  return true;
+}
+
+/**
+ * GraphLayout::SaveState
+ */
+std::string GraphLayout::SaveState() const
+{
+  std::string state {};
+  state.reserve(kStateHeaderSize + m_lanes.size() * kStateLaneSize);
+  writeUint32LE(&state, kStateVersion);
+  writeUint32LE(&state, m_nextRow);
+  writeUint32LE(&state, m_previousCommitLane);
+  writeUint32LE(&state, static_cast<uint32_t>(m_lanes.size()));
+  for (const Lane &lane : m_lanes) {
+    state.push_back(static_cast<char>((lane.active ? kLaneActive : 0) |
+      (lane.passThrough ? kLanePassThrough : 0) | (lane.fromCommit ? kLaneFromCommit : 0)));
+    state.append(reinterpret_cast<const char *>(lane.expected.id), GIT_OID_RAWSZ);
+  }
+  return state;
+}
+
+/**
+ * GraphLayout::freeLane
+ */
+uint32_t GraphLayout::freeLane(uint32_t excludedLane)
+{
+  for (uint32_t i = 0; i < m_lanes.size(); ++i) {
+    if (!m_lanes[i].active && i != excludedLane) {
+      return i;
+    }
+  }
+  m_lanes.emplace_back();
+  return static_cast<uint32_t>(m_lanes.size() - 1);
+}
+
+/**
+ * GraphLayout::AddCommit
+ * Commits must be added children first.
+ */
+void GraphLayout::AddCommit(const git_oid &oid, const std::vector<git_oid> &parents)
+{
+  const uint32_t row = m_nextRow++;
+  const uint32_t kNoLane = UINT32_MAX;
+  uint8_t markers {0};
+
+  // the lanes waiting for this commit join it
+  uint32_t commitLane {kNoLane};
+  uint32_t numJoiningLanes {0};
+  for (uint32_t i = 0; i < m_lanes.size(); ++i) {
+    if (m_lanes[i].active && git_oid_equal(&m_lanes[i].expected, &oid)) {
+      if (commitLane == kNoLane) {
+        commitLane = i;
+      }
+      ++numJoiningLanes;
+    }
+  }
+  if (commitLane == kNoLane) {
+    markers |= kTip;
+    commitLane = freeLane(kNoLane);
+  }
+  if (numJoiningLanes > 1) {
+    markers |= kFork;
+  }
+
+  // segments from the previous row to this one
+  for (uint32_t i = 0; i < m_lanes.size(); ++i) {
+    Lane &lane = m_lanes[i];
+    if (!lane.active) {
+      continue;
+    }
+    const uint32_t toLane = git_oid_equal(&lane.expected, &oid) ? commitLane : i;
+    if (lane.passThrough) {
+      m_edges.insert(m_edges.end(), { row - 1, i, toLane });
+    }
+    if (lane.fromCommit) {
+      m_edges.insert(m_edges.end(), { row - 1, m_previousCommitLane, toLane });
+    }
+    if (toLane == commitLane) {
+      lane.active = false;
+    }
+  }
+
+  // segments from this row to the next one
+  for (Lane &lane : m_lanes) {
+    lane.passThrough = lane.active;
+    lane.fromCommit = false;
+  }
+  if (parents.empty()) {
+    markers |= kRoot;
+  }
+  else {
+    Lane &lane = m_lanes[commitLane];
+    lane.expected = parents[0];
+    lane.active = true;
+    lane.passThrough = false;
+    lane.fromCommit = true;
+
+    for (size_t parentIndex = 1; parentIndex < parents.size(); ++parentIndex) {
+      const git_oid &parent = parents[parentIndex];
+      uint32_t parentLane {kNoLane};
+      for (uint32_t i = 0; i < m_lanes.size(); ++i) {
+        if (m_lanes[i].active && git_oid_equal(&m_lanes[i].expected, &parent)) {
+          parentLane = i;
+          break;
+        }
+      }
+      if (parentLane == kNoLane) {
+        parentLane = freeLane(commitLane);
+        m_lanes[parentLane].expected = parent;
+        m_lanes[parentLane].active = true;
+        m_lanes[parentLane].passThrough = false;
+      }
+      m_lanes[parentLane].fromCommit = true;
+    }
+
+    if (parents.size() > 1) {
+      markers |= kMerge;
+    }
+  }
+
+  m_numLanes = std::max(m_numLanes, static_cast<uint32_t>(std::max<size_t>(m_lanes.size(), commitLane + 1)));
+  while (!m_lanes.empty() && !m_lanes.back().active) {
+    m_lanes.pop_back();
+  }
+  m_previousCommitLane = commitLane;
+
+  m_oids.append(reinterpret_cast<const char *>(oid.id), GIT_OID_RAWSZ);
+  m_rowLanes.push_back(commitLane);
+  m_markers.push_back(markers);
+}
@@ -0,0 +1,85 @@
+#include "../include/mapped_file.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+int MappedFile::Map(const std::string &path) {
+  std::wstring widePath(MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], static_cast<int>(widePath.size()));
+  HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    const DWORD error = GetLastError();
+    return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? GIT_ENOTFOUND : -1;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return -1;
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return GIT_OK;
+  }
+
+  m_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (m_mapping == NULL) {
+    return -1;
+  }
+  m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_data == nullptr) {
+    CloseHandle(m_mapping);
+    m_mapping = NULL;
+    return -1;
+  }
+  m_length = static_cast<size_t>(size.QuadPart);
+  return GIT_OK;
+}
+
+void MappedFile::unmap() {
+  if (m_data != nullptr) {
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+  }
+}
+#else
+int MappedFile::Map(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return errno == ENOENT || errno == ENOTDIR ? GIT_ENOTFOUND : -1;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return -1;
+  }
+  if (fileStat.st_size == 0) {
+    close(fd);
+    return GIT_OK;
+  }
+
+  void *data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return -1;
+  }
+  m_data = static_cast<const char *>(data);
+  m_length = static_cast<size_t>(fileStat.st_size);
+  return GIT_OK;
+}
+
+void MappedFile::unmap() {
+  if (m_data != nullptr) {
+    munmap(const_cast<char *>(m_data), m_length);
+  }
+}
+#endif
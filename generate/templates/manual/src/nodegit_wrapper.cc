@@ -48,6 +48,8 @@ NodeGitWrapper<Traits>::NodeGitWrapper(const char *error)
 template<typename Traits>
 NodeGitWrapper<Traits>::~NodeGitWrapper() {
   Unlink();
+  // they may hold objects owned by raw
+  namedCleanupHandles.clear();
   if (Traits::isFreeable && selfFreeing) {
     Traits::free(raw);
     SelfFreeingInstanceCount--;
@@ -184,3 +186,14 @@ template<typename Traits>
 void NodeGitWrapper<Traits>::SaveCleanupHandle(std::shared_ptr<nodegit::CleanupHandle> cleanupHandle) {
   childCleanupVector.push_back(cleanupHandle);
 }
+
+template<typename Traits>
+void NodeGitWrapper<Traits>::SaveCleanupHandle(std::string key, std::shared_ptr<nodegit::CleanupHandle> cleanupHandle) {
+  namedCleanupHandles[key] = cleanupHandle;
+}
+
+template<typename Traits>
+std::shared_ptr<nodegit::CleanupHandle> NodeGitWrapper<Traits>::GetCleanupHandle(std::string key) {
+  auto cleanupHandle = namedCleanupHandles.find(key);
+  return cleanupHandle != namedCleanupHandles.end() ? cleanupHandle->second : nullptr;
+}
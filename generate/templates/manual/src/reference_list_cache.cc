@@ -0,0 +1,80 @@
+#include "../include/reference_list_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <uv.h>
+
+#include "../include/functions/copy.h"
+#include "../include/functions/free.h"
+
+ReferenceListCache::Entry::~Entry() {
+  for (git_remote_head *head : heads) {
+    git_remote_head_free(head);
+  }
+}
+
+bool ReferenceListCache::Get(std::vector<git_remote_head *> *out, const std::string &url,
+  const std::vector<std::string> &prefixes, uint64_t ttl)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto entry = m_entries.find(key(url, prefixes));
+  if (entry == m_entries.end() || uv_hrtime() - entry->second->listedAt >= ttl * 1000000) {
+    return false;
+  }
+
+  out->reserve(entry->second->heads.size());
+  for (const git_remote_head *head : entry->second->heads) {
+    out->push_back(git_remote_head_dup(head));
+  }
+  return true;
+}
+
+void ReferenceListCache::Set(const std::string &url, const std::vector<std::string> &prefixes,
+  const std::vector<git_remote_head *> &heads)
+{
+  std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+  entry->heads.reserve(heads.size());
+  for (const git_remote_head *head : heads) {
+    entry->heads.push_back(git_remote_head_dup(head));
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  entry->listedAt = uv_hrtime();
+  m_entries[key(url, prefixes)] = std::move(entry);
+
+  if (m_entries.size() > kMaxEntries) {
+    auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+      [](const std::pair<const std::string, std::unique_ptr<Entry>> &a,
+        const std::pair<const std::string, std::unique_ptr<Entry>> &b) {
+        return a.second->listedAt < b.second->listedAt;
+      });
+    m_entries.erase(oldest);
+  }
+}
+
+bool ReferenceListCache::MatchesPrefixes(const char *name, const std::vector<std::string> &prefixes) {
+  if (prefixes.empty()) {
+    return true;
+  }
+
+  for (const std::string &prefix : prefixes) {
+    if (strncmp(name, prefix.c_str(), prefix.size()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// the same prefixes in another order are the same listing
+std::string ReferenceListCache::key(const std::string &url, const std::vector<std::string> &prefixes) {
+  std::vector<std::string> sortedPrefixes(prefixes);
+  std::sort(sortedPrefixes.begin(), sortedPrefixes.end());
+
+  std::string result(url);
+  for (const std::string &prefix : sortedPrefixes) {
+    result.push_back('\0');
+    result.append(prefix);
+  }
+  return result;
+}
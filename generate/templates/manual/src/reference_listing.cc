@@ -0,0 +1,279 @@
+#include "../include/reference_listing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <uv.h>
+
+#include "../include/mapped_file.h"
+
+namespace {
+  const char kPackedRefsHeader[] = "# pack-refs with:";
+  const char kSymbolicReferencePrefix[] = "ref: ";
+  const char kLockFileSuffix[] = ".lock";
+  const size_t kRecordNameOffset = GIT_OID_HEXSZ + 1;
+  const char *kPerWorktreePrefixes[] = { "refs/bisect/", "refs/rewritten/", "refs/worktree/" };
+
+  bool startsWith(const std::string &value, const char *prefix, size_t prefixLength) {
+    return value.size() >= prefixLength && value.compare(0, prefixLength, prefix) == 0;
+  }
+
+  bool isPerWorktreeReference(const std::string &name) {
+    for (const char *prefix : kPerWorktreePrefixes) {
+      if (startsWith(name, prefix, strlen(prefix))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // end of the line starting at line, before its '\n'
+  const char *lineEnd(const char *line, const char *end) {
+    const char *newline = static_cast<const char *>(memchr(line, '\n', end - line));
+    return newline != nullptr ? newline : end;
+  }
+
+  const char *nextLine(const char *line, const char *end) {
+    const char *newline = lineEnd(line, end);
+    return newline < end ? newline + 1 : end;
+  }
+
+  // next record of packed-refs, skipping the "^<oid>" line of a peeled tag
+  const char *nextRecord(const char *record, const char *end) {
+    const char *line = nextLine(record, end);
+    while (line < end && *line == '^') {
+      line = nextLine(line, end);
+    }
+    return line;
+  }
+
+  // start of the record of packed-refs containing position, which is not past its end
+  const char *recordStart(const char *begin, const char *position) {
+    const char *line = position;
+    while (line > begin && line[-1] != '\n') {
+      --line;
+    }
+    if (*line == '^' && line > begin) {
+      --line;
+      while (line > begin && line[-1] != '\n') {
+        --line;
+      }
+    }
+    return line;
+  }
+
+  // < 0 if the name of the record sorts before all the names starting with prefix
+  int compareRecordToPrefix(const char *record, const char *end, const std::string &prefix) {
+    const char *recordEnd = lineEnd(record, end);
+    const char *name = std::min(record + kRecordNameOffset, recordEnd);
+    const size_t nameLength = recordEnd - name;
+    const int cmp = memcmp(name, prefix.data(), std::min(nameLength, prefix.size()));
+    if (cmp != 0) {
+      return cmp;
+    }
+    return nameLength < prefix.size() ? -1 : 0;
+  }
+
+  // first record of sorted packed-refs whose name doesn't sort before the ones starting with prefix
+  const char *lowerBound(const char *low, const char *high, const std::string &prefix) {
+    while (low < high) {
+      const char *middle = recordStart(low, low + (high - low) / 2);
+      if (compareRecordToPrefix(middle, high, prefix) < 0) {
+        low = nextRecord(middle, high);
+      } else {
+        high = middle;
+      }
+    }
+    return low;
+  }
+
+  // \return false if the loose reference file is not valid
+  bool readLooseReference(const std::string &path, ReferenceListing::Reference *reference) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::string content {};
+    if (!file || !std::getline(file, content)) {
+      return false;
+    }
+    while (!content.empty() && (content.back() == '\r' || content.back() == ' ')) {
+      content.pop_back();
+    }
+
+    const size_t symbolicPrefixLength = sizeof(kSymbolicReferencePrefix) - 1;
+    if (startsWith(content, kSymbolicReferencePrefix, symbolicPrefixLength)) {
+      reference->symbolicTarget = content.substr(symbolicPrefixLength);
+      return !reference->symbolicTarget.empty();
+    }
+    return content.size() >= GIT_OID_HEXSZ && git_oid_fromstrn(&reference->target, content.data(), GIT_OID_HEXSZ) == GIT_OK;
+  }
+
+  // the directory (relative to the git dir, ending with '/') may contain references starting with prefix
+  bool directoryMayMatch(const std::string &directory, const std::string &prefix) {
+    const size_t length = std::min(directory.size(), prefix.size());
+    return directory.compare(0, length, prefix, 0, length) == 0;
+  }
+}
+
+/**
+ * ReferenceListing::AddPackedReferences
+ * packed-refs has a "# pack-refs with: <traits>" header, then a "<oid> <name>" line for each
+ * reference, followed by a "^<oid>" line for annotated tags when it has the peeled trait.
+ * References already in the map (the loose ones) are kept.
+ */
+void ReferenceListing::AddPackedReferences(const char *data, size_t length, const std::string &prefix,
+  std::map<std::string, Reference> *references)
+{
+  const char *end = data + length;
+  const char *record = data;
+  const size_t headerLength = sizeof(kPackedRefsHeader) - 1;
+  bool sorted {false};
+  if (length >= headerLength && memcmp(data, kPackedRefsHeader, headerLength) == 0) {
+    std::string traits(data + headerLength, lineEnd(data, end));
+    traits.push_back(' ');
+    sorted = traits.find(" sorted ") != std::string::npos;
+    record = nextLine(data, end);
+  }
+
+  if (sorted) {
+    record = lowerBound(record, end, prefix);
+  }
+
+  for (; record < end; record = nextRecord(record, end)) {
+    const char *recordEnd = lineEnd(record, end);
+    if (
+      static_cast<size_t>(recordEnd - record) <= kRecordNameOffset
+      || record[GIT_OID_HEXSZ] != ' '
+    ) {
+      continue;
+    }
+
+    Reference reference;
+    reference.name.assign(record + kRecordNameOffset, recordEnd);
+    if (!startsWith(reference.name, prefix.data(), prefix.size())) {
+      if (sorted && compareRecordToPrefix(record, end, prefix) > 0) {
+        break;
+      }
+      continue;
+    }
+    if (git_oid_fromstrn(&reference.target, record, GIT_OID_HEXSZ) != GIT_OK) {
+      continue;
+    }
+
+    references->emplace(reference.name, reference);
+  }
+}
+
+/**
+ * ReferenceListing::addLooseReferences
+ * Scans directory (relative to gitDir, ending with '/') and the subdirectories that may
+ * contain references starting with prefix.
+ */
+int ReferenceListing::addLooseReferences(const std::string &gitDir, const std::string &directory,
+  const std::string &prefix, Scope scope, std::map<std::string, Reference> *references)
+{
+  const std::string path = gitDir + directory;
+  uv_fs_t request;
+  const int result = uv_fs_scandir(nullptr, &request, path.c_str(), 0, nullptr);
+  if (result < 0) {
+    uv_fs_req_cleanup(&request);
+    if (result == UV_ENOENT || result == UV_ENOTDIR) {
+      return GIT_OK;
+    }
+    git_error_set_str(GIT_ERROR_OS, ("could not list loose references in '" + path + "'").c_str());
+    return -1;
+  }
+
+  int error {GIT_OK};
+  uv_dirent_t entry;
+  while (error == GIT_OK && uv_fs_scandir_next(&request, &entry) != UV_EOF) {
+    std::string name = directory + entry.name;
+    bool isDirectory = entry.type == UV_DIRENT_DIR;
+    if (entry.type == UV_DIRENT_UNKNOWN) {
+      uv_fs_t statRequest;
+      isDirectory = uv_fs_stat(nullptr, &statRequest, (gitDir + name).c_str(), nullptr) == 0
+        && (statRequest.statbuf.st_mode & S_IFMT) == S_IFDIR;
+      uv_fs_req_cleanup(&statRequest);
+    }
+
+    if (isDirectory) {
+      name.push_back('/');
+      if (directoryMayMatch(name, prefix)) {
+        error = addLooseReferences(gitDir, name, prefix, scope, references);
+      }
+      continue;
+    }
+
+    const size_t lockSuffixLength = sizeof(kLockFileSuffix) - 1;
+    if (
+      !startsWith(name, prefix.data(), prefix.size())
+      || (name.size() >= lockSuffixLength && name.compare(name.size() - lockSuffixLength, lockSuffixLength, kLockFileSuffix) == 0)
+      || (scope == Scope::kShared && isPerWorktreeReference(name))
+      || (scope == Scope::kPerWorktree && !isPerWorktreeReference(name))
+    ) {
+      continue;
+    }
+
+    Reference reference;
+    reference.name = name;
+    // a file that isn't a reference is ignored, as corrupted references are by refreshReferences
+    if (readLooseReference(gitDir + name, &reference)) {
+      (*references)[name] = reference;
+    }
+  }
+
+  uv_fs_req_cleanup(&request);
+  return error;
+}
+
+/**
+ * ReferenceListing::List
+ * Loose references are read before packed-refs: git packs a reference before deleting its
+ * loose file, so a concurrent `git pack-refs` can't hide it.
+ */
+int ReferenceListing::List(git_repository *repo, const std::string &prefix, std::vector<Reference> *out)
+{
+  if (prefix.compare(0, 5, "refs/") != 0) {
+    git_error_set_str(GIT_ERROR_INVALID, "the prefix of references must start with 'refs/'");
+    return GIT_EINVALIDSPEC;
+  }
+
+  const std::string commonDir = git_repository_commondir(repo);
+  const std::string gitDir = git_repository_path(repo);
+  const std::string directory = prefix.substr(0, prefix.rfind('/') + 1);
+  std::map<std::string, Reference> references {};
+
+  int error {GIT_OK};
+  if (gitDir == commonDir) {
+    error = addLooseReferences(commonDir, directory, prefix, Scope::kAll, &references);
+  } else {
+    error = addLooseReferences(commonDir, directory, prefix, Scope::kShared, &references);
+    if (error == GIT_OK) {
+      error = addLooseReferences(gitDir, directory, prefix, Scope::kPerWorktree, &references);
+    }
+  }
+  if (error != GIT_OK) {
+    return error;
+  }
+
+  MappedFile packedRefs;
+  const int mapped = packedRefs.Map(commonDir + "packed-refs");
+  if (mapped == GIT_OK) {
+    AddPackedReferences(packedRefs.Data(), packedRefs.Length(), prefix, &references);
+  } else if (mapped != GIT_ENOTFOUND) {
+    git_error_set_str(GIT_ERROR_OS, ("could not map '" + commonDir + "packed-refs'").c_str());
+    return -1;
+  }
+
+  out->reserve(out->size() + references.size());
+  for (auto &reference : references) {
+    if (!reference.second.symbolicTarget.empty()) {
+      // symbolic references are few (refs/remotes/<remote>/HEAD): resolve them through libgit2
+      if (git_reference_name_to_id(&reference.second.target, repo, reference.first.c_str()) != GIT_OK) {
+        git_error_clear();
+        continue;
+      }
+    }
+    out->push_back(std::move(reference.second));
+  }
+  return GIT_OK;
+}
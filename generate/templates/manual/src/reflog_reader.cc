@@ -0,0 +1,168 @@
+#include "../include/reflog_reader.h"
+
+#include <cstring>
+
+#include "../include/mapped_file.h"
+
+namespace {
+  const char *kPerWorktreePrefixes[] = { "refs/bisect/", "refs/rewritten/", "refs/worktree/" };
+
+  // HEAD, the pseudo references and refs/bisect/... have their reflog in the git dir of the worktree
+  bool isPerWorktreeReference(const std::string &name) {
+    if (name.compare(0, 5, "refs/") != 0) {
+      return true;
+    }
+    for (const char *prefix : kPerWorktreePrefixes) {
+      if (name.compare(0, strlen(prefix), prefix) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  // [begin, end) without the surrounding whitespace
+  std::string trimmed(const char *begin, const char *end) {
+    while (begin < end && isSpace(*begin)) {
+      ++begin;
+    }
+    while (end > begin && isSpace(end[-1])) {
+      --end;
+    }
+    return std::string(begin, end);
+  }
+
+  const char *findLast(const char *begin, const char *end, char c) {
+    for (const char *position = end; position > begin; --position) {
+      if (position[-1] == c) {
+        return position - 1;
+      }
+    }
+    return nullptr;
+  }
+
+  bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+  }
+}
+
+/**
+ * ReflogReader::parseLine
+ * Parses the committer as libgit2 does: the email is between the last '<' and the last '>', and
+ * a missing or malformed date is read as 0.
+ */
+bool ReflogReader::parseLine(const char *line, const char *end, Entry *entry)
+{
+  const size_t oidsLength = 2 * (GIT_OID_HEXSZ + 1);
+  if (
+    static_cast<size_t>(end - line) < oidsLength
+    || line[GIT_OID_HEXSZ] != ' '
+    || line[2 * GIT_OID_HEXSZ + 1] != ' '
+    || git_oid_fromstrn(&entry->oldId, line, GIT_OID_HEXSZ) != GIT_OK
+    || git_oid_fromstrn(&entry->newId, line + GIT_OID_HEXSZ + 1, GIT_OID_HEXSZ) != GIT_OK
+  ) {
+    return false;
+  }
+
+  const char *committer = line + oidsLength;
+  const char *tab = static_cast<const char *>(memchr(committer, '\t', end - committer));
+  const char *committerEnd = tab != nullptr ? tab : end;
+  const char *emailStart = findLast(committer, committerEnd, '<');
+  const char *emailEnd = findLast(committer, committerEnd, '>');
+  if (emailStart == nullptr || emailEnd == nullptr || emailEnd < emailStart) {
+    return false;
+  }
+  entry->committerName = trimmed(committer, emailStart);
+  entry->committerEmail = trimmed(emailStart + 1, emailEnd);
+
+  entry->time = 0;
+  entry->offset = 0;
+  const char *date = emailEnd + 1;
+  while (date < committerEnd && *date == ' ') {
+    ++date;
+  }
+  git_time_t time {0};
+  const char *digit = date;
+  for (; digit < committerEnd && isDigit(*digit); ++digit) {
+    if (digit - date < 18) {
+      time = time * 10 + (*digit - '0');
+    }
+  }
+  // more digits could overflow: such a date is as malformed as a missing one
+  if (digit > date && digit - date <= 18) {
+    entry->time = time;
+    const char *timezone = digit;
+    while (timezone < committerEnd && *timezone == ' ') {
+      ++timezone;
+    }
+    if (
+      committerEnd - timezone >= 5
+      && (*timezone == '+' || *timezone == '-')
+      && isDigit(timezone[1]) && isDigit(timezone[2]) && isDigit(timezone[3]) && isDigit(timezone[4])
+    ) {
+      const int hours = (timezone[1] - '0') * 10 + (timezone[2] - '0');
+      const int minutes = (timezone[3] - '0') * 10 + (timezone[4] - '0');
+      entry->offset = (*timezone == '-' ? -1 : 1) * (hours * 60 + minutes);
+    }
+  }
+
+  entry->message = tab != nullptr ? std::string(tab + 1, end) : std::string();
+  return true;
+}
+
+int ReflogReader::Parse(const char *data, size_t length, size_t limit, std::vector<Entry> *out)
+{
+  const char *end = data + length;
+  size_t count {0};
+  while (end > data && (limit == 0 || count < limit)) {
+    if (end[-1] == '\n') {
+      --end;
+    }
+    const char *newline = findLast(data, end, '\n');
+    const char *line = newline != nullptr ? newline + 1 : data;
+    if (line < end) {
+      Entry entry;
+      if (!parseLine(line, end, &entry)) {
+        return -1;
+      }
+      out->push_back(std::move(entry));
+      ++count;
+    }
+    end = line;
+  }
+  return GIT_OK;
+}
+
+int ReflogReader::Read(git_repository *repo, const std::string &name, size_t limit, std::vector<Entry> *out)
+{
+  int valid {0};
+  if (git_reference_name_is_valid(&valid, name.c_str()) != GIT_OK) {
+    return -1;
+  }
+  if (!valid) {
+    git_error_set_str(GIT_ERROR_REFERENCE, ("the reference name '" + name + "' is not valid").c_str());
+    return GIT_EINVALIDSPEC;
+  }
+
+  const std::string path = std::string(isPerWorktreeReference(name)
+    ? git_repository_path(repo)
+    : git_repository_commondir(repo)) + "logs/" + name;
+  MappedFile reflog;
+  const int mapped = reflog.Map(path);
+  if (mapped == GIT_ENOTFOUND) {
+    return GIT_OK;
+  }
+  if (mapped != GIT_OK) {
+    git_error_set_str(GIT_ERROR_OS, ("could not map '" + path + "'").c_str());
+    return -1;
+  }
+
+  if (Parse(reflog.Data(), reflog.Length(), limit, out) != GIT_OK) {
+    git_error_set_str(GIT_ERROR_REFERENCE, ("failed to parse the reflog of '" + name + "'").c_str());
+    return -1;
+  }
+  return GIT_OK;
+}
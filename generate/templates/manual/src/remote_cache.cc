@@ -0,0 +1,124 @@
+#include "../include/remote_cache.h"
+
+#include <uv.h>
+
+RemoteCache::~RemoteCache() {
+  clear();
+}
+
+bool RemoteCache::FileStamp::operator==(const FileStamp &other) const {
+  return path == other.path
+    && exists == other.exists
+    && modifiedSeconds == other.modifiedSeconds
+    && modifiedNanoseconds == other.modifiedNanoseconds
+    && size == other.size;
+}
+
+RemoteCache::FileStamp RemoteCache::stampFile(const std::string &path) {
+  FileStamp stamp { path, false, 0, 0, 0 };
+
+  uv_fs_t statRequest;
+  if (uv_fs_stat(nullptr, &statRequest, path.c_str(), nullptr) == 0) {
+    stamp.exists = true;
+    stamp.modifiedSeconds = statRequest.statbuf.st_mtim.tv_sec;
+    stamp.modifiedNanoseconds = statRequest.statbuf.st_mtim.tv_nsec;
+    stamp.size = statRequest.statbuf.st_size;
+  }
+  uv_fs_req_cleanup(&statRequest);
+
+  return stamp;
+}
+
+/**
+ * RemoteCache::stampConfigFiles
+ * The files of each level libgit2 reads remotes from. The global ones are only there if
+ * they existed when looked up.
+ */
+void RemoteCache::stampConfigFiles(std::vector<FileStamp> *stamps, git_repository *repo) {
+  git_buf path = GIT_BUF_INIT_CONST(NULL, 0);
+  if (git_repository_item_path(&path, repo, GIT_REPOSITORY_ITEM_CONFIG) == GIT_OK) {
+    stamps->push_back(stampFile(path.ptr));
+  }
+  git_buf_dispose(&path);
+
+  if (git_repository_path(repo) != NULL) {
+    stamps->push_back(stampFile(std::string(git_repository_path(repo)) + "config.worktree"));
+  }
+
+  int (*findFunctions[])(git_buf *) = {
+    git_config_find_global,
+    git_config_find_xdg,
+    git_config_find_system,
+    git_config_find_programdata
+  };
+  for (auto findFunction : findFunctions) {
+    if (findFunction(&path) == GIT_OK) {
+      stamps->push_back(stampFile(path.ptr));
+    }
+    git_buf_dispose(&path);
+  }
+
+  git_error_clear();
+}
+
+int RemoteCache::GetRemotes(std::vector<git_remote *> *out, git_repository *repo) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::vector<FileStamp> stamps;
+  stampConfigFiles(&stamps, repo);
+  if (!m_loaded || stamps != m_stamps) {
+    clear();
+
+    // stamped before reading, so that a change while reading is seen the next time
+    int error = load(repo);
+    if (error != GIT_OK) {
+      clear();
+      return error;
+    }
+    m_stamps = std::move(stamps);
+    m_loaded = true;
+  }
+
+  for (git_remote *remote : m_remotes) {
+    git_remote *duplicate;
+    int error = git_remote_dup(&duplicate, remote);
+    if (error != GIT_OK) {
+      for (git_remote *remoteToFree : *out) {
+        git_remote_free(remoteToFree);
+      }
+      out->clear();
+      return error;
+    }
+    out->push_back(duplicate);
+  }
+  return GIT_OK;
+}
+
+int RemoteCache::load(git_repository *repo) {
+  git_strarray remoteNames;
+  int error = git_remote_list(&remoteNames, repo);
+  if (error != GIT_OK) {
+    return error;
+  }
+
+  for (size_t i = 0; i < remoteNames.count; ++i) {
+    git_remote *remote;
+    error = git_remote_lookup(&remote, repo, remoteNames.strings[i]);
+    if (error != GIT_OK) {
+      break;
+    }
+    m_remotes.push_back(remote);
+  }
+
+  git_strarray_free(&remoteNames);
+  return error;
+}
+
+void RemoteCache::clear() {
+  for (git_remote *remote : m_remotes) {
+    git_remote_free(remote);
+  }
+  m_remotes.clear();
+  m_stamps.clear();
+  m_loaded = false;
+}
@@ -0,0 +1,334 @@
+#include <nan.h>
+#include <string.h>
+#include <algorithm>
+
+extern "C" {
+  #include <git2.h>
+}
+
+#include "../include/context.h"
+#include "../include/repository.h"
+#include "../include/repository_watcher.h"
+
+using namespace std;
+using namespace v8;
+using namespace node;
+
+namespace {
+  const uint64_t kDefaultDebounce = 100;
+  const char kLockFileSuffix[] = ".lock";
+
+  bool isDirectory(const std::string &path) {
+    uv_fs_t request;
+    const bool result = uv_fs_stat(nullptr, &request, path.c_str(), nullptr) == 0
+      && (request.statbuf.st_mode & S_IFMT) == S_IFDIR;
+    uv_fs_req_cleanup(&request);
+    return result;
+  }
+
+  bool pathExists(const std::string &path) {
+    uv_fs_t request;
+    const bool result = uv_fs_stat(nullptr, &request, path.c_str(), nullptr) == 0;
+    uv_fs_req_cleanup(&request);
+    return result;
+  }
+
+  bool isLockFile(const std::string &name) {
+    const size_t suffixLength = sizeof(kLockFileSuffix) - 1;
+    return name.size() >= suffixLength && name.compare(name.size() - suffixLength, suffixLength, kLockFileSuffix) == 0;
+  }
+
+  // changes signalled by a file written directly in the git dir (or the common dir)
+  int changesOfGitDirFile(const std::string &name) {
+    if (name == "HEAD" || name == "ORIG_HEAD" || name == "MERGE_HEAD" || name == "CHERRY_PICK_HEAD") {
+      return RepositoryWatcher::kHead;
+    }
+    if (name == "index") {
+      return RepositoryWatcher::kIndex;
+    }
+    if (name == "FETCH_HEAD") {
+      return RepositoryWatcher::kFetchHead;
+    }
+    if (name == "packed-refs") {
+      return RepositoryWatcher::kRefs;
+    }
+    return 0;
+  }
+}
+
+struct RepositoryWatcher::WatchedDirectory {
+  uv_fs_event_t handle;
+  RepositoryWatcher *watcher;
+  std::string baseDir;
+  std::string relativePath; // empty for the git dir, "refs/heads/" for a refs directory
+  bool isRefs;
+
+  void Close() {
+    uv_fs_event_stop(&handle);
+    uv_close(reinterpret_cast<uv_handle_t *>(&handle), [](uv_handle_t *closedHandle) {
+      delete static_cast<WatchedDirectory *>(closedHandle->data);
+    });
+  }
+};
+
+RepositoryWatcher::RepositoryWatcher(const std::string &gitDir, const std::string &commonDir, Nan::Callback *callback,
+  uint64_t debounce, bool persistent)
+  : gitDir(gitDir), commonDir(commonDir), callback(callback), debounce(debounce), persistent(persistent) {}
+
+RepositoryWatcher::~RepositoryWatcher() {
+  stop();
+  delete callback;
+}
+
+void RepositoryWatcher::InitializeComponent(Local<v8::Object> target, nodegit::Context *nodegitContext) {
+  Nan::HandleScope scope;
+
+  Local<External> nodegitExternal = Nan::New<External>(nodegitContext);
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(JSNewFunction, nodegitExternal);
+
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  tpl->SetClassName(Nan::New("RepositoryWatcher").ToLocalChecked());
+
+  Nan::SetPrototypeMethod(tpl, "stop", Stop, nodegitExternal);
+  Nan::SetPrototypeMethod(tpl, "isWatching", IsWatching, nodegitExternal);
+
+  Local<Function> constructor_template = Nan::GetFunction(tpl).ToLocalChecked();
+  nodegitContext->SaveToPersistent("RepositoryWatcher::Template", constructor_template);
+  Nan::Set(target, Nan::New("RepositoryWatcher").ToLocalChecked(), constructor_template);
+}
+
+NAN_METHOD(RepositoryWatcher::JSNewFunction) {
+  if (info.Length() < 2 || !info[0]->IsObject() || !info[1]->IsFunction()) {
+    return Nan::ThrowError("Repository and callback are required.");
+  }
+
+  uint64_t debounce = kDefaultDebounce;
+  bool persistent = true;
+  if (info.Length() > 2 && info[2]->IsObject()) {
+    v8::Local<v8::Object> options = Nan::To<v8::Object>(info[2]).ToLocalChecked();
+    v8::Local<v8::Value> debounceValue = Nan::Get(options, Nan::New("debounce").ToLocalChecked()).ToLocalChecked();
+    if (debounceValue->IsNumber()) {
+      debounce = static_cast<uint64_t>(std::max<double>(Nan::To<double>(debounceValue).FromJust(), 0));
+    }
+    v8::Local<v8::Value> persistentValue = Nan::Get(options, Nan::New("persistent").ToLocalChecked()).ToLocalChecked();
+    if (persistentValue->IsBoolean()) {
+      persistent = persistentValue->IsTrue();
+    }
+  }
+
+  git_repository *repo = Nan::ObjectWrap::Unwrap<GitRepository>(Nan::To<v8::Object>(info[0]).ToLocalChecked())->GetValue();
+  RepositoryWatcher *watcher = new RepositoryWatcher(
+    git_repository_path(repo),
+    git_repository_commondir(repo),
+    new Nan::Callback(Local<Function>::Cast(info[1])),
+    debounce,
+    persistent
+  );
+  watcher->Wrap(info.This());
+
+  watcher->isolate = info.GetIsolate();
+  const int result = watcher->start(node::GetCurrentEventLoop(info.GetIsolate()));
+  if (result < 0) {
+    return Nan::ThrowError(("Could not watch the repository: " + std::string(uv_strerror(result))).c_str());
+  }
+
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(RepositoryWatcher::Stop) {
+  Nan::ObjectWrap::Unwrap<RepositoryWatcher>(info.This())->stop();
+}
+
+NAN_METHOD(RepositoryWatcher::IsWatching) {
+  info.GetReturnValue().Set(Nan::New(Nan::ObjectWrap::Unwrap<RepositoryWatcher>(info.This())->watching));
+}
+
+/**
+ * RepositoryWatcher::start
+ * HEAD, index and FETCH_HEAD are in the git dir; packed-refs and refs/ in the common dir,
+ * which is the git dir too except in linked worktrees.
+ */
+int RepositoryWatcher::start(uv_loop_t *eventLoop) {
+  loop = eventLoop;
+  debounceTimer = new uv_timer_t;
+  uv_timer_init(loop, debounceTimer);
+  debounceTimer->data = this;
+  if (!persistent) {
+    uv_unref(reinterpret_cast<uv_handle_t *>(debounceTimer));
+  }
+
+  int result = watchDirectory(gitDir, "", false);
+  if (result == 0 && commonDir != gitDir) {
+    result = watchDirectory(commonDir, "", false);
+  }
+  if (result == 0) {
+    result = watchDirectory(commonDir, "refs/", true);
+  }
+
+  // the watcher lives, and calls back, until it's stopped
+  watching = true;
+  Ref();
+  node::AddEnvironmentCleanupHook(isolate, onEnvironmentCleanup, this);
+
+  if (result < 0) {
+    stop();
+  }
+  return result;
+}
+
+void RepositoryWatcher::stop() {
+  for (auto &watchedDirectory : watchedDirectories) {
+    watchedDirectory.second->Close();
+  }
+  watchedDirectories.clear();
+
+  if (debounceTimer != nullptr) {
+    uv_timer_stop(debounceTimer);
+    uv_close(reinterpret_cast<uv_handle_t *>(debounceTimer), [](uv_handle_t *closedHandle) {
+      delete reinterpret_cast<uv_timer_t *>(closedHandle);
+    });
+    debounceTimer = nullptr;
+  }
+  pendingChanges = 0;
+
+  if (watching) {
+    watching = false;
+    node::RemoveEnvironmentCleanupHook(isolate, onEnvironmentCleanup, this);
+    Unref();
+  }
+}
+
+int RepositoryWatcher::watchDirectory(const std::string &baseDir, const std::string &relativePath, bool isRefs) {
+  std::string path = baseDir + relativePath;
+  if (watchedDirectories.count(path) != 0) {
+    return 0;
+  }
+
+  WatchedDirectory *watchedDirectory = new WatchedDirectory();
+  watchedDirectory->watcher = this;
+  watchedDirectory->baseDir = baseDir;
+  watchedDirectory->relativePath = relativePath;
+  watchedDirectory->isRefs = isRefs;
+  watchedDirectory->handle.data = watchedDirectory;
+
+  int result = uv_fs_event_init(loop, &watchedDirectory->handle);
+  if (result < 0) {
+    delete watchedDirectory;
+    return result;
+  }
+
+  const std::string watchedPath = path.size() > 1 && path.back() == '/' ? path.substr(0, path.size() - 1) : path;
+  result = uv_fs_event_start(&watchedDirectory->handle, onFsEvent, watchedPath.c_str(), 0);
+  if (result < 0) {
+    watchedDirectory->Close();
+    return result;
+  }
+  if (!persistent) {
+    uv_unref(reinterpret_cast<uv_handle_t *>(&watchedDirectory->handle));
+  }
+  watchedDirectories[path] = watchedDirectory;
+
+  if (!isRefs) {
+    return 0;
+  }
+
+  uv_fs_t request;
+  if (uv_fs_scandir(nullptr, &request, path.c_str(), 0, nullptr) >= 0) {
+    uv_dirent_t entry;
+    while (uv_fs_scandir_next(&request, &entry) != UV_EOF) {
+      const std::string childPath = relativePath + entry.name + "/";
+      if (
+        entry.type == UV_DIRENT_DIR
+        || (entry.type == UV_DIRENT_UNKNOWN && isDirectory(baseDir + childPath))
+      ) {
+        // a directory that can't be watched only misses the changes of its loose refs
+        watchDirectory(baseDir, childPath, true);
+      }
+    }
+  }
+  uv_fs_req_cleanup(&request);
+  return 0;
+}
+
+void RepositoryWatcher::unwatchRefsDirectory(const std::string &relativePath) {
+  const std::string path = commonDir + relativePath;
+  auto watchedDirectory = watchedDirectories.lower_bound(path);
+  while (watchedDirectory != watchedDirectories.end() && watchedDirectory->first.compare(0, path.size(), path) == 0) {
+    watchedDirectory->second->Close();
+    watchedDirectory = watchedDirectories.erase(watchedDirectory);
+  }
+}
+
+void RepositoryWatcher::addChanges(int changes) {
+  if (changes == 0 || debounceTimer == nullptr) {
+    return;
+  }
+
+  // each event postpones the callback, until the repository is quiet
+  pendingChanges |= changes;
+  uv_timer_start(debounceTimer, onDebounceTimer, debounce, 0);
+}
+
+void RepositoryWatcher::onFsEvent(uv_fs_event_t *handle, const char *filename, int events, int status) {
+  WatchedDirectory *watchedDirectory = static_cast<WatchedDirectory *>(handle->data);
+  RepositoryWatcher *watcher = watchedDirectory->watcher;
+  if (status < 0 || !watcher->watching) {
+    return;
+  }
+
+  const std::string name = filename != nullptr ? filename : "";
+  if (isLockFile(name)) {
+    return;
+  }
+
+  if (!watchedDirectory->isRefs) {
+    // some platforms don't tell which file changed
+    watcher->addChanges(name.empty() ? kHead | kRefs | kIndex | kFetchHead : changesOfGitDirFile(name));
+    return;
+  }
+
+  if (!name.empty()) {
+    const std::string childPath = watchedDirectory->relativePath + name + "/";
+    const std::string fullPath = watchedDirectory->baseDir + watchedDirectory->relativePath + name;
+    if (isDirectory(fullPath)) {
+      // refs written in a new directory before it's watched are signalled by its own event
+      watcher->watchDirectory(watchedDirectory->baseDir, childPath, true);
+    } else if (!pathExists(fullPath)) {
+      watcher->unwatchRefsDirectory(childPath);
+    }
+  }
+  watcher->addChanges(kRefs);
+}
+
+void RepositoryWatcher::onDebounceTimer(uv_timer_t *timer) {
+  RepositoryWatcher *watcher = static_cast<RepositoryWatcher *>(timer->data);
+  const int changes = watcher->pendingChanges;
+  watcher->pendingChanges = 0;
+  if (changes == 0 || !watcher->watching) {
+    return;
+  }
+
+  Nan::HandleScope scope;
+  const std::pair<int, const char *> changeNames[] = {
+    { kHead, "head" },
+    { kRefs, "refs" },
+    { kIndex, "index" },
+    { kFetchHead, "fetchHead" }
+  };
+  v8::Local<v8::Array> jsChanges = Nan::New<v8::Array>();
+  for (const auto &changeName : changeNames) {
+    if (changes & changeName.first) {
+      Nan::Set(jsChanges, jsChanges->Length(), Nan::New(changeName.second).ToLocalChecked());
+    }
+  }
+
+  // the callback may stop the watcher: it's not used after this
+  Nan::AsyncResource asyncResource("nodegit:RepositoryWatcher");
+  v8::Local<v8::Value> argv[1] = { jsChanges };
+  watcher->callback->Call(1, argv, &asyncResource);
+}
+
+void RepositoryWatcher::onEnvironmentCleanup(void *data) {
+  RepositoryWatcher *watcher = static_cast<RepositoryWatcher *>(data);
+  watcher->stop();
+}
@@ -0,0 +1,128 @@
+#include "../include/tag_peel_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+  struct SignatureMarkers {
+    TagPeelCache::SignatureType signatureType;
+    const char *begin;
+    const char *end;
+  };
+
+  // by priority, as refreshReferences has always looked for them
+  const SignatureMarkers kSignatureMarkers[] = {
+    { TagPeelCache::kGpgsig, "-----BEGIN PGP SIGNATURE-----", "-----END PGP SIGNATURE-----" },
+    { TagPeelCache::kGpgsig, "-----BEGIN PGP MESSAGE-----", "-----END PGP MESSAGE-----" },
+    { TagPeelCache::kX509, "-----BEGIN SIGNED MESSAGE-----", "-----END SIGNED MESSAGE-----" }
+  };
+
+  const char *findString(const char *first, const char *last, const char *string) {
+    const char *found = std::search(first, last, string, string + strlen(string));
+    return found != last ? found : nullptr;
+  }
+}
+
+std::shared_ptr<TagPeelCache> TagPeelCache::ForRepository(nodegit::Context *nodegitContext, git_repository *repo) {
+  const char *commonDir = git_repository_commondir(repo);
+  if (commonDir == NULL) {
+    return std::make_shared<TagPeelCache>();
+  }
+
+  const std::string key = std::string("tagPeelCache:") + commonDir;
+  std::shared_ptr<TagPeelCache> cache = std::static_pointer_cast<TagPeelCache>(nodegitContext->GetCleanupHandle(key));
+  if (!cache) {
+    cache = std::make_shared<TagPeelCache>();
+    nodegitContext->SaveCleanupHandle(key, cache);
+  }
+  return cache;
+}
+
+int TagPeelCache::Get(std::shared_ptr<const Tag> *out, git_reference *ref, git_odb *odb) {
+  const git_oid *targetOid = git_reference_target(ref);
+  const std::string key(reinterpret_cast<const char *>(targetOid->id), GIT_OID_RAWSZ);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto tag = m_tags.find(key);
+    if (tag != m_tags.end()) {
+      *out = tag->second;
+      return GIT_OK;
+    }
+  }
+
+  int error = read(out, ref, odb);
+  if (error != GIT_OK) {
+    return error;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_tags.size() >= kMaxTags) {
+    m_tags.clear();
+  }
+  m_tags[key] = *out;
+  return GIT_OK;
+}
+
+/**
+ * TagPeelCache::FindSignature
+ * Same as the first match of /-----BEGIN X-----[\s\S]+?-----END X-----/ for each marker of the
+ * signature type, in order.
+ */
+std::string TagPeelCache::FindSignature(const char *data, size_t length, SignatureType signatureType) {
+  const char *last = data + length;
+  for (const SignatureMarkers &markers : kSignatureMarkers) {
+    if (markers.signatureType != signatureType) {
+      continue;
+    }
+
+    const char *begin = findString(data, last, markers.begin);
+    if (begin == nullptr) {
+      continue;
+    }
+
+    // at least one character between the markers
+    const char *searchFrom = begin + strlen(markers.begin) + 1;
+    const char *end = searchFrom < last ? findString(searchFrom, last, markers.end) : nullptr;
+    if (end != nullptr) {
+      return std::string(begin, end + strlen(markers.end));
+    }
+  }
+  return std::string();
+}
+
+int TagPeelCache::read(std::shared_ptr<const Tag> *out, git_reference *ref, git_odb *odb) {
+  std::shared_ptr<Tag> tag = std::make_shared<Tag>();
+  const git_oid *targetOid = git_reference_target(ref);
+
+  git_tag *referencedTag;
+  if (git_tag_lookup(&referencedTag, git_reference_owner(ref), targetOid) == GIT_OK) {
+    const char *tagMessage = git_tag_message(referencedTag);
+    if (tagMessage != NULL) {
+      tag->hasMessage = true;
+      tag->message = tagMessage;
+    }
+
+    git_odb_object *tagOdbObject;
+    if (git_odb_read(&tagOdbObject, odb, git_tag_id(referencedTag)) == GIT_OK) {
+      const char *data = static_cast<const char *>(git_odb_object_data(tagOdbObject));
+      const size_t length = git_odb_object_size(tagOdbObject);
+      tag->signatures[kGpgsig] = FindSignature(data, length, kGpgsig);
+      tag->signatures[kX509] = FindSignature(data, length, kX509);
+      git_odb_object_free(tagOdbObject);
+    }
+
+    git_tag_free(referencedTag);
+  }
+
+  git_object *commitObject;
+  int error = git_reference_peel(&commitObject, ref, GIT_OBJ_COMMIT);
+  if (error != GIT_OK) {
+    return error;
+  }
+  git_oid_cpy(&tag->peeledOid, git_object_id(commitObject));
+  git_object_free(commitObject);
+
+  *out = tag;
+  return GIT_OK;
+}
@@ -72,7 +72,21 @@
         "src/cleanup_handle.cc",
         "src/convenient_patch.cc",
         "src/convenient_hunk.cc",
+        "src/ahead_behind_batch.cc",
+        "src/commits_graph.cc",
+        "src/commit_graph_index.cc",
+        "src/commit_graph_file.cc",
+        "src/commit_data_source.cc",
+        "src/graph_layout.cc",
+        "src/commit_search.cc",
+        "src/mapped_file.cc",
+        "src/reference_listing.cc",
+        "src/reflog_reader.cc",
+        "src/reference_list_cache.cc",
+        "src/remote_cache.cc",
+        "src/tag_peel_cache.cc",
         "src/filter_registry.cc",
+        "src/repository_watcher.cc",
         "src/git_buf_converter.cc",
         "src/str_array_converter.cc",
         "src/context.cc",
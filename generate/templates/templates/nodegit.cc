@@ -22,7 +22,9 @@
 {% endeach %}
 #include "../include/convenient_patch.h"
 #include "../include/convenient_hunk.h"
+#include "../include/commit_graph_index.h"
 #include "../include/filter_registry.h"
+#include "../include/repository_watcher.h"
 
 using namespace v8;
 
@@ -120,7 +122,9 @@ NAN_MODULE_INIT(init) {
 
   ConvenientHunk::InitializeComponent(target, nodegitContext);
   ConvenientPatch::InitializeComponent(target, nodegitContext);
+  CommitGraphIndex::InitializeComponent(target, nodegitContext);
   GitFilterRegistry::InitializeComponent(target, nodegitContext);
+  RepositoryWatcher::InitializeComponent(target, nodegitContext);
 
   nodegit::LockMaster::InitializeContext();
 }
@@ -81,6 +81,13 @@ var _ConvenientHunk = rawApi.ConvenientHunk;
 var _ConvenientHunk_lines = _ConvenientHunk.prototype.lines;
 _ConvenientHunk.prototype.lines = promisify(_ConvenientHunk_lines);
 
+var _CommitGraphIndex = rawApi.CommitGraphIndex;
+var _CommitGraphIndex_isAncestorBatch = _CommitGraphIndex.prototype.isAncestorBatch;
+_CommitGraphIndex.prototype.isAncestorBatch = promisify(_CommitGraphIndex_isAncestorBatch);
+
+var _CommitGraphIndex_mergeBaseBatch = _CommitGraphIndex.prototype.mergeBaseBatch;
+_CommitGraphIndex.prototype.mergeBaseBatch = promisify(_CommitGraphIndex_mergeBaseBatch);
+
 var _FilterRegistry = rawApi.FilterRegistry;
 var _FilterRegistry_register = _FilterRegistry.register;
 _FilterRegistry.register = promisify(_FilterRegistry_register);
@@ -116,6 +123,7 @@ require("./enums.js");
 // Import extensions
 // [Manual] extensions
 importExtension("filter_registry");
+importExtension("repository_watcher");
 {% each %}
   {% if type != "enum" %}
     importExtension("{{ filename }}");
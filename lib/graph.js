@@ -13,3 +13,23 @@ var _reachableFromAny = Graph.reachableFromAny;
 Graph.reachableFromAny = function(repository, commit, descendant_array) {
   return _reachableFromAny(repository, commit, descendant_array, descendant_array.length);
 };
+
+var aheadBehindBatch = Graph.aheadBehindBatch;
+/**
+ * Same as Graph.aheadBehind for many pairs of commits, counting all of them
+ * in a single walk of their shared history. Uses the commit-graph of the
+ * repository when it has one.
+ *
+ * @param {Repository} repository
+ * @param {Array<Oid|String>} locals
+ * @param {Array<Oid|String>} upstreams as many as locals
+ * @param {Object} options
+ * @param {Boolean} options.useCommitGraph defaults to true
+ * @async
+ * @return {Object} `{ ahead, behind, visitedCommits }`: Uint32Arrays with
+ *                  the counts of each pair, in the same order, and the number
+ *                  of commits read by the walk
+ */
+Graph.aheadBehindBatch = function(repository, locals, upstreams, options) {
+  return aheadBehindBatch(repository, locals, upstreams, options || {});
+};
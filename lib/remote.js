@@ -16,9 +16,22 @@ Remote.lookup = lookupWrapper(Remote);
 
 /**
  * Lists advertised references from a remote. You must connect to the remote
- * before using referenceList.
+ * before using referenceList, unless the listing is in the cache.
+ *
+ * The prefixes are applied natively, so that only the heads asked for are
+ * copied; the remote still advertises all its references, as the transports
+ * don't support the ref-prefix filtering of the protocol v2.
+ *
+ * With a cacheTtl, the heads are kept, by remote url and prefixes, and the
+ * same listing made within cacheTtl ms is answered from them without reading
+ * the connection, e.g. for clients polling a remote.
  *
  * @async
+ * @param {Object} [options]
+ * @param {Array<String>} [options.prefixes] only list the heads whose name
+ *                                           starts with one of them, e.g.
+ *                                           "refs/heads/"
+ * @param {Number} [options.cacheTtl] in ms
  * @return {Promise<Array<RemoteHead>>} a list of the remote heads the remote
  *                                      had available at the last established
  *                                      connection.
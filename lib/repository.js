@@ -4,6 +4,7 @@ var NodeGit = require("../");
 var Blob = NodeGit.Blob;
 var Checkout = NodeGit.Checkout;
 var Commit = NodeGit.Commit;
+var Fetch = NodeGit.Fetch;
 var shallowClone = NodeGit.Utils.shallowClone;
 var path = require("path");
 var Filter = NodeGit.Filter;
@@ -20,6 +21,7 @@ var Tag = NodeGit.Tag;
 var Tree = NodeGit.Tree;
 var TreeBuilder = NodeGit.Treebuilder;
 
+var _commitGraphIndex = Repository.prototype.commitGraphIndex;
 var _discover = Repository.discover;
 var _fetchheadForeach = Repository.prototype.fetchheadForeach;
 var _mergeheadForeach = Repository.prototype.mergeheadForeach;
@@ -981,14 +983,23 @@ Repository.prototype.fetch = function(
 };
 
 /**
- * Fetches from all remotes. This is done in series due to deadlocking issues
- * with fetching from many remotes that can happen.
+ * Fetches from all remotes. This is done in series by default due to
+ * deadlocking issues with fetching from many remotes that can happen. With
+ * `options.concurrency` above 1, that many remotes are downloaded from at
+ * once, each through its own Repository opened on the same path, while
+ * updating their tips is done one remote after the other. No remote is
+ * fetched from after one of them failed.
  *
  * @async
  * @param {Object|FetchOptions} fetchOptions Options for the fetch, includes
  *                                           callbacks for fetching
+ * @param {Object} options
+ * @param {Number} options.concurrency The number of remotes to download from
+ *                                     at once, 1 by default
+ * @param {Function} options.transferProgress Called with the progress summed
+ *                                            over every remote
  */
-Repository.prototype.fetchAll = function(fetchOptions) {
+Repository.prototype.fetchAll = function(fetchOptions, options) {
   var repo = this;
 
   function createCallbackWrapper(fn, remote) {
@@ -1001,6 +1012,7 @@ Repository.prototype.fetchAll = function(fetchOptions) {
   }
 
   fetchOptions = fetchOptions || {};
+  options = options || {};
 
   var remoteCallbacks = fetchOptions.callbacks || {};
 
@@ -1008,33 +1020,147 @@ Repository.prototype.fetchAll = function(fetchOptions) {
   var certificateCheck = remoteCallbacks.certificateCheck;
   var transferProgress = remoteCallbacks.transferProgress;
 
-  return repo.getRemoteNames()
-    .then(function(remotes) {
-      return remotes.reduce(function(fetchPromise, remote) {
-        var wrappedFetchOptions = shallowClone(fetchOptions);
-        var wrappedRemoteCallbacks = shallowClone(remoteCallbacks);
+  var concurrency = Math.max(options.concurrency || 1, 1);
+  var progressByRemote = {};
+
+  function reportProgress(remote, progress) {
+    progressByRemote[remote] = {
+      totalObjects: progress.totalObjects(),
+      indexedObjects: progress.indexedObjects(),
+      receivedObjects: progress.receivedObjects(),
+      localObjects: progress.localObjects(),
+      totalDeltas: progress.totalDeltas(),
+      indexedDeltas: progress.indexedDeltas(),
+      receivedBytes: progress.receivedBytes()
+    };
+
+    var total = {
+      totalObjects: 0,
+      indexedObjects: 0,
+      receivedObjects: 0,
+      localObjects: 0,
+      totalDeltas: 0,
+      indexedDeltas: 0,
+      receivedBytes: 0
+    };
+    Object.keys(progressByRemote).forEach(function(name) {
+      Object.keys(total).forEach(function(key) {
+        total[key] += progressByRemote[name][key];
+      });
+    });
+
+    options.transferProgress(total);
+  }
 
-        if (credentials) {
-          wrappedRemoteCallbacks.credentials =
-            createCallbackWrapper(credentials, remote);
+  // tips are updated one remote at a time, the downloads don't wait for it
+  var updatingTips = Promise.resolve();
+
+  function updateTips(remote, remoteName, callbacks) {
+    var prune = fetchOptions.prune || Fetch.PRUNE.UNSPECIFIED;
+    var updateFetchhead = fetchOptions.updateFetchhead === undefined ?
+      1 : fetchOptions.updateFetchhead;
+    var downloadTags = fetchOptions.downloadTags ||
+      Remote.AUTOTAG_OPTION.DOWNLOAD_TAGS_UNSPECIFIED;
+
+    updatingTips = updatingTips
+      .catch(function() {})
+      .then(function() {
+        return remote.updateTips(
+          callbacks,
+          updateFetchhead,
+          downloadTags,
+          "Fetch from " + remoteName
+        );
+      })
+      .then(function() {
+        if (prune === Fetch.PRUNE.NO_PRUNE ||
+            (prune === Fetch.PRUNE.UNSPECIFIED && !remote.pruneRefs())) {
+          return;
         }
 
-        if (certificateCheck) {
-          wrappedRemoteCallbacks.certificateCheck =
-            createCallbackWrapper(certificateCheck, remote);
+        return remote.prune(callbacks);
+      });
+
+    return updatingTips;
+  }
+
+  function fetchRemote(slotRepo, remoteName) {
+    var wrappedFetchOptions = shallowClone(fetchOptions);
+    var wrappedRemoteCallbacks = shallowClone(remoteCallbacks);
+
+    if (credentials) {
+      wrappedRemoteCallbacks.credentials =
+        createCallbackWrapper(credentials, remoteName);
+    }
+
+    if (certificateCheck) {
+      wrappedRemoteCallbacks.certificateCheck =
+        createCallbackWrapper(certificateCheck, remoteName);
+    }
+
+    if (transferProgress || options.transferProgress) {
+      wrappedRemoteCallbacks.transferProgress = function(progress) {
+        if (options.transferProgress) {
+          reportProgress(remoteName, progress);
         }
 
         if (transferProgress) {
-          wrappedRemoteCallbacks.transferProgress =
-            createCallbackWrapper(transferProgress, remote);
+          return transferProgress.call(this, progress, remoteName);
         }
+      };
+    }
 
-        wrappedFetchOptions.callbacks = wrappedRemoteCallbacks;
+    wrappedFetchOptions.callbacks = wrappedRemoteCallbacks;
 
-        return fetchPromise.then(function() {
-          return repo.fetch(remote, wrappedFetchOptions);
-        });
-      }, Promise.resolve());
+    return slotRepo.getRemote(remoteName)
+      .then(function(remote) {
+        return remote.download(null, wrappedFetchOptions)
+          .then(function() {
+            return updateTips(remote, remoteName, wrappedRemoteCallbacks);
+          })
+          .then(function() {
+            return remote.disconnect();
+          }, function(error) {
+            return remote.disconnect()
+              .then(function() {
+                throw error;
+              });
+          });
+      });
+  }
+
+  return repo.getRemoteNames()
+    .then(function(remotes) {
+      var next = 0;
+      var failed = false;
+
+      function fetchNext(slotRepo) {
+        if (failed || next >= remotes.length) {
+          return Promise.resolve();
+        }
+
+        return fetchRemote(slotRepo, remotes[next++])
+          .then(function() {
+            return fetchNext(slotRepo);
+          }, function(error) {
+            failed = true;
+            throw error;
+          });
+      }
+
+      // a git_repository can't be downloaded into from several threads
+      function openSlotRepository() {
+        return concurrency === 1 ?
+          Promise.resolve(repo) :
+          Repository.open(repo.path());
+      }
+
+      var fetches = [];
+      for (var i = 0; i < Math.min(concurrency, remotes.length); ++i) {
+        fetches.push(openSlotRepository().then(fetchNext));
+      }
+
+      return Promise.all(fetches);
     });
 };
 
@@ -1087,6 +1213,44 @@ Repository.prototype.getBranchCommit = function(name) {
   return this.getReferenceCommit(name);
 };
 
+/**
+ * @typedef branchSummary
+ * @type {Object}
+ * @property {String} name the full name of the reference
+ * @property {String} oid the sha of the tip commit, peeled for tags
+ * @property {String} summary the first paragraph of the commit message
+ * @property {String} authorName
+ * @property {Number} authorDate in milliseconds
+ * @property {Number} committerDate in milliseconds
+ * @property {String|null} upstream the full name of the upstream of a local
+ *                                  branch
+ * @property {Number|null} ahead commits on the branch and not its upstream,
+ *                               null when the upstream doesn't exist or
+ *                               the history needed to count them is
+ *                               missing, as in a shallow clone
+ * @property {Number|null} behind commits on the upstream and not the branch
+ */
+var getBranchSummaries = Repository.prototype.getBranchSummaries;
+/**
+ * Lists the branches with their tip commit in a single call, most recently
+ * committed first, instead of getting the references and then the commit of
+ * each one. The upstreams are only counted for the branches returned.
+ *
+ * @async
+ * @param {Object} [options]
+ * @param {String} [options.prefix] of the references to list, "refs/heads/"
+ *                                  by default; must start with "refs/"
+ * @param {Number} [options.limit] how many branches to return, all of them
+ *                                 by default
+ * @param {Boolean} [options.aheadBehind] whether to count the commits ahead
+ *                                        of and behind the upstreams, true
+ *                                        by default
+ * @return {Array<branchSummary>}
+ */
+Repository.prototype.getBranchSummaries = function(options) {
+  return getBranchSummaries.call(this, options || {});
+};
+
 /**
  * Retrieve the commit identified by oid.
  *
@@ -1100,6 +1264,44 @@ Repository.prototype.getCommit = function(oid) {
   return Commit.lookup(repository, oid);
 };
 
+/**
+ * Retrieve an index with the generation number of every commit reachable
+ * from the references (1 for root commits, 1 + the highest generation of its
+ * parents otherwise).
+ * The index is built once and kept on the repository; it reflects the
+ * references at the time it was built, so pass `refresh` to rebuild it.
+ * The parents of the commits are read from the commit-graph file of the
+ * repository (written by `git commit-graph write` or `git maintenance`) when
+ * there is one, and from the object database otherwise; to always read them
+ * from the object database, use
+ * `repository.commitGraphIndex({ useCommitGraph: false })`.
+ *
+ * The index also answers batches of queries in parallel, without reading
+ * the repository again: `index.isAncestorBatch(ancestors, descendants)`
+ * resolves to a Uint8Array with 1 where the first commit is (or is an
+ * ancestor of) the second one, and `index.mergeBaseBatch(ones, twos)` to a
+ * Buffer of raw merge-base oids (zeros when there is none), to read with
+ * Revwalk.packedOidSha. The second argument can be a single commit, e.g. to
+ * find which branches are merged into main.
+ *
+ * @async
+ * @param {Boolean} refresh Rebuild the index instead of reusing it
+ * @return {CommitGraphIndex}
+ */
+Repository.prototype.getCommitGraphIndex = function(refresh) {
+  var repo = this;
+
+  if (!repo._commitGraphIndexPromise || refresh) {
+    repo._commitGraphIndexPromise = _commitGraphIndex.call(repo)
+      .catch(function(error) {
+        repo._commitGraphIndexPromise = null;
+        throw error;
+      });
+  }
+
+  return repo._commitGraphIndexPromise;
+};
+
 /**
  * Gets the branch that HEAD currently points to
  * Is an alias to head()
@@ -1190,6 +1392,67 @@ Repository.prototype.getReferenceNames = function(type) {
   return Repository.getReferences(this, type, true);
 };
 
+/**
+ * @typedef referenceListing
+ * @type {Object}
+ * @property {Number} count the number of references
+ * @property {Array<String>} names the full names of the references, sorted
+ * @property {Buffer} targets the raw oid of each reference, one after another
+ *                            (resolved for symbolic references), to read with
+ *                            Revwalk.packedOidSha
+ * @property {Array<String|null>} symbolicTargets the reference each symbolic
+ *                                                reference points to
+ */
+var listReferences = Repository.prototype.listReferences;
+/**
+ * Lists the references whose name starts with a prefix, such as
+ * "refs/heads/" or "refs/remotes/origin/", with their targets. packed-refs
+ * and the loose references are read directly, without looking each
+ * reference up, and only the part of packed-refs under the prefix is read.
+ *
+ * @async
+ * @param {String} prefix must start with "refs/"
+ * @return {referenceListing}
+ */
+Repository.prototype.listReferences = listReferences;
+
+/**
+ * @typedef reflogColumns
+ * @type {Object}
+ * @property {Number} count the number of entries, over every reflog
+ * @property {Uint32Array} refOffsets the entries of the reflog of names[i]
+ *                                    are from refOffsets[i] (inclusive) to
+ *                                    refOffsets[i + 1] (exclusive), newest
+ *                                    first
+ * @property {Buffer} oldIds the raw old oid of each entry, one after
+ *                           another, to read with Revwalk.packedOidSha
+ * @property {Buffer} newIds the raw new oid of each entry
+ * @property {Float64Array} times the date of each entry, in milliseconds
+ * @property {Int32Array} timezoneOffsets in minutes
+ * @property {Uint32Array} committerIndexes the position of the committer of
+ *                                          each entry in committers
+ * @property {Array<Object>} committers the distinct committers, with a name
+ *                                      and an email
+ * @property {Uint32Array} messageIndexes the position of the message of each
+ *                                        entry in messages
+ * @property {Array<String>} messages the distinct messages
+ */
+var readReflogs = Repository.prototype.readReflogs;
+/**
+ * Reads the reflogs of several references at once. The reflog files are read
+ * directly and from their end, so that only the newest entries of a long
+ * reflog are read when there is a limit. A reference without a reflog has no
+ * entries.
+ *
+ * @async
+ * @param {Array<String>} names the full names of the references
+ * @param {Object} options
+ * @param {Number} options.limit the number of newest entries to read from
+ *                               each reflog, all of them by default
+ * @return {reflogColumns}
+ */
+Repository.prototype.readReflogs = readReflogs;
+
 /**
  * Lookup references for a repository.
  *
@@ -1297,6 +1560,37 @@ Repository.prototype.getSubmoduleNames = function() {
   });
 };
 
+/**
+ * @typedef submoduleStatus
+ * @type {Object}
+ * @property {String} name
+ * @property {String} path
+ * @property {Number} status the Submodule.STATUS flags, as Submodule.status
+ *                           gives them
+ * @property {String|null} headId the commit of the submodule in HEAD
+ * @property {String|null} indexId the commit of the submodule in the index
+ * @property {String|null} workdirId the commit checked out in the submodule
+ */
+var getSubmoduleStatuses = Repository.prototype.getSubmoduleStatuses;
+/**
+ * Gets the status of all the submodules at once. The submodules are
+ * inspected in parallel, each thread opening the repository for itself, so
+ * that the working directories of many submodules are scanned at the same
+ * time.
+ *
+ * @async
+ * @param {Object} [options]
+ * @param {Submodule.IGNORE} [options.ignore] what changes to ignore, the
+ *                                            configuration of each submodule
+ *                                            by default
+ * @param {Number} [options.concurrency] how many submodules to inspect at a
+ *                                       time, the number of CPUs by default
+ * @return {Array<submoduleStatus>} in the order of Submodule.foreach
+ */
+Repository.prototype.getSubmoduleStatuses = function(options) {
+  return getSubmoduleStatuses.call(this, options || {});
+};
+
 /**
  * Retrieve the tag represented by the oid.
  *
@@ -1971,3 +2265,20 @@ Repository.prototype.treeBuilder = function() {
 
   return builder;
 };
+
+/**
+ * Watches HEAD, the references, the index and FETCH_HEAD of the repository, and
+ * calls back with the kinds of changes (see RepositoryWatcher.CHANGE) once the
+ * filesystem has been quiet for the debounce delay. Stop the watcher with
+ * watcher.stop(); until then it keeps the process alive, unless persistent is
+ * false.
+ *
+ * @param {Function} onChange called with an array of the changes
+ * @param {Object} [options]
+ * @param {Number} [options.debounce=100] ms without events before calling back
+ * @param {Boolean} [options.persistent=true]
+ * @return {RepositoryWatcher}
+ */
+Repository.prototype.watch = function(onChange, options) {
+  return new NodeGit.RepositoryWatcher(this, onChange, options);
+};
@@ -0,0 +1,17 @@
+var NodeGit = require("../");
+
+var RepositoryWatcher = NodeGit.RepositoryWatcher;
+
+/**
+ * The changes a RepositoryWatcher calls back with.
+ *
+ * @enum {String}
+ */
+RepositoryWatcher.CHANGE = {
+  // HEAD, ORIG_HEAD, MERGE_HEAD or CHERRY_PICK_HEAD
+  HEAD: "head",
+  // a loose reference or packed-refs
+  REFS: "refs",
+  INDEX: "index",
+  FETCH_HEAD: "fetchHead"
+};
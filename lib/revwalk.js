@@ -19,6 +19,10 @@ var _sorting = Revwalk.prototype.sorting;
  */
 var fileHistoryWalk = Revwalk.prototype.fileHistoryWalk;
 /**
+ * Uses the changed-path Bloom filters of the repository commit-graph, when
+ * it has one (`git commit-graph write --changed-paths`), to skip the commits
+ * that didn't change the path.
+ *
  * @param {String} filePath
  * @param {Number} max_count
  * @async
@@ -26,6 +30,216 @@ var fileHistoryWalk = Revwalk.prototype.fileHistoryWalk;
  */
 Revwalk.prototype.fileHistoryWalk = fileHistoryWalk;
 
+var fileHistoryWalkPaths = Revwalk.prototype.fileHistoryWalkPaths;
+/**
+ * Same as fileHistoryWalk for several paths at once, walking the history
+ * only once and sharing the tree lookups and diffs of each commit.
+ *
+ * Merges that don't change a path hide their other parents for that path
+ * only, so the walk itself is not changed: use Revwalk.SORT.TOPOLOGICAL to
+ * get the same results as fileHistoryWalk, and note that the commits hidden
+ * for every path still count towards maxCount.
+ *
+ * @param {Array<String>} filePaths
+ * @param {Number} maxCount
+ * @async
+ * @return {Object<String, Array<historyEntry>>} the history of each path
+ */
+Revwalk.prototype.fileHistoryWalkPaths = fileHistoryWalkPaths;
+
+/**
+ * Size in bytes of each oid in the Buffer returned by `fastWalkPacked`.
+ */
+Revwalk.PACKED_OID_SIZE = 20;
+
+var fastWalkPacked = Revwalk.prototype.fastWalkPacked;
+/**
+ * @param {Number} maxCount
+ * @async
+ * @return {Buffer} the raw oids of up to maxCount commits, one after another.
+ *                  Use Revwalk.packedOidCount, Revwalk.packedOidSha and
+ *                  Revwalk.packedOid to read it.
+ */
+Revwalk.prototype.fastWalkPacked = fastWalkPacked;
+
+/**
+ * Number of oids in a Buffer returned by `fastWalkPacked`.
+ *
+ * @param {Buffer} packedOids
+ * @return {Number}
+ */
+Revwalk.packedOidCount = function(packedOids) {
+  return Math.floor(packedOids.length / Revwalk.PACKED_OID_SIZE);
+};
+
+/**
+ * Hex sha of the oid at a position of a Buffer returned by `fastWalkPacked`.
+ *
+ * @param {Buffer} packedOids
+ * @param {Number} index
+ * @return {String}
+ */
+Revwalk.packedOidSha = function(packedOids, index) {
+  var start = index * Revwalk.PACKED_OID_SIZE;
+  return packedOids.toString("hex", start, start + Revwalk.PACKED_OID_SIZE);
+};
+
+/**
+ * Oid at a position of a Buffer returned by `fastWalkPacked`.
+ *
+ * @param {Buffer} packedOids
+ * @param {Number} index
+ * @return {Oid}
+ */
+Revwalk.packedOid = function(packedOids, index) {
+  return NodeGit.Oid.fromString(Revwalk.packedOidSha(packedOids, index));
+};
+
+/**
+ * @typedef commitColumns
+ * @type {Object}
+ * @property {Number} count the number of commits
+ * @property {Buffer} oids the raw oids of the commits, one after another
+ * @property {Uint32Array} parentOffsets the parents of commit i are the oids
+ *                                       from parentOffsets[i] (inclusive) to
+ *                                       parentOffsets[i + 1] (exclusive)
+ * @property {Buffer} parents the raw oids of the parents, one after another
+ * @property {Float64Array} authorTimes author dates, in milliseconds
+ * @property {Float64Array} committerTimes committer dates, in milliseconds
+ * @property {Buffer} strings UTF-8 strings of every commit, in the order
+ *                            of Revwalk.COLUMNAR_STRING_FIELDS
+ * @property {Uint32Array} stringOffsets byte offsets into strings, with
+ *                                       Revwalk.COLUMNAR_STRING_FIELDS.length
+ *                                       entries per commit, plus the end
+ */
+var commitWalk = Revwalk.prototype.commitWalk;
+/**
+ * @param {Number} maxCount
+ * @param {Object} options
+ * @param {Boolean} options.returnPlainObjects
+ * @param {Boolean} options.columnar if true, returns a commitColumns object
+ *                                   instead of an Array of commits
+ * @async
+ * @return {Array|commitColumns}
+ */
+Revwalk.prototype.commitWalk = commitWalk;
+
+/**
+ * Strings stored for each commit in the `strings` of a commitColumns object.
+ */
+Revwalk.COLUMNAR_STRING_FIELDS = [
+  "authorName",
+  "authorEmail",
+  "committerName",
+  "committerEmail",
+  "message"
+];
+
+/**
+ * Decodes one string of a commit of a commitColumns object.
+ *
+ * @param {commitColumns} columns
+ * @param {Number} index the position of the commit
+ * @param {String} field one of Revwalk.COLUMNAR_STRING_FIELDS
+ * @return {String}
+ */
+Revwalk.columnarString = function(columns, index, field) {
+  var fieldIndex = Revwalk.COLUMNAR_STRING_FIELDS.indexOf(field);
+  if (fieldIndex === -1) {
+    throw new Error("Unknown columnar string field: " + field);
+  }
+
+  var offset = index * Revwalk.COLUMNAR_STRING_FIELDS.length + fieldIndex;
+  return columns.strings.toString(
+    "utf8",
+    columns.stringOffsets[offset],
+    columns.stringOffsets[offset + 1]
+  );
+};
+
+/**
+ * Bits set in the `markers` of a graphLayoutPage for each commit.
+ */
+Revwalk.GRAPH_MARKERS = {
+  MERGE: 1,
+  FORK: 2,
+  TIP: 4,
+  ROOT: 8
+};
+
+/**
+ * @typedef graphLayoutPage
+ * @type {Object}
+ * @property {Number} count the number of commits (rows) laid out
+ * @property {Number} firstRow the row of the first commit, counting the rows
+ *                             of the previous pages
+ * @property {Buffer} oids the raw oids of the commits, one after another
+ * @property {Uint32Array} lanes the lane (column) of each commit
+ * @property {Uint8Array} markers Revwalk.GRAPH_MARKERS bits of each commit
+ * @property {Uint32Array} edges (fromRow, fromLane, toLane) triples, each a
+ *                               line from (fromRow, fromLane) to
+ *                               (fromRow + 1, toLane); the first ones may
+ *                               start on the last row of the previous page
+ * @property {Number} numLanes the width of the page, in lanes
+ * @property {Buffer} state pass to graphLayout to lay out the next page
+ */
+var graphLayout = Revwalk.prototype.graphLayout;
+/**
+ * Lays out the next commits of the walk as a history graph, each commit on
+ * a lane, with the lines joining them to their parents.
+ *
+ * Needs Revwalk.SORT.TOPOLOGICAL without Revwalk.SORT.REVERSE, so that
+ * children come before their parents: it fails with any other sorting.
+ * Parents are read from the commit-graph of the repository when it has one.
+ *
+ * @param {Number} maxCount
+ * @param {Buffer} state the state of the previous page of the same walk, if
+ *                       any
+ * @async
+ * @return {graphLayoutPage}
+ */
+Revwalk.prototype.graphLayout = function(maxCount, state) {
+  // libgit2 doesn't tell the sorting of a walk, see Revwalk#sorting
+  var sorting = this._sortMode || Revwalk.SORT.NONE;
+  if (!(sorting & Revwalk.SORT.TOPOLOGICAL) ||
+      (sorting & Revwalk.SORT.REVERSE)) {
+    return Promise.reject(new Error(
+      "graphLayout needs Revwalk.SORT.TOPOLOGICAL without " +
+      "Revwalk.SORT.REVERSE."
+    ));
+  }
+
+  return graphLayout.call(this, maxCount, state);
+};
+
+var searchWalk = Revwalk.prototype.searchWalk;
+/**
+ * Walks until maxCount commits match the search, like `git log --grep`,
+ * `--author`, `--committer`, `--since`, `--until` and `--merges`. Commits are
+ * matched without being parsed; the walk can be resumed with another call.
+ *
+ * Patterns are substrings or RegExps (ECMAScript syntax, with no flags other
+ * than `i` and `g`: searchWalk fails on the others, as on lookbehinds).
+ * RegExps are only searched in the first 8 KB of the message, or 1 KB when
+ * they have back-references. author and committer match "Name <email>".
+ *
+ * @param {Number} maxCount the number of matching commits to return
+ * @param {Object} options
+ * @param {String|RegExp} options.grep pattern of the commit message
+ * @param {String|RegExp} options.author pattern of the author
+ * @param {String|RegExp} options.committer pattern of the committer
+ * @param {Boolean} options.ignoreCase for String patterns (ASCII only)
+ * @param {Date|Number} options.since earliest committer date, inclusive
+ * @param {Date|Number} options.until latest committer date, inclusive
+ * @param {Boolean} options.merges true for merge commits only, false for
+ *                                 non-merge commits only
+ * @param {Boolean} options.returnPlainObjects as in commitWalk
+ * @param {Boolean} options.columnar as in commitWalk
+ * @async
+ * @return {Array|commitColumns}
+ */
+Revwalk.prototype.searchWalk = searchWalk;
+
 /**
  * Get a number of commits.
  *
@@ -103,6 +317,7 @@ Revwalk.prototype.sorting = function() {
     sort |= arguments[i];
   }
 
+  this._sortMode = sort;
   _sorting.call(this, sort);
 };
 
@@ -140,3 +355,252 @@ Revwalk.prototype.walk = function(oid, callback) {
 
   walk();
 };
+
+function commitSha(commit) {
+  return typeof commit.sha === "function" ? commit.sha() : commit.sha;
+}
+
+function resolveCursorOids(repo, specs) {
+  return Promise.all(specs.map(function(spec) {
+    if (spec instanceof NodeGit.Oid) {
+      return spec;
+    }
+
+    if (/^[0-9a-f]{40}$/i.test(spec)) {
+      return NodeGit.Oid.fromString(spec);
+    }
+
+    return NodeGit.Reference.nameToId(repo, spec);
+  }))
+  .then(function(oids) {
+    return oids.map(function(oid) {
+      return oid.toString();
+    });
+  });
+}
+
+/**
+ * Paginated walk over the history. The underlying walk is kept alive between
+ * pages, and the next page is fetched on the thread pool while the current
+ * one is being used. `checkpoint()` returns a serializable position that
+ * `Revwalk.resumeCursor` can continue from once this cursor is gone.
+ *
+ * Either iterate it with `for await (const commit of cursor)` or call
+ * `nextPage()`, but don't mix both on the same cursor.
+ *
+ * Use `Revwalk.createCursor` to get one.
+ *
+ * @class
+ */
+function RevwalkCursor(repo, state) {
+  this.repo = repo;
+  this._state = state;
+  this._walker = null;
+  this._prefetched = null;
+  this._exhausted = false;
+  this._queue = Promise.resolve();
+}
+
+/**
+ * @typedef revwalkCursorCheckpoint
+ * @type {Object}
+ * @property {Array<String>} push shas the walk started from
+ * @property {Array<String>} hide shas hidden from the walk
+ * @property {Number} sorting Revwalk.SORT flags
+ * @property {Number} pageSize
+ * @property {Boolean} returnPlainObjects
+ * @property {Number} emitted number of commits returned so far
+ * @property {String} lastSha sha of the last commit returned, if any
+ */
+
+/**
+ * @return {revwalkCursorCheckpoint}
+ */
+RevwalkCursor.prototype.checkpoint = function() {
+  return JSON.parse(JSON.stringify(this._state));
+};
+
+/**
+ * Get the next page of commits. An empty page means the walk is over.
+ *
+ * @async
+ * @return {Array<Commit|Object>} Commits, or plain objects when the cursor
+ *                                was created with `returnPlainObjects`
+ */
+RevwalkCursor.prototype.nextPage = function() {
+  var cursor = this;
+
+  return cursor._takePage().then(function(commits) {
+    if (commits.length) {
+      cursor._state.emitted += commits.length;
+      cursor._state.lastSha = commitSha(commits[commits.length - 1]);
+    }
+
+    return commits;
+  });
+};
+
+RevwalkCursor.prototype[Symbol.asyncIterator] = function() {
+  var cursor = this;
+  var page = [];
+  var index = 0;
+
+  function emit() {
+    var commit = page[index++];
+    cursor._state.emitted++;
+    cursor._state.lastSha = commitSha(commit);
+    return { value: commit, done: false };
+  }
+
+  return {
+    next: function() {
+      if (index < page.length) {
+        return Promise.resolve(emit());
+      }
+
+      return cursor._takePage().then(function(nextPage) {
+        page = nextPage;
+        index = 0;
+        return page.length ? emit() : { value: undefined, done: true };
+      });
+    }
+  };
+};
+
+// Returns the next page, without counting it as emitted, and starts
+// prefetching the following one. Calls are serialized, as they share a walk.
+RevwalkCursor.prototype._takePage = function() {
+  var cursor = this;
+
+  var page = cursor._queue.then(function() {
+    if (cursor._prefetched) {
+      var prefetched = cursor._prefetched;
+      cursor._prefetched = null;
+      return prefetched;
+    }
+
+    return cursor._fetchPage();
+  })
+  .then(function(commits) {
+    if (!cursor._exhausted) {
+      cursor._prefetched = cursor._fetchPage();
+      // a failed prefetch is reported by the call that uses it
+      cursor._prefetched.catch(function() {});
+    }
+
+    return commits;
+  });
+
+  cursor._queue = page.catch(function() {});
+  return page;
+};
+
+RevwalkCursor.prototype._fetchPage = function() {
+  var cursor = this;
+  var state = cursor._state;
+
+  if (cursor._exhausted) {
+    return Promise.resolve([]);
+  }
+
+  var walkerPromise = cursor._walker ?
+    Promise.resolve(cursor._walker) :
+    cursor._openWalker();
+
+  return walkerPromise.then(function(walker) {
+    return walker.commitWalk(state.pageSize, {
+      returnPlainObjects: state.returnPlainObjects
+    });
+  })
+  .then(function(commits) {
+    if (commits.length < state.pageSize) {
+      cursor._exhausted = true;
+    }
+
+    return commits;
+  });
+};
+
+// Creates the walk from the state, skipping the commits already emitted,
+// and checks the history didn't change since they were.
+RevwalkCursor.prototype._openWalker = function() {
+  var cursor = this;
+  var state = cursor._state;
+  var walker = cursor.repo.createRevWalk();
+
+  walker.sorting(state.sorting);
+  state.push.forEach(function(sha) {
+    walker.push(NodeGit.Oid.fromString(sha));
+  });
+  state.hide.forEach(function(sha) {
+    walker.hide(NodeGit.Oid.fromString(sha));
+  });
+
+  var skip = state.emitted ?
+    walker.fastWalkPacked(state.emitted) :
+    Promise.resolve(null);
+
+  return skip.then(function(skipped) {
+    if (skipped) {
+      var count = Revwalk.packedOidCount(skipped);
+      if (count !== state.emitted ||
+          Revwalk.packedOidSha(skipped, count - 1) !== state.lastSha) {
+        throw new Error(
+          "Cannot resume the walk: the history changed since the checkpoint"
+        );
+      }
+    }
+
+    cursor._walker = walker;
+    return walker;
+  });
+};
+
+Revwalk.Cursor = RevwalkCursor;
+
+/**
+ * Create a paginated, resumable walk. See RevwalkCursor.
+ *
+ * @async
+ * @param {Repository} repo
+ * @param {Object} options
+ * @param {Array<String|Oid>} options.push shas or reference names to walk
+ *                                         from (default: ["HEAD"])
+ * @param {Array<String|Oid>} options.hide shas or reference names to hide
+ * @param {Number} options.sorting Revwalk.SORT flags (default: NONE)
+ * @param {Number} options.pageSize commits per page (default: 100)
+ * @param {Boolean} options.returnPlainObjects as in commitWalk
+ * @return {RevwalkCursor}
+ */
+Revwalk.createCursor = function(repo, options) {
+  options = options || {};
+
+  return Promise.all([
+    resolveCursorOids(repo, [].concat(options.push || "HEAD")),
+    resolveCursorOids(repo, [].concat(options.hide || []))
+  ])
+  .then(function(oids) {
+    return new RevwalkCursor(repo, {
+      push: oids[0],
+      hide: oids[1],
+      sorting: options.sorting || Revwalk.SORT.NONE,
+      pageSize: options.pageSize || 100,
+      returnPlainObjects: !!options.returnPlainObjects,
+      emitted: 0,
+      lastSha: null
+    });
+  });
+};
+
+/**
+ * Continue a walk from a checkpoint of a RevwalkCursor. The references are
+ * not resolved again, so the walk continues from the same commits. Fails if
+ * the commits emitted before the checkpoint are not walked in the same order.
+ *
+ * @param {Repository} repo
+ * @param {revwalkCursorCheckpoint} checkpoint
+ * @return {RevwalkCursor}
+ */
+Revwalk.resumeCursor = function(repo, checkpoint) {
+  return new RevwalkCursor(repo, JSON.parse(JSON.stringify(checkpoint)));
+};
@@ -29,6 +29,231 @@ describe("Graph", function() {
     });
   });
 
+  it("can get commits ahead/behind for many pairs at once", function() {
+    var repository = this.repository;
+    var locals = [
+      "32789a79e71fbc9e04d3eff7425e1771eb595150",
+      "1729c73906bb8467f4095c2f4044083016b4dfde",
+      "32789a79e71fbc9e04d3eff7425e1771eb595150",
+      "e0aeedcff0584ebe00aed2c03c8ecd10839df908"
+    ];
+    var upstreams = [
+      "1729c73906bb8467f4095c2f4044083016b4dfde",
+      "32789a79e71fbc9e04d3eff7425e1771eb595150",
+      "e0aeedcff0584ebe00aed2c03c8ecd10839df908",
+      "e0aeedcff0584ebe00aed2c03c8ecd10839df908"
+    ];
+
+    return Graph.aheadBehindBatch(repository, locals, upstreams)
+      .then(function(result) {
+        assert.ok(result.ahead instanceof Uint32Array);
+        assert.equal(result.ahead.length, locals.length);
+        assert.equal(result.behind.length, locals.length);
+
+        return Promise.all(locals.map(function(local, i) {
+          return Graph.aheadBehind(repository, local, upstreams[i])
+            .then(function(expected) {
+              assert.equal(result.ahead[i], expected.ahead);
+              assert.equal(result.behind[i], expected.behind);
+            });
+        }));
+      });
+  });
+
+  it("counts ahead/behind exactly with out of order commit dates", function() {
+    var repository = this.repository;
+    var Signature = NodeGit.Signature;
+    var shas = {};
+
+    function commit(name, time, parents) {
+      var signature = Signature.create(
+        "Skewed Clock",
+        "skewed@example.com",
+        1500000000 + time,
+        0
+      );
+      return repository.getHeadCommit()
+        .then(function(headCommit) {
+          return repository.createCommit(
+            null,
+            signature,
+            signature,
+            name,
+            headCommit.treeId(),
+            parents.map(function(parent) {
+              return shas[parent];
+            })
+          );
+        })
+        .then(function(oid) {
+          shas[name] = oid.toString();
+        });
+    }
+
+    // commits reachable from the first sha and not from the second one
+    function exclusiveCount(sha, otherSha) {
+      function reachable(start) {
+        var seen = {};
+        function visit(sha) {
+          if (seen[sha]) {
+            return Promise.resolve();
+          }
+          seen[sha] = true;
+          return repository.getCommit(sha)
+            .then(function(commit) {
+              return Promise.all(commit.parentcount() === 0 ? [] :
+                commit.parents().map(function(parent) {
+                  return visit(parent.toString());
+                }));
+            });
+        }
+        return visit(start).then(function() {
+          return seen;
+        });
+      }
+
+      return Promise.all([reachable(sha), reachable(otherSha)])
+        .then(function(sets) {
+          return Object.keys(sets[0]).filter(function(sha) {
+            return !sets[1][sha];
+          }).length;
+        });
+    }
+
+    // root is older than its descendants "middle" and "ahead", but newer than
+    // "late": it is visited from the local side before "late" reaches it
+    return commit("root", 1200, [])
+      .then(function() {
+        return commit("middle", 4100, ["root"]);
+      })
+      .then(function() {
+        return commit("late", 100, ["middle"]);
+      })
+      .then(function() {
+        return commit("ahead", 5000, ["root"]);
+      })
+      .then(function() {
+        var locals = [shas.root, shas.ahead, shas.late];
+        var upstreams = [shas.late, shas.late, shas.root];
+
+        return Graph.aheadBehindBatch(repository, locals, upstreams)
+          .then(function(result) {
+            assert.deepEqual(Array.from(result.ahead), [0, 1, 2]);
+            assert.deepEqual(Array.from(result.behind), [2, 2, 0]);
+
+            return Promise.all(locals.map(function(local, i) {
+              return Promise.all([
+                exclusiveCount(local, upstreams[i]),
+                exclusiveCount(upstreams[i], local)
+              ])
+                .then(function(expected) {
+                  assert.equal(result.ahead[i], expected[0]);
+                  assert.equal(result.behind[i], expected[1]);
+                });
+            }));
+          });
+      });
+  });
+
+  it("stops at the merge base of diverged commits without a commit-graph",
+    function() {
+      var repository = this.repository;
+      var Signature = NodeGit.Signature;
+      var headCommit;
+
+      function commit(message, secondsAfterHead, parentOid) {
+        var signature = Signature.create(
+          "Diverged Branch",
+          "diverged@example.com",
+          headCommit.time() + secondsAfterHead,
+          0
+        );
+        return repository.createCommit(
+          null,
+          signature,
+          signature,
+          message,
+          headCommit.treeId(),
+          [parentOid]
+        );
+      }
+
+      return repository.getHeadCommit()
+        .then(function(commit_) {
+          headCommit = commit_;
+          return commit("base", 60, headCommit.id());
+        })
+        .then(function(baseOid) {
+          return Promise.all([
+            commit("local", 120, baseOid),
+            commit("upstream", 180, baseOid)
+          ]);
+        })
+        .then(function(oids) {
+          return Graph.aheadBehindBatch(repository, [oids[0]], [oids[1]], {
+            useCommitGraph: false
+          });
+        })
+        .then(function(result) {
+          assert.equal(result.ahead[0], 1);
+          assert.equal(result.behind[0], 1);
+          // local, upstream and base: none of the history of HEAD is read
+          assert.equal(result.visitedCommits, 3);
+        });
+    });
+
+  it("doesn't walk the history of pairs left behind by unrelated pairs",
+    function() {
+      var repository = this.repository;
+      var Signature = NodeGit.Signature;
+      var headCommit;
+
+      function commit(message, secondsAfterHead, parentOids) {
+        var signature = Signature.create(
+          "Unrelated Histories",
+          "unrelated@example.com",
+          headCommit.time() + secondsAfterHead,
+          0
+        );
+        return repository.createCommit(
+          null,
+          signature,
+          signature,
+          message,
+          headCommit.treeId(),
+          parentOids
+        );
+      }
+
+      var locals = [];
+      var upstreams = [];
+      return repository.getHeadCommit()
+        .then(function(commit_) {
+          headCommit = commit_;
+          return commit("unrelated root", 60, []);
+        })
+        .then(function(rootOid) {
+          upstreams.push(headCommit.id(), rootOid);
+          return Promise.all([
+            commit("ahead of HEAD", 120, [headCommit.id()]),
+            commit("ahead of the unrelated root", 100, [rootOid])
+          ]);
+        })
+        .then(function(oids) {
+          locals = oids;
+          return Graph.aheadBehindBatch(repository, locals, upstreams, {
+            useCommitGraph: false
+          });
+        })
+        .then(function(result) {
+          assert.deepEqual(Array.from(result.ahead), [1, 1]);
+          assert.deepEqual(Array.from(result.behind), [0, 0]);
+          // the four tips only: the history of HEAD is never reachable from
+          // both commits of the second pair
+          assert.equal(result.visitedCommits, 4);
+        });
+    });
+
   it("can tell if a commit is a descendant of another", function() {
     return Graph.descendantOf(
       this.repository,
@@ -140,6 +140,45 @@ describe("Remote", function() {
       });
   });
 
+  it("can get the remotes again once the config changed", function() {
+    var repository = this.repository;
+
+    function remoteNames(remotes) {
+      return remotes.map(function(remote) {
+        return remote.name();
+      });
+    }
+
+    return repository.getRemotes()
+      .then(function(remotes) {
+        assert.deepEqual(remoteNames(remotes), ["origin"]);
+
+        return repository.getRemotes();
+      })
+      .then(function(remotes) {
+        // the cached remotes are duplicated for each call
+        assert.deepEqual(remoteNames(remotes), ["origin"]);
+        assert.equal(remotes[0].url().replace(".git", ""), url);
+
+        return Remote.create(repository, "origin4", url2);
+      })
+      .then(function() {
+        return repository.getRemotes();
+      })
+      .then(function(remotes) {
+        assert.deepEqual(remoteNames(remotes), ["origin", "origin4"]);
+        assert.equal(remotes[1].url(), url2);
+
+        return Remote.delete(repository, "origin4");
+      })
+      .then(function() {
+        return repository.getRemotes();
+      })
+      .then(function(remotes) {
+        assert.deepEqual(remoteNames(remotes), ["origin"]);
+      });
+  });
+
   it("can download from a remote", function() {
     var repo = this.repository;
     var remoteCallbacks;
@@ -344,6 +383,63 @@ describe("Remote", function() {
       });
   });
 
+  it("can fetch from all remotes concurrently", function() {
+    var repository = this.repository;
+    var progressCalls = 0;
+
+    return Remote.create(repository, "bare", bareReposPath)
+      .then(function() {
+        return Remote.create(repository, "self", "file://" + reposPath);
+      })
+      .then(function() {
+        return repository.fetchAll({
+          callbacks: {
+            certificateCheck: () => 0
+          }
+        }, {
+          concurrency: 2,
+          transferProgress: function(progress) {
+            progressCalls++;
+            assert.ok(progress.receivedObjects <= progress.totalObjects);
+          }
+        });
+      })
+      .then(function() {
+        assert.ok(progressCalls > 0);
+
+        return Promise.all([
+          repository.getReference("refs/remotes/bare/master"),
+          repository.getReference("refs/remotes/self/master")
+        ]);
+      })
+      .then(function(references) {
+        assert.equal(references.length, 2);
+      });
+  });
+
+  it("stops fetching from remotes once one failed", function() {
+    var repository = this.repository;
+
+    // remotes are fetched from in the order of their names
+    return Remote.create(repository, "a-missing", local("../repos/missing"))
+      .then(function() {
+        return Remote.create(repository, "b-bare", bareReposPath);
+      })
+      .then(function() {
+        return repository.fetchAll();
+      })
+      .then(function() {
+        assert.fail("fetchAll should have failed");
+      }, function() {
+        return repository.getReference("refs/remotes/b-bare/master");
+      })
+      .then(function() {
+        assert.fail("b-bare should not have been fetched from");
+      }, function(error) {
+        assert.equal(error.errno, NodeGit.Error.CODE.ENOTFOUND);
+      });
+  });
+
   if (!isNode8) {
     it("will reject if credentials promise rejects", function() {
       var repo = this.repository;
@@ -612,6 +708,46 @@ describe("Remote", function() {
       });
   });
 
+  it("can list the references under prefixes from the cache", function() {
+    var options = { prefixes: ["refs/tags/"], cacheTtl: 60000 };
+    var remote;
+
+    function names(remoteHeads) {
+      return remoteHeads.map(function(remoteHead) {
+        return remoteHead.name();
+      }).sort();
+    }
+
+    return Remote.createAnonymous(this.repository, "file://" + reposPath)
+      .then(function(anonymousRemote) {
+        remote = anonymousRemote;
+        return remote.connect(NodeGit.Enums.DIRECTION.FETCH);
+      })
+      .then(function() {
+        return remote.referenceList(options);
+      })
+      .then(function(remoteHeads) {
+        var tagNames = names(remoteHeads);
+        assert.ok(tagNames.indexOf("refs/tags/annotated-tag") !== -1);
+        assert.ok(tagNames.indexOf("refs/tags/light-weight-tag") !== -1);
+        tagNames.forEach(function(name) {
+          assert.equal(name.indexOf("refs/tags/"), 0);
+        });
+
+        return remote.disconnect()
+          .then(function() {
+            // the same listing within the ttl doesn't need the connection
+            return remote.referenceList({
+              prefixes: ["refs/tags/"],
+              cacheTtl: 60000
+            });
+          })
+          .then(function(cachedRemoteHeads) {
+            assert.deepEqual(names(cachedRemoteHeads), tagNames);
+          });
+      });
+  });
+
   it("will error when retrieving reference list if not connected", function() {
     return this.repository.getRemote("origin")
       .then(function(remote) {
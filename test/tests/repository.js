@@ -4,6 +4,7 @@ var fse = require("fs-extra");
 var local = path.join.bind(path, __dirname);
 var IndexUtils = require("../utils/index_setup");
 var RepoUtils = require("../utils/repository_setup");
+var exec = require("../../utils/execPromise");
 
 describe("Repository", function() {
   var NodeGit = require("../../");
@@ -391,4 +392,643 @@ describe("Repository", function() {
       // console.log(JSON.stringify(analysisReport,null,2));
     });
   });
+
+  it("can check statistics limits quickly", function() {
+    var repo = this.constRepository;
+
+    return repo.statistics({ limits: { blobSize: 1000000 } })
+      .then(function(analysisReport) {
+        assert.equal(analysisReport.partial, false);
+        assert.deepEqual(analysisReport.limitsExceeded, ["blobSize"]);
+
+        return repo.statistics({
+          limits: { blobSize: 1e9, treeEntries: 1e6, historyDepth: 1e6 }
+        });
+      })
+      .then(function(analysisReport) {
+        assert.equal(analysisReport.partial, false);
+        assert.deepEqual(analysisReport.limitsExceeded, []);
+        assert.deepEqual(
+          analysisReport.limitsChecked,
+          ["blobSize", "treeEntries", "historyDepth"]
+        );
+        // the whole object database is counted, reachable or not
+        assert.ok(analysisReport.repositorySize.commits.count >= 992);
+        assert.ok(analysisReport.biggestObjects.blobs.maxSize >= 1077756);
+
+        return repo.statistics({
+          limits: { historyDepth: 10 },
+          budget: { objects: 10 }
+        });
+      })
+      .then(function(analysisReport) {
+        assert.equal(analysisReport.partial, true);
+        assert.deepEqual(analysisReport.limitsExceeded, []);
+      });
+  });
+
+  it("can build a commit graph index with generation numbers", function() {
+    var repo = this.constRepository;
+    var index;
+
+    return repo.getCommitGraphIndex()
+      .then(function(_index) {
+        index = _index;
+
+        // same commits and depth as the statistics of the repository
+        assert.equal(index.count(), 992);
+        assert.equal(index.maxGeneration(), 931);
+
+        return repo.getCommitGraphIndex();
+      })
+      .then(function(cachedIndex) {
+        assert.strictEqual(cachedIndex, index);
+
+        return repo.getHeadCommit();
+      })
+      .then(function(headCommit) {
+        var generation = index.generation(headCommit.id());
+        assert.ok(generation > 0);
+        assert.equal(index.generation(headCommit.sha()), generation);
+
+        headCommit.parents().forEach(function(parentId) {
+          assert.ok(index.generation(parentId) < generation);
+        });
+
+        assert.equal(
+          index.generation("0000000000000000000000000000000000000000"), 0);
+      });
+  });
+
+  it("can answer batches of ancestry queries with a commit graph index",
+  function() {
+    var repo = this.constRepository;
+    var index;
+    var headSha;
+    var shas;
+
+    return Promise.all([repo.getCommitGraphIndex(), repo.getHeadCommit()])
+      .then(function(results) {
+        index = results[0];
+        headSha = results[1].sha();
+
+        var walker = repo.createRevWalk();
+        walker.sorting(NodeGit.Revwalk.SORT.TOPOLOGICAL);
+        walker.pushHead();
+        return walker.fastWalk(400);
+      })
+      .then(function(oids) {
+        shas = oids.map(function(oid) {
+          return oid.tostrS();
+        });
+        var unknownSha = "0000000000000000000000000000000000000000";
+
+        return Promise.all([
+          index.isAncestorBatch(shas, headSha),
+          index.isAncestorBatch([headSha, headSha, unknownSha], shas.slice(0, 3)),
+          index.mergeBaseBatch(shas.slice(0, 10), shas.slice(390, 400))
+        ]);
+      })
+      .then(function(results) {
+        var allMerged = results[0];
+        var headMerged = results[1];
+        var mergeBases = results[2];
+
+        assert.ok(allMerged instanceof Uint8Array);
+        assert.equal(allMerged.length, shas.length);
+        assert.ok(allMerged.every(function(isAncestor) {
+          return isAncestor === 1;
+        }));
+        assert.deepEqual(Array.from(headMerged), [1, 0, 0]);
+
+        assert.equal(mergeBases.length, 10 * NodeGit.Revwalk.PACKED_OID_SIZE);
+        return Promise.all(shas.slice(0, 10).map(function(sha, i) {
+          return NodeGit.Merge.base(repo, sha, shas[390 + i])
+            .then(function(mergeBase) {
+              assert.equal(
+                NodeGit.Revwalk.packedOidSha(mergeBases, i),
+                mergeBase.tostrS()
+              );
+            });
+        }));
+      });
+  });
+
+  it("can build a commit graph index from a commit-graph file", function() {
+    var repo = this.constRepository;
+    var infoPath = path.join(constReposPath, ".git", "objects", "info");
+
+    function removeCommitGraph() {
+      return Promise.all([
+        fse.remove(path.join(infoPath, "commit-graph")),
+        fse.remove(path.join(infoPath, "commit-graphs"))
+      ]);
+    }
+
+    return exec("git commit-graph write --reachable", { cwd: constReposPath })
+      .then(function() {
+        return Promise.all([
+          repo.commitGraphIndex({ useCommitGraph: true }),
+          repo.commitGraphIndex({ useCommitGraph: false }),
+          repo.getHeadCommit()
+        ]);
+      })
+      .then(function(results) {
+        var fromCommitGraph = results[0];
+        var fromOdb = results[1];
+        var headCommit = results[2];
+
+        assert.equal(fromCommitGraph.count(), 992);
+        assert.equal(fromCommitGraph.maxGeneration(), 931);
+        assert.equal(fromOdb.count(), fromCommitGraph.count());
+        assert.equal(
+          fromCommitGraph.generation(headCommit.id()),
+          fromOdb.generation(headCommit.id())
+        );
+      })
+      .then(removeCommitGraph, function(error) {
+        return removeCommitGraph().then(function() {
+          throw error;
+        });
+      });
+  });
+
+  it("can build a commit graph index of a shallow clone", function() {
+    var shallowRepoPath = local("../repos/shallow");
+    var count;
+
+    function removeShallowClone() {
+      return fse.remove(shallowRepoPath);
+    }
+
+    return removeShallowClone()
+      .then(function() {
+        return exec(
+          "git clone --depth 2 \"file://" + constReposPath + "\" \"" +
+            shallowRepoPath + "\""
+        );
+      })
+      .then(function() {
+        return exec("git rev-list --all --count", { cwd: shallowRepoPath });
+      })
+      .then(function(stdout) {
+        count = parseInt(stdout, 10);
+        return Repository.open(shallowRepoPath);
+      })
+      .then(function(shallowRepo) {
+        // the parents of the oldest commits are not in the clone
+        return shallowRepo.commitGraphIndex({ useCommitGraph: false });
+      })
+      .then(function(index) {
+        assert.ok(count > 0);
+        assert.equal(index.count(), count);
+        assert.equal(index.maxGeneration(), 2);
+      })
+      .then(removeShallowClone, function(error) {
+        return removeShallowClone().then(function() {
+          throw error;
+        });
+      });
+  });
+
+  it("can refresh only the references changed since a token", function() {
+    var repo = this.repository;
+    var branchName = "refresh-references-token";
+    var branchFullName = "refs/heads/" + branchName;
+    var fullRefresh;
+    var tokenWithBranch;
+
+    function fullNames(refs) {
+      return refs.map(function(ref) {
+        return ref.fullName;
+      });
+    }
+
+    return repo.refreshReferences()
+      .then(function(result) {
+        fullRefresh = result;
+        assert.ok(Buffer.isBuffer(result.changeToken));
+        assert.deepEqual(result.removedRefs, []);
+
+        return repo.refreshReferences(null, result.changeToken);
+      })
+      .then(function(result) {
+        // HEAD is always there
+        assert.deepEqual(fullNames(result.refs), [fullRefresh.headRefFullName]);
+        assert.deepEqual(result.upstreamInfo, []);
+        assert.deepEqual(result.removedRefs, []);
+        assert.deepEqual(result.removedUpstreamInfo, []);
+
+        return repo.getHeadCommit();
+      })
+      .then(function(headCommit) {
+        return repo.createBranch(branchName, headCommit, true);
+      })
+      .then(function(branch) {
+        return repo.refreshReferences(null, fullRefresh.changeToken)
+          .then(function(result) {
+            assert.deepEqual(
+              fullNames(result.refs),
+              [fullRefresh.headRefFullName, branchFullName]
+            );
+            assert.equal(result.refs[1].sha, fullRefresh.refs[0].sha);
+            tokenWithBranch = result.changeToken;
+
+            return NodeGit.Branch.delete(branch);
+          });
+      })
+      .then(function() {
+        return repo.refreshReferences("gpgsig", tokenWithBranch);
+      })
+      .then(function(result) {
+        assert.deepEqual(fullNames(result.refs), [fullRefresh.headRefFullName]);
+        assert.deepEqual(result.removedRefs, [branchFullName]);
+        assert.deepEqual(result.changeToken, fullRefresh.changeToken);
+
+        return repo.refreshReferences(null, Buffer.from("not a token"));
+      })
+      .then(function() {
+        assert.fail("refreshReferences should have rejected the token");
+      }, function(error) {
+        assert.ok(/not a valid refreshReferences token/.test(error.message));
+      });
+  });
+
+  it("returns the previous branch of HEAD after a checkout", function() {
+    var repo = this.repository;
+    var branchName = "refresh-references-checkout";
+    var branchFullName = "refs/heads/" + branchName;
+    var fullRefresh;
+
+    function fullNames(refs) {
+      return refs.map(function(ref) {
+        return ref.fullName;
+      });
+    }
+
+    return repo.getHeadCommit()
+      .then(function(headCommit) {
+        return repo.createBranch(branchName, headCommit, true);
+      })
+      .then(function() {
+        return repo.refreshReferences();
+      })
+      .then(function(result) {
+        fullRefresh = result;
+        assert.notEqual(fullRefresh.headRefFullName, branchFullName);
+
+        return repo.checkoutBranch(branchName);
+      })
+      .then(function() {
+        return repo.refreshReferences(null, fullRefresh.changeToken);
+      })
+      .then(function(result) {
+        // the new branch of HEAD replaces its entry, the previous one is a ref again
+        assert.equal(result.headRefFullName, branchFullName);
+        assert.deepEqual(
+          fullNames(result.refs),
+          [branchFullName, fullRefresh.headRefFullName]
+        );
+        assert.deepEqual(result.removedRefs, []);
+
+        return repo.checkoutBranch(fullRefresh.headRefFullName);
+      })
+      .then(function() {
+        return repo.getBranch(branchName);
+      })
+      .then(function(branch) {
+        return NodeGit.Branch.delete(branch);
+      })
+      .then(function() {
+        return repo.refreshReferences(null, fullRefresh.changeToken);
+      })
+      .then(function(result) {
+        assert.deepEqual(fullNames(result.refs), [fullRefresh.headRefFullName]);
+        assert.deepEqual(result.removedRefs, [branchFullName]);
+      });
+  });
+
+  it("reports the same tags when refreshing again", function() {
+    var repo = this.repository;
+    var tagFullName = "refs/tags/annotated-tag";
+
+    function findTag(result) {
+      return result.refs.filter(function(ref) {
+        return ref.fullName === tagFullName;
+      })[0];
+    }
+
+    return repo.refreshReferences()
+      .then(function(result) {
+        var tag = findTag(result);
+        assert.equal(tag.type, "tag");
+        assert.equal(tag.sha, "32789a79e71fbc9e04d3eff7425e1771eb595150");
+        assert.equal(tag.message, "This is an annotated tag\n");
+        assert.equal(tag.tagSignature, null);
+
+        // the second time the tag is read from the cache
+        return repo.refreshReferences("x509")
+          .then(function(cachedResult) {
+            assert.deepEqual(findTag(cachedResult), tag);
+          });
+      });
+  });
+
+  it("can list the references under a prefix", function() {
+    var repo = this.repository;
+    var Reference = NodeGit.Reference;
+    var Revwalk = NodeGit.Revwalk;
+
+    function expectedReferences(prefix) {
+      return Reference.list(repo)
+        .then(function(names) {
+          names = names.filter(function(name) {
+            return name.indexOf(prefix) === 0;
+          }).sort();
+
+          return Promise.all(names.map(function(name) {
+            return Reference.nameToId(repo, name);
+          }))
+            .then(function(oids) {
+              return names.map(function(name, i) {
+                return name + " " + oids[i].toString();
+              });
+            });
+        });
+    }
+
+    function listedReferences(listing) {
+      return listing.names.map(function(name, i) {
+        return name + " " + Revwalk.packedOidSha(listing.targets, i);
+      });
+    }
+
+    return Promise.all(["refs/heads/", "refs/tags/", "refs/"].map(
+      function(prefix) {
+        return Promise.all([
+          repo.listReferences(prefix),
+          expectedReferences(prefix)
+        ])
+          .then(function(results) {
+            assert.equal(results[0].count, results[1].length);
+            assert.deepEqual(listedReferences(results[0]), results[1]);
+          });
+      }
+    ))
+      .then(function() {
+        return repo.listReferences("heads/");
+      })
+      .then(function() {
+        assert.fail("listReferences should have rejected the prefix");
+      }, function(error) {
+        assert.ok(/must start with 'refs\/'/.test(error.message));
+      });
+  });
+
+  it("can read the reflogs of several references", function() {
+    var repo = this.repository;
+    var Reflog = NodeGit.Reflog;
+    var Revwalk = NodeGit.Revwalk;
+    var names = ["HEAD", "refs/heads/master", "refs/heads/no-such-branch"];
+
+    function expectedEntries(name, limit) {
+      return Reflog.read(repo, name)
+        .then(function(reflog) {
+          var count = Math.min(reflog.entrycount(), limit || Infinity);
+          var entries = [];
+          for (var i = 0; i < count; ++i) {
+            var entry = reflog.entryByIndex(i);
+            entries.push([
+              entry.idOld().toString(),
+              entry.idNew().toString(),
+              entry.committer().name(),
+              entry.committer().when().time() * 1000,
+              entry.message() || ""
+            ]);
+          }
+          return entries;
+        });
+    }
+
+    function readEntries(columns, refIndex) {
+      var entries = [];
+      for (
+        var i = columns.refOffsets[refIndex];
+        i < columns.refOffsets[refIndex + 1];
+        ++i
+      ) {
+        entries.push([
+          Revwalk.packedOidSha(columns.oldIds, i),
+          Revwalk.packedOidSha(columns.newIds, i),
+          columns.committers[columns.committerIndexes[i]].name,
+          columns.times[i],
+          columns.messages[columns.messageIndexes[i]]
+        ]);
+      }
+      return entries;
+    }
+
+    return Promise.all([undefined, 1].map(function(limit) {
+      return Promise.all([
+        repo.readReflogs(names, { limit: limit }),
+        Promise.all(names.map(function(name) {
+          return expectedEntries(name, limit);
+        }))
+      ])
+        .then(function(results) {
+          var columns = results[0];
+          assert.equal(columns.refOffsets.length, names.length + 1);
+          assert.ok(results[1][0].length > 0);
+          names.forEach(function(name, refIndex) {
+            assert.deepEqual(
+              readEntries(columns, refIndex),
+              results[1][refIndex]
+            );
+          });
+        });
+    }))
+      .then(function() {
+        return repo.readReflogs(["refs/heads/.."]);
+      })
+      .then(function() {
+        assert.fail("readReflogs should have rejected the name");
+      }, function(error) {
+        assert.equal(error.errno, NodeGit.Error.CODE.EINVALIDSPEC);
+      });
+  });
+
+  it("can summarize the branches with their tip commits", function() {
+    var repo = this.repository;
+    var branches;
+
+    return repo.getBranch("master")
+      .then(function(master) {
+        return NodeGit.Branch.setUpstream(master, "origin/master");
+      })
+      .then(function() {
+        return repo.getBranchSummaries();
+      })
+      .then(function(result) {
+        branches = result;
+        assert.ok(branches.length > 0);
+
+        return Promise.all(branches.map(function(branch, i) {
+          if (i > 0) {
+            assert.ok(branches[i - 1].committerDate >= branch.committerDate);
+          }
+          assert.equal(branch.name.indexOf("refs/heads/"), 0);
+
+          return repo.getReferenceCommit(branch.name)
+            .then(function(commit) {
+              assert.equal(branch.oid, commit.sha());
+              assert.equal(branch.summary, commit.summary());
+              assert.equal(branch.authorName, commit.author().name());
+              assert.equal(branch.committerDate, commit.date().getTime());
+            });
+        }));
+      })
+      .then(function() {
+        var master = branches.find(function(branch) {
+          return branch.name === "refs/heads/master";
+        });
+        assert.equal(master.upstream, "refs/remotes/origin/master");
+
+        return repo.getReferenceCommit(master.upstream)
+          .then(function(upstreamCommit) {
+            return NodeGit.Graph.aheadBehind(
+              repo,
+              NodeGit.Oid.fromString(master.oid),
+              upstreamCommit.id()
+            );
+          })
+          .then(function(counts) {
+            assert.equal(master.ahead, counts.ahead);
+            assert.equal(master.behind, counts.behind);
+          });
+      })
+      .then(function() {
+        return repo.getBranchSummaries({ limit: 1, aheadBehind: false });
+      })
+      .then(function(limited) {
+        assert.equal(limited.length, 1);
+        assert.equal(limited[0].name, branches[0].name);
+        assert.equal(limited[0].ahead, null);
+      });
+  });
+
+  it("summarizes the branches whose history is missing without counts", function() {
+    var repo = this.repository;
+    var branchName = "branch-summaries-missing-parent";
+
+    return repo.getBranch("master")
+      .then(function(master) {
+        return NodeGit.Branch.setUpstream(master, "origin/master");
+      })
+      .then(function() {
+        return repo.getHeadCommit();
+      })
+      .then(function(headCommit) {
+        // a commit whose parent is not in the repository, as in a shallow clone
+        var data = "tree " + headCommit.treeId().tostrS() + "\n" +
+          "parent 1111111111111111111111111111111111111111\n" +
+          "author A <a@example.com> 1500000000 +0000\n" +
+          "committer A <a@example.com> 1500000000 +0000\n" +
+          "\n" +
+          "missing parent\n";
+        return repo.odb()
+          .then(function(odb) {
+            return odb.write(data, data.length, NodeGit.Object.TYPE.COMMIT);
+          });
+      })
+      .then(function(oid) {
+        return repo.createBranch(branchName, oid, true);
+      })
+      .then(function(branch) {
+        return NodeGit.Branch.setUpstream(branch, "master");
+      })
+      .then(function() {
+        return repo.getBranchSummaries();
+      })
+      .then(function(branches) {
+        var broken = branches.find(function(branch) {
+          return branch.name === "refs/heads/" + branchName;
+        });
+        assert.equal(broken.upstream, "refs/heads/master");
+        assert.equal(broken.ahead, null);
+        assert.equal(broken.behind, null);
+
+        // the other branches are still counted
+        var master = branches.find(function(branch) {
+          return branch.name === "refs/heads/master";
+        });
+        assert.equal(typeof master.ahead, "number");
+        assert.equal(typeof master.behind, "number");
+      })
+      .then(function() {
+        return repo.getBranch(branchName);
+      })
+      .then(function(branch) {
+        return NodeGit.Branch.delete(branch);
+      });
+  });
+
+  it("can watch the repository for reference changes", function() {
+    var repo = this.repository;
+    var branchName = "repository-watcher";
+    var watcher;
+
+    return new Promise(function(resolve, reject) {
+      watcher = repo.watch(function(changes) {
+        if (changes.indexOf(NodeGit.RepositoryWatcher.CHANGE.REFS) !== -1) {
+          resolve(changes);
+        }
+      }, { debounce: 20 });
+      assert.ok(watcher.isWatching());
+
+      repo.getHeadCommit()
+        .then(function(headCommit) {
+          // a nested directory, which isn't watched until it's created
+          return repo.createBranch("watched/" + branchName, headCommit, true);
+        })
+        .catch(reject);
+    })
+      .then(function() {
+        watcher.stop();
+        assert.equal(watcher.isWatching(), false);
+
+        return repo.getBranch("watched/" + branchName);
+      })
+      .then(function(branch) {
+        return NodeGit.Branch.delete(branch);
+      }, function(error) {
+        watcher.stop();
+        throw error;
+      });
+  });
+
+  it("can attribute historical size to paths in statistics", function() {
+    return this.constRepository.statistics({ sizeByPath: 5 })
+    .then(function(analysisReport) {
+      var sizeByPath = analysisReport.sizeByPath;
+
+      assert.equal(analysisReport.repositorySize.blobs.size, 48489622);
+      assert.equal(analysisReport.historyStructure.maxDepth, 931);
+
+      ["directories", "files"].forEach(function(kind) {
+        var entries = sizeByPath[kind];
+        assert.equal(entries.length, 5);
+        entries.forEach(function(entry, i) {
+          assert.ok(entry.path.length > 0);
+          assert.ok(entry.size > 0);
+          if (i > 0) {
+            assert.ok(entries[i - 1].size >= entry.size);
+          }
+        });
+      });
+
+      // a file can never be bigger than all of history
+      assert.ok(sizeByPath.files[0].size <=
+        analysisReport.repositorySize.blobs.size);
+    });
+  });
 });
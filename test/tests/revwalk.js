@@ -1,9 +1,11 @@
 var assert = require("assert");
 var RepoUtils = require("../utils/repository_setup");
+var crypto = require("crypto");
 var fse = require("fs-extra");
 var path = require("path");
 var local = path.join.bind(path, __dirname);
 
+var exec = require("../../utils/execPromise");
 var leakTest = require("../utils/leak_test");
 
 describe("Revwalk", function() {
@@ -157,6 +159,350 @@ describe("Revwalk", function() {
       });
   });
 
+  it("can do a fast walk into a packed buffer", function() {
+    var test = this;
+    var magicSha = "b8a94aefb22d0534cc0e5acf533989c13d8725dc";
+
+    return test.walker.fastWalkPacked(10)
+      .then(function(packedOids) {
+        assert.ok(Buffer.isBuffer(packedOids));
+        assert.equal(packedOids.length, 10 * Revwalk.PACKED_OID_SIZE);
+        assert.equal(Revwalk.packedOidCount(packedOids), 10);
+        assert.equal(Revwalk.packedOidSha(packedOids, 3), magicSha);
+        assert.equal(Revwalk.packedOid(packedOids, 3).toString(), magicSha);
+      });
+  });
+
+  it("can do a columnar commit walk", function() {
+    var test = this;
+    var magicSha = "b8a94aefb22d0534cc0e5acf533989c13d8725dc";
+    var numFields = Revwalk.COLUMNAR_STRING_FIELDS.length;
+
+    return test.walker.commitWalk(10, { columnar: true })
+      .then(function(columns) {
+        assert.equal(columns.count, 10);
+        assert.equal(columns.oids.length, 10 * Revwalk.PACKED_OID_SIZE);
+        assert.equal(Revwalk.packedOidSha(columns.oids, 3), magicSha);
+
+        assert.ok(columns.parentOffsets instanceof Uint32Array);
+        assert.equal(columns.parentOffsets.length, 11);
+        assert.equal(
+          columns.parents.length,
+          columns.parentOffsets[10] * Revwalk.PACKED_OID_SIZE
+        );
+
+        assert.ok(columns.authorTimes instanceof Float64Array);
+        assert.equal(columns.authorTimes.length, 10);
+        assert.equal(columns.committerTimes.length, 10);
+        assert.equal(columns.stringOffsets.length, 10 * numFields + 1);
+        assert.equal(
+          columns.stringOffsets[10 * numFields],
+          columns.strings.length
+        );
+
+        return test.repository.getCommit(magicSha)
+          .then(function(commit) {
+            assert.equal(
+              columns.authorTimes[3],
+              commit.author().when().time() * 1000
+            );
+            assert.equal(
+              Revwalk.columnarString(columns, 3, "authorName"),
+              commit.author().name()
+            );
+            assert.equal(
+              Revwalk.columnarString(columns, 3, "message"),
+              commit.message()
+            );
+          });
+      });
+  });
+
+  it("can lay out the graph in pages", function() {
+    var test = this;
+
+    function createWalker() {
+      var walker = test.repository.createRevWalk();
+      walker.sorting(Revwalk.SORT.TOPOLOGICAL);
+      walker.push(test.commit.id());
+      return walker;
+    }
+
+    function concat(arrays, ArrayType) {
+      var result = [];
+      arrays.forEach(function(array) {
+        result = result.concat(Array.from(array));
+      });
+      return ArrayType.from(result);
+    }
+
+    var pagedWalker = createWalker();
+    return Promise.all([
+      createWalker().graphLayout(100),
+      pagedWalker.graphLayout(40)
+        .then(function(firstPage) {
+          return pagedWalker.graphLayout(60, firstPage.state)
+            .then(function(secondPage) {
+              return [firstPage, secondPage];
+            });
+        })
+    ])
+      .then(function(results) {
+        var layout = results[0];
+        var pages = results[1];
+
+        assert.equal(layout.count, 100);
+        assert.equal(layout.firstRow, 0);
+        assert.equal(layout.lanes.length, 100);
+        assert.ok(layout.lanes instanceof Uint32Array);
+        assert.ok(layout.markers instanceof Uint8Array);
+        assert.ok(layout.markers[0] & Revwalk.GRAPH_MARKERS.TIP);
+        assert.equal(layout.edges.length % 3, 0);
+        for (var i = 0; i < layout.count; i++) {
+          assert.ok(layout.lanes[i] < layout.numLanes);
+        }
+
+        assert.equal(pages[0].count, 40);
+        assert.equal(pages[1].firstRow, 40);
+        assert.ok(pages[1].numLanes <= layout.numLanes);
+        assert.deepEqual(
+          Buffer.concat([pages[0].oids, pages[1].oids]),
+          layout.oids
+        );
+        assert.deepEqual(
+          concat([pages[0].lanes, pages[1].lanes], Uint32Array),
+          layout.lanes
+        );
+        assert.deepEqual(
+          concat([pages[0].markers, pages[1].markers], Uint8Array),
+          layout.markers
+        );
+        assert.deepEqual(
+          concat([pages[0].edges, pages[1].edges], Uint32Array),
+          layout.edges
+        );
+        assert.deepEqual(pages[1].state, layout.state);
+      });
+  });
+
+  it("won't lay out the graph of a walk that isn't sorted topologically", function() {
+    var test = this;
+
+    function layOut() {
+      var walker = test.repository.createRevWalk();
+      walker.sorting.apply(walker, arguments);
+      walker.push(test.commit.id());
+      return walker.graphLayout(10)
+        .then(function() {
+          assert.fail("graphLayout should have failed");
+        }, function(error) {
+          assert.ok(/TOPOLOGICAL/.test(error.message));
+        });
+    }
+
+    return layOut(Revwalk.SORT.NONE)
+      .then(function() {
+        return layOut(Revwalk.SORT.TIME);
+      })
+      .then(function() {
+        return layOut(Revwalk.SORT.TOPOLOGICAL, Revwalk.SORT.REVERSE);
+      });
+  });
+
+  it("can search the history", function() {
+    var test = this;
+
+    function createWalker() {
+      var walker = test.repository.createRevWalk();
+      walker.push(test.commit.id());
+      return walker;
+    }
+
+    function shas(commits) {
+      return commits.map(function(commit) {
+        return commit.sha;
+      });
+    }
+
+    return createWalker().commitWalk(1000, { returnPlainObjects: true })
+      .then(function(commits) {
+        var target = commits[3];
+        var grep = target.message.slice(0, 5).toUpperCase();
+        var since = target.committer.date;
+        var expected = commits.filter(function(commit) {
+          return commit.message.toUpperCase().indexOf(grep) !== -1 &&
+            commit.parents.length < 2 &&
+            commit.committer.date >= since;
+        });
+        assert.ok(expected.length > 0);
+
+        return Promise.all([
+          createWalker().searchWalk(1000, {
+            grep: grep,
+            ignoreCase: true,
+            merges: false,
+            since: new Date(since),
+            returnPlainObjects: true
+          }),
+          createWalker().searchWalk(1, {
+            grep: grep,
+            ignoreCase: true,
+            merges: false,
+            since: since,
+            returnPlainObjects: true
+          }),
+          createWalker().searchWalk(5, {
+            author: /<.+@.+>/,
+            returnPlainObjects: true
+          })
+        ])
+          .then(function(results) {
+            assert.deepEqual(shas(results[0]), shas(expected));
+            assert.deepEqual(shas(results[1]), shas(expected.slice(0, 1)));
+            assert.deepEqual(shas(results[2]), shas(commits.slice(0, 5)));
+          });
+      });
+  });
+
+  it("rejects patterns that can't be searched natively", function() {
+    // lookbehind assertions are not part of the native RegExp syntax
+    return this.walker.searchWalk(10, { grep: /(?<=a)b/ })
+      .then(function() {
+        assert.fail("searchWalk should have failed");
+      }, function(error) {
+        assert.ok(/Invalid grep pattern/.test(error.message));
+      });
+  });
+
+  it("rejects RegExp flags that can't be searched natively", function() {
+    var walker = this.walker;
+
+    return walker.searchWalk(10, { author: /^nobody$/m })
+      .then(function() {
+        assert.fail("searchWalk should have failed");
+      }, function(error) {
+        assert.ok(/Invalid author pattern/.test(error.message));
+        assert.ok(/flags/.test(error.message));
+        return walker.searchWalk(10, { grep: /fixes/gi });
+      })
+      .then(function(commits) {
+        assert.ok(Array.isArray(commits));
+      });
+  });
+
+  it("can search commits with large messages", function() {
+    var test = this;
+    var oid;
+
+    function search(grep) {
+      var walker = test.repository.createRevWalk();
+      walker.push(oid);
+      return walker.searchWalk(1, { grep: grep, returnPlainObjects: true })
+        .then(function(commits) {
+          return commits.map(function(commit) {
+            return commit.sha;
+          });
+        });
+    }
+
+    // a repetition over thousands of characters would overflow the stack of
+    // a backtracking matcher
+    var message = "x".repeat(4000) + " fixes\n" + "x".repeat(1 << 20) +
+      " needle\n";
+    var data = "tree " + test.commit.treeId().tostrS() + "\n" +
+      "parent " + test.commit.sha() + "\n" +
+      "author A <a@example.com> 1500000000 +0000\n" +
+      "committer A <a@example.com> 1500000000 +0000\n" +
+      "\n" +
+      message;
+
+    return test.repository.odb()
+      .then(function(odb) {
+        return odb.write(data, data.length, NodeGit.Object.TYPE.COMMIT);
+      })
+      .then(function(result) {
+        oid = result.tostrS();
+        return search(/^(x|y)+ fixes/);
+      })
+      .then(function(shas) {
+        assert.deepEqual(shas, [oid]);
+
+        // only the beginning of long messages is searched
+        return search(/needle/);
+      })
+      .then(function(shas) {
+        assert.notEqual(shas[0], oid);
+      });
+  });
+
+  it("can page through a cursor and resume it from a checkpoint", function() {
+    var test = this;
+    var expectedShas;
+    var pagedShas = [];
+
+    function shas(commits) {
+      return commits.map(function(commit) {
+        return commit.sha();
+      });
+    }
+
+    return test.walker.fastWalk(10)
+      .then(function(oids) {
+        expectedShas = oids.map(function(oid) {
+          return oid.toString();
+        });
+
+        return Revwalk.createCursor(test.repository, {
+          push: test.commit.sha(),
+          sorting: Revwalk.SORT.TIME,
+          pageSize: 3
+        });
+      })
+      .then(function(cursor) {
+        return cursor.nextPage()
+          .then(function(page) {
+            assert.equal(page.length, 3);
+            pagedShas = pagedShas.concat(shas(page));
+            return cursor.nextPage();
+          })
+          .then(function(page) {
+            pagedShas = pagedShas.concat(shas(page));
+            return JSON.parse(JSON.stringify(cursor.checkpoint()));
+          });
+      })
+      .then(function(checkpoint) {
+        assert.equal(checkpoint.emitted, 6);
+        assert.equal(checkpoint.lastSha, expectedShas[5]);
+
+        var resumed = Revwalk.resumeCursor(test.repository, checkpoint);
+        return resumed.nextPage();
+      })
+      .then(function(page) {
+        pagedShas = pagedShas.concat(shas(page));
+        assert.deepEqual(pagedShas, expectedShas.slice(0, 9));
+      });
+  });
+
+  it("can iterate a cursor asynchronously", async function() {
+    var test = this;
+    var cursor = await Revwalk.createCursor(test.repository, {
+      push: test.commit.sha(),
+      sorting: Revwalk.SORT.TIME,
+      pageSize: 4,
+      returnPlainObjects: true
+    });
+    var oids = await test.walker.fastWalk(1000);
+    var count = 0;
+
+    for await (const commit of cursor) {
+      assert.equal(commit.sha, oids[count].toString());
+      count++;
+    }
+
+    assert.equal(count, oids.length);
+    assert.equal(cursor.checkpoint().emitted, oids.length);
+  });
+
   it("can get the history of a file", function() {
     var test = this;
     var magicShas = [
@@ -181,6 +527,173 @@ describe("Revwalk", function() {
       });
   });
 
+  it("can get the history of a file with a commit-graph", function() {
+    var test = this;
+    var infoPath = path.join(reposPath, ".git", "objects", "info");
+    var magicShas = [
+      "6ed3027eda383d417457b99b38c73f88f601c368",
+      "95cefff6aabd3c1f6138ec289f42fec0921ff610",
+      "7ad92a7e4d26a1af93f3450aea8b9d9b8069ea8c",
+      "96f077977eb1ffcb63f9ce766cdf110e9392fdf5",
+      "694adc5369687c47e02642941906cfc5cb21e6c2",
+      "eebd0ead15d62eaf0ba276da53af43bbc3ce43ab",
+      "1273fff13b3c28cfdb13ba7f575d696d2a8902e1"
+    ];
+
+    function removeCommitGraph() {
+      return Promise.all([
+        fse.remove(path.join(infoPath, "commit-graph")),
+        fse.remove(path.join(infoPath, "commit-graphs"))
+      ]);
+    }
+
+    return exec("git commit-graph write --reachable --changed-paths", {
+      cwd: reposPath
+    })
+      .then(function() {
+        return test.walker.fileHistoryWalk("include/functions/copy.h", 1000);
+      })
+      .then(function(results) {
+        var shas = results.map(function(result) {
+          return result.commit.sha();
+        });
+        assert.deepEqual(shas, magicShas);
+      })
+      .then(removeCommitGraph, function(error) {
+        return removeCommitGraph().then(function() {
+          throw error;
+        });
+      });
+  });
+
+  it("doesn't read the commit-graph with core.commitGraph disabled", function() {
+    var test = this;
+    var infoPath = path.join(reposPath, ".git", "objects", "info");
+    var commitGraphPath = path.join(infoPath, "commit-graph");
+    var sha = test.commit.sha();
+
+    function removeCommitGraph() {
+      return Promise.all([
+        fse.remove(commitGraphPath),
+        fse.remove(path.join(infoPath, "commit-graphs"))
+      ]);
+    }
+
+    // makes the commit a root in the commit-graph (but not in its object),
+    // so that walks reading the commit-graph stop right there
+    function cutHistoryInCommitGraph() {
+      return fse.readFile(commitGraphPath)
+        .then(function(data) {
+          var numChunks = data[6];
+          var chunks = {};
+          for (var i = 0; i < numChunks; ++i) {
+            var entry = 8 + i * 12;
+            chunks[data.toString("ascii", entry, entry + 4)] =
+              data.readUInt32BE(entry + 4) * 0x100000000 +
+              data.readUInt32BE(entry + 8);
+          }
+          var numCommits = data.readUInt32BE(chunks.OIDF + 255 * 4);
+          for (var position = 0; position < numCommits; ++position) {
+            var oidStart = chunks.OIDL + position * 20;
+            if (data.toString("hex", oidStart, oidStart + 20) === sha) {
+              // no first or second parent
+              data.writeUInt32BE(0x70000000, chunks.CDAT + position * 36 + 20);
+              data.writeUInt32BE(0x70000000, chunks.CDAT + position * 36 + 24);
+            }
+          }
+          crypto.createHash("sha1")
+            .update(data.slice(0, data.length - 20))
+            .digest()
+            .copy(data, data.length - 20);
+          return fse.writeFile(commitGraphPath, data);
+        });
+    }
+
+    // the commit-graph is attached to the repository when it is opened
+    function walkFreshRepository() {
+      return Repository.open(reposPath)
+        .then(function(repository) {
+          var walker = repository.createRevWalk();
+          walker.sorting(Revwalk.SORT.TOPOLOGICAL, Revwalk.SORT.TIME);
+          walker.push(test.commit.id());
+          var layoutWalker = repository.createRevWalk();
+          layoutWalker.sorting(Revwalk.SORT.TOPOLOGICAL, Revwalk.SORT.TIME);
+          layoutWalker.push(test.commit.id());
+          return Promise.all([
+            walker.fastWalk(1000),
+            layoutWalker.graphLayout(1000)
+          ]);
+        })
+        .then(function(results) {
+          return {
+            walked: results[0].length,
+            laidOut: results[1].count
+          };
+        });
+    }
+
+    function restore() {
+      return test.repository.config()
+        .then(function(config) {
+          config.deleteEntry("core.commitGraph");
+          return removeCommitGraph();
+        });
+    }
+
+    return exec("git commit-graph write --reachable", { cwd: reposPath })
+      .then(cutHistoryInCommitGraph)
+      .then(walkFreshRepository)
+      .then(function(withCommitGraph) {
+        assert.equal(withCommitGraph.walked, 1);
+        assert.equal(withCommitGraph.laidOut, 1);
+        return test.repository.config();
+      })
+      .then(function(config) {
+        return config.setBool("core.commitGraph", false);
+      })
+      .then(walkFreshRepository)
+      .then(function(withoutCommitGraph) {
+        assert.ok(withoutCommitGraph.walked > 1);
+        assert.equal(withoutCommitGraph.laidOut, withoutCommitGraph.walked);
+      })
+      .then(restore, function(error) {
+        return restore().then(function() {
+          throw error;
+        });
+      });
+  });
+
+  it("can get the history of several files in one walk", function() {
+    var test = this;
+    var filePaths = ["include/functions/copy.h", "lib/revwalk.js"];
+
+    function createWalker() {
+      var walker = test.repository.createRevWalk();
+      walker.sorting(Revwalk.SORT.TOPOLOGICAL, Revwalk.SORT.TIME);
+      walker.push(test.commit.id());
+      return walker;
+    }
+
+    function shas(results) {
+      return results.map(function(result) {
+        return result.commit.sha();
+      });
+    }
+
+    return createWalker().fileHistoryWalkPaths(filePaths, 1000)
+      .then(function(resultsByPath) {
+        assert.deepEqual(Object.keys(resultsByPath), filePaths);
+
+        return Promise.all(filePaths.map(function(filePath) {
+          return createWalker().fileHistoryWalk(filePath, 1000)
+            .then(function(results) {
+              assert.ok(results.length > 0);
+              assert.deepEqual(shas(resultsByPath[filePath]), shas(results));
+            });
+        }));
+      });
+  });
+
   it("can get the history of a dir", function() {
     var test = this;
     var magicShas = [
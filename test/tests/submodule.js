@@ -53,6 +53,30 @@ describe("Submodule", function() {
       });
   });
 
+  it("can get the status of all the submodules", function() {
+    var repo = this.workdirRepository;
+    var submoduleName = "vendor/libgit2";
+
+    return Promise.all([
+      repo.getSubmoduleStatuses({ ignore: Submodule.IGNORE.NONE }),
+      Submodule.status(repo, submoduleName, Submodule.IGNORE.NONE)
+    ])
+      .then(function(results) {
+        var statuses = results[0];
+        assert.equal(statuses.length, 1);
+        assert.equal(statuses[0].name, submoduleName);
+        assert.equal(statuses[0].path, submoduleName);
+        assert.equal(statuses[0].status, results[1]);
+        assert.equal(statuses[0].workdirId, null);
+
+        return repo.getSubmoduleStatuses({ concurrency: 1 });
+      })
+      .then(function(statuses) {
+        assert.equal(statuses.length, 1);
+        assert.equal(statuses[0].name, submoduleName);
+      });
+  });
+
   it("can get submodule location", function() {
     var repo = this.workdirRepository;
     var submoduleName = "vendor/libgit2";